@@ -0,0 +1,20 @@
+#include "ActorHandle.h"
+#include <cstdint>
+
+namespace {
+	const std::uintptr_t KIND_BITS = 2;
+	const std::uintptr_t KIND_MASK = (1u << KIND_BITS) - 1;
+}
+
+void ActorHandle::set(physx::PxActor* actor, Kind kind, unsigned int index) {
+	std::uintptr_t handle = (std::uintptr_t(index) << KIND_BITS) | std::uintptr_t(kind);
+	actor->userData = reinterpret_cast<void*>(handle);
+}
+
+ActorHandle::Kind ActorHandle::getKind(const physx::PxActor* actor) {
+	return Kind(reinterpret_cast<std::uintptr_t>(actor->userData) & KIND_MASK);
+}
+
+unsigned int ActorHandle::getIndex(const physx::PxActor* actor) {
+	return static_cast<unsigned int>(reinterpret_cast<std::uintptr_t>(actor->userData) >> KIND_BITS);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <PxPhysicsAPI.h>
+
+/*!
+ * Tells what a PhysX actor belongs to. The handle is kept in the userData of the actor, the kind in its low bits
+ * and the index in the rest, so callbacks find their enemy without names, string compares or allocations.
+ */
+class ActorHandle {
+public:
+	enum class Kind {
+		None,
+		Player,
+		Enemy
+	};
+
+	static void set(physx::PxActor* actor, Kind kind, unsigned int index = 0);
+
+	/*!
+	 * @return Kind::None for actors without a handle
+	 */
+	static Kind getKind(const physx::PxActor* actor);
+
+	/*!
+	 * @return index of the enemy in Scene::enemies
+	 */
+	static unsigned int getIndex(const physx::PxActor* actor);
+};
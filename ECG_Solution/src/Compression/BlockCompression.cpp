@@ -0,0 +1,335 @@
+#include "BlockCompression.h"
+#include <cstring>
+#include <utility>
+#include <glm/glm.hpp>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define BLOCK_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+int getBlockSize(BlockFormat format) {
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t getCompressedSize(BlockFormat format, int width, int height) {
+	size_t blocksX = (width + 3) / 4;
+	size_t blocksY = (height + 3) / 4;
+	return blocksX * blocksY * getBlockSize(format);
+}
+
+namespace {
+
+	unsigned short toRGB565(const glm::vec3& color) {
+		int r = glm::clamp(int(color.r * 31.0f / 255.0f + 0.5f), 0, 31);
+		int g = glm::clamp(int(color.g * 63.0f / 255.0f + 0.5f), 0, 63);
+		int b = glm::clamp(int(color.b * 31.0f / 255.0f + 0.5f), 0, 31);
+		return static_cast<unsigned short>((r << 11) | (g << 5) | b);
+	}
+
+	// expands a 565 color to 8 bits per channel exactly like the hardware decoder
+	void fromRGB565(unsigned short color, unsigned char* rgb) {
+		int r = (color >> 11) & 31;
+		int g = (color >> 5) & 63;
+		int b = color & 31;
+		rgb[0] = static_cast<unsigned char>((r << 3) | (r >> 2));
+		rgb[1] = static_cast<unsigned char>((g << 2) | (g >> 4));
+		rgb[2] = static_cast<unsigned char>((b << 3) | (b >> 2));
+	}
+
+	// palette in the same RGBA layout as the pixels, alpha is ignored while matching
+	void buildColorPalette(unsigned short c0, unsigned short c1, unsigned char palette[4][4]) {
+		std::memset(palette, 0, 16);
+		fromRGB565(c0, palette[0]);
+		fromRGB565(c1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = static_cast<unsigned char>((2 * palette[0][c] + palette[1][c]) / 3);
+			palette[3][c] = static_cast<unsigned char>((palette[0][c] + 2 * palette[1][c]) / 3);
+		}
+	}
+
+	// index of the closest palette entry for every pixel, 2 bits per pixel
+	unsigned int selectColorIndices(const unsigned char* rgba, const unsigned char palette[4][4]) {
+		unsigned int indices = 0;
+#ifdef BLOCK_COMPRESSION_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+		for (int group = 0; group < 4; group++) {
+			// four pixels per register
+			__m128i pixels = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + group * 16)), rgbMask);
+			__m128i pixelsLo = _mm_unpacklo_epi8(pixels, zero);
+			__m128i pixelsHi = _mm_unpackhi_epi8(pixels, zero);
+
+			__m128i best = _mm_set1_epi32(0x7FFFFFFF);
+			__m128i bestIndex = zero;
+			for (int p = 0; p < 4; p++) {
+				int entry;
+				std::memcpy(&entry, palette[p], 4);
+				__m128i color = _mm_unpacklo_epi8(_mm_and_si128(_mm_set1_epi32(entry), rgbMask), zero);
+				__m128i dLo = _mm_sub_epi16(pixelsLo, color);
+				__m128i dHi = _mm_sub_epi16(pixelsHi, color);
+				// squared differences summed to rg and ba pairs, then pairs summed per pixel
+				__m128i sLo = _mm_madd_epi16(dLo, dLo);
+				__m128i sHi = _mm_madd_epi16(dHi, dHi);
+				__m128i sum = _mm_add_epi32(
+					_mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(sLo), _mm_castsi128_ps(sHi), _MM_SHUFFLE(2, 0, 2, 0))),
+					_mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(sLo), _mm_castsi128_ps(sHi), _MM_SHUFFLE(3, 1, 3, 1))));
+				__m128i closer = _mm_cmplt_epi32(sum, best);
+				best = _mm_or_si128(_mm_and_si128(closer, sum), _mm_andnot_si128(closer, best));
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+			}
+			int result[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(result), bestIndex);
+			for (int i = 0; i < 4; i++) {
+				indices |= static_cast<unsigned int>(result[i]) << (2 * (group * 4 + i));
+			}
+		}
+#else
+		for (int i = 0; i < 16; i++) {
+			int best = 0x7FFFFFFF;
+			int bestIndex = 0;
+			for (int p = 0; p < 4; p++) {
+				int dist = 0;
+				for (int c = 0; c < 3; c++) {
+					int d = int(rgba[i * 4 + c]) - int(palette[p][c]);
+					dist += d * d;
+				}
+				if (dist < best) {
+					best = dist;
+					bestIndex = p;
+				}
+			}
+			indices |= static_cast<unsigned int>(bestIndex) << (2 * i);
+		}
+#endif
+		return indices;
+	}
+
+	// endpoints along the principal axis of the block colors
+	void findColorEndpoints(const unsigned char* rgba, glm::vec3& start, glm::vec3& end) {
+		glm::vec3 mean = glm::vec3(0.0f);
+		for (int i = 0; i < 16; i++) {
+			mean += glm::vec3(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2]);
+		}
+		mean /= 16.0f;
+
+		float cov[6] = { 0, 0, 0, 0, 0, 0 };
+		for (int i = 0; i < 16; i++) {
+			glm::vec3 d = glm::vec3(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2]) - mean;
+			cov[0] += d.r * d.r; cov[1] += d.r * d.g; cov[2] += d.r * d.b;
+			cov[3] += d.g * d.g; cov[4] += d.g * d.b; cov[5] += d.b * d.b;
+		}
+
+		// power iteration, a few steps are enough for 16 points
+		glm::vec3 axis = glm::vec3(1.0f, 1.0f, 1.0f);
+		for (int i = 0; i < 8; i++) {
+			glm::vec3 next = glm::vec3(
+				cov[0] * axis.r + cov[1] * axis.g + cov[2] * axis.b,
+				cov[1] * axis.r + cov[3] * axis.g + cov[4] * axis.b,
+				cov[2] * axis.r + cov[4] * axis.g + cov[5] * axis.b);
+			float length = glm::length(next);
+			if (length < 1e-6f) {
+				break;
+			}
+			axis = next / length;
+		}
+
+		float minProj = 1e30f;
+		float maxProj = -1e30f;
+		for (int i = 0; i < 16; i++) {
+			float proj = glm::dot(glm::vec3(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2]) - mean, axis);
+			minProj = glm::min(minProj, proj);
+			maxProj = glm::max(maxProj, proj);
+		}
+		// inset by half an interpolation step, the extremes are covered by the interpolated colors
+		float inset = (maxProj - minProj) / 16.0f;
+		start = glm::clamp(mean + axis * (maxProj - inset), 0.0f, 255.0f);
+		end = glm::clamp(mean + axis * (minProj + inset), 0.0f, 255.0f);
+	}
+
+	// least squares fit of the endpoints to the selected indices
+	bool refitColorEndpoints(const unsigned char* rgba, unsigned int indices, glm::vec3& start, glm::vec3& end) {
+		static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa = 0, bb = 0, ab = 0;
+		glm::vec3 ax = glm::vec3(0.0f);
+		glm::vec3 bx = glm::vec3(0.0f);
+		for (int i = 0; i < 16; i++) {
+			float a = weights[(indices >> (2 * i)) & 3];
+			float b = 1.0f - a;
+			glm::vec3 x = glm::vec3(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2]);
+			aa += a * a;
+			bb += b * b;
+			ab += a * b;
+			ax += a * x;
+			bx += b * x;
+		}
+		float det = aa * bb - ab * ab;
+		if (glm::abs(det) < 1e-6f) {
+			return false;
+		}
+		start = glm::clamp((ax * bb - bx * ab) / det, 0.0f, 255.0f);
+		end = glm::clamp((bx * aa - ax * ab) / det, 0.0f, 255.0f);
+		return true;
+	}
+
+	unsigned int colorError(const unsigned char* rgba, unsigned int indices, const unsigned char palette[4][4]) {
+		unsigned int error = 0;
+		for (int i = 0; i < 16; i++) {
+			const unsigned char* p = palette[(indices >> (2 * i)) & 3];
+			for (int c = 0; c < 3; c++) {
+				int d = int(rgba[i * 4 + c]) - int(p[c]);
+				error += d * d;
+			}
+		}
+		return error;
+	}
+
+	// encodes with the given endpoints, always in the four color mode (c0 > c1)
+	void encodeColorEndpoints(const unsigned char* rgba, const glm::vec3& start, const glm::vec3& end,
+		unsigned short& c0, unsigned short& c1, unsigned int& indices, unsigned char palette[4][4]) {
+		c0 = toRGB565(start);
+		c1 = toRGB565(end);
+		if (c0 < c1) {
+			std::swap(c0, c1);
+		}
+		buildColorPalette(c0, c1, palette);
+		// equal endpoints would switch to the three color mode, but then every pixel uses index 0 anyway
+		indices = c0 == c1 ? 0 : selectColorIndices(rgba, palette);
+	}
+
+	void compressColorBlock(const unsigned char* rgba, unsigned char* block) {
+		glm::vec3 start, end;
+		findColorEndpoints(rgba, start, end);
+
+		unsigned short c0, c1;
+		unsigned int indices;
+		unsigned char palette[4][4];
+		encodeColorEndpoints(rgba, start, end, c0, c1, indices, palette);
+
+		// one refinement step, kept only if it lowers the error
+		if (c0 != c1 && refitColorEndpoints(rgba, indices, start, end)) {
+			unsigned short r0, r1;
+			unsigned int refitIndices;
+			unsigned char refitPalette[4][4];
+			encodeColorEndpoints(rgba, start, end, r0, r1, refitIndices, refitPalette);
+			if (colorError(rgba, refitIndices, refitPalette) < colorError(rgba, indices, palette)) {
+				c0 = r0;
+				c1 = r1;
+				indices = refitIndices;
+			}
+		}
+
+		block[0] = static_cast<unsigned char>(c0 & 0xFF);
+		block[1] = static_cast<unsigned char>(c0 >> 8);
+		block[2] = static_cast<unsigned char>(c1 & 0xFF);
+		block[3] = static_cast<unsigned char>(c1 >> 8);
+		for (int i = 0; i < 4; i++) {
+			block[4 + i] = static_cast<unsigned char>((indices >> (8 * i)) & 0xFF);
+		}
+	}
+
+	// BC4: one channel with 8 interpolated values between max and min
+	void compressChannelBlock(const unsigned char* rgba, int channel, unsigned char* block) {
+		unsigned char values[16];
+		int minValue = 255;
+		int maxValue = 0;
+		for (int i = 0; i < 16; i++) {
+			values[i] = rgba[i * 4 + channel];
+			minValue = glm::min(minValue, int(values[i]));
+			maxValue = glm::max(maxValue, int(values[i]));
+		}
+
+		block[0] = static_cast<unsigned char>(maxValue);
+		block[1] = static_cast<unsigned char>(minValue);
+		std::memset(block + 2, 0, 6);
+		if (maxValue == minValue) {
+			return;
+		}
+
+		// palette order of the 8 value mode: max, min, then 6/7 max + 1/7 min down to 1/7 max + 6/7 min
+		int palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (int i = 1; i < 7; i++) {
+			palette[i + 1] = ((7 - i) * maxValue + i * minValue) / 7;
+		}
+
+		unsigned char indices[16];
+#ifdef BLOCK_COMPRESSION_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+		__m128i lanes[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+		for (int half = 0; half < 2; half++) {
+			__m128i best = _mm_set1_epi16(0x7FFF);
+			__m128i bestIndex = zero;
+			for (int p = 0; p < 8; p++) {
+				__m128i diff = _mm_sub_epi16(lanes[half], _mm_set1_epi16(static_cast<short>(palette[p])));
+				__m128i dist = _mm_max_epi16(diff, _mm_sub_epi16(zero, diff));
+				__m128i closer = _mm_cmplt_epi16(dist, best);
+				best = _mm_min_epi16(dist, best);
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi16(static_cast<short>(p))), _mm_andnot_si128(closer, bestIndex));
+			}
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(indices + half * 8), _mm_packus_epi16(bestIndex, zero));
+		}
+#else
+		for (int i = 0; i < 16; i++) {
+			int best = 256;
+			for (int p = 0; p < 8; p++) {
+				int dist = glm::abs(int(values[i]) - palette[p]);
+				if (dist < best) {
+					best = dist;
+					indices[i] = static_cast<unsigned char>(p);
+				}
+			}
+		}
+#endif
+
+		// 16 indices of 3 bits, little endian over the remaining 6 bytes
+		unsigned long long bits = 0;
+		for (int i = 0; i < 16; i++) {
+			bits |= static_cast<unsigned long long>(indices[i]) << (3 * i);
+		}
+		for (int i = 0; i < 6; i++) {
+			block[2 + i] = static_cast<unsigned char>((bits >> (8 * i)) & 0xFF);
+		}
+	}
+
+}
+
+void compressBlock(BlockFormat format, const unsigned char* rgba, unsigned char* block) {
+	switch (format) {
+	case BlockFormat::BC1:
+		compressColorBlock(rgba, block);
+		break;
+	case BlockFormat::BC3:
+		compressChannelBlock(rgba, 3, block);
+		compressColorBlock(rgba, block + 8);
+		break;
+	case BlockFormat::BC5:
+		compressChannelBlock(rgba, 0, block);
+		compressChannelBlock(rgba, 1, block + 8);
+		break;
+	}
+}
+
+void compressImage(ThreadPool& pool, BlockFormat format, const unsigned char* rgba, int width, int height, std::vector<unsigned char>& output) {
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	int blockSize = getBlockSize(format);
+	output.resize(getCompressedSize(format, width, height));
+
+	pool.parallelFor(blocksY, [&](int by) {
+		unsigned char pixels[64];
+		for (int bx = 0; bx < blocksX; bx++) {
+			// blocks reaching over the border repeat the last row and column
+			for (int y = 0; y < 4; y++) {
+				int sy = glm::min(by * 4 + y, height - 1);
+				for (int x = 0; x < 4; x++) {
+					int sx = glm::min(bx * 4 + x, width - 1);
+					std::memcpy(pixels + (y * 4 + x) * 4, rgba + (size_t(sy) * width + sx) * 4, 4);
+				}
+			}
+			compressBlock(format, pixels, output.data() + (size_t(by) * blocksX + bx) * blockSize);
+		}
+	});
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include "../Jobs/ThreadPool.h"
+
+/*!
+ * Block compressed formats written by the texture converter
+ */
+enum class BlockFormat {
+	BC1,	// RGB, 8 bytes per 4x4 block
+	BC3,	// RGBA, BC4 alpha + BC1 color, 16 bytes per block
+	BC5		// two channels (red, green), two BC4 blocks, 16 bytes per block
+};
+
+/*!
+ * @return the size of one 4x4 block in bytes
+ */
+int getBlockSize(BlockFormat format);
+
+/*!
+ * @return the size of an image of the given size in bytes
+ */
+size_t getCompressedSize(BlockFormat format, int width, int height);
+
+/*!
+ * Compresses one 4x4 block
+ * @param rgba: 16 pixels, row major, 4 bytes per pixel
+ * @param block: output, getBlockSize(format) bytes
+ */
+void compressBlock(BlockFormat format, const unsigned char* rgba, unsigned char* block);
+
+/*!
+ * Compresses an RGBA8 image, rows of blocks are distributed over the thread pool
+ * @param rgba: width * height pixels, row major
+ * @param output: resized to getCompressedSize(format, width, height)
+ */
+void compressImage(ThreadPool& pool, BlockFormat format, const unsigned char* rgba, int width, int height, std::vector<unsigned char>& output);
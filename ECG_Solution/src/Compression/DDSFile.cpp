@@ -0,0 +1,249 @@
+#include "DDSFile.h"
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "../FileSystem/FileSystem.h"
+
+namespace {
+
+	const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+	const uint32_t DDSD_CAPS = 0x1;
+	const uint32_t DDSD_HEIGHT = 0x2;
+	const uint32_t DDSD_WIDTH = 0x4;
+	const uint32_t DDSD_PIXELFORMAT = 0x1000;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDSD_LINEARSIZE = 0x80000;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDSCAPS_COMPLEX = 0x8;
+	const uint32_t DDSCAPS_TEXTURE = 0x1000;
+	const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+	uint32_t fourCC(char a, char b, char c, char d) {
+		return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+	}
+
+	struct DDSPixelFormat {
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t masks[4];
+	};
+
+	struct DDSHeader {
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDSPixelFormat pixelFormat;
+		uint32_t caps[4];
+		uint32_t reserved2;
+	};
+
+	static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+
+	// a BC1 color block stores one byte of indices per row
+	void flipColorBlock(unsigned char* block, int rows) {
+		std::reverse(block + 4, block + 4 + rows);
+	}
+
+	// a BC4 block stores 12 bits of indices per row after the two endpoints
+	void flipChannelBlock(unsigned char* block, int rows) {
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; i++) {
+			bits |= uint64_t(block[2 + i]) << (8 * i);
+		}
+		uint64_t flipped = bits;
+		for (int row = 0; row < rows; row++) {
+			uint64_t mask = uint64_t(0xFFF) << (12 * (rows - 1 - row));
+			flipped &= ~(uint64_t(0xFFF) << (12 * row));
+			flipped |= ((bits & mask) >> (12 * (rows - 1 - row))) << (12 * row);
+		}
+		for (int i = 0; i < 6; i++) {
+			block[2 + i] = static_cast<unsigned char>((flipped >> (8 * i)) & 0xFF);
+		}
+	}
+
+	void flipBlock(BlockFormat format, unsigned char* block, int rows) {
+		switch (format) {
+		case BlockFormat::BC1:
+			flipColorBlock(block, rows);
+			break;
+		case BlockFormat::BC3:
+			flipChannelBlock(block, rows);
+			flipColorBlock(block + 8, rows);
+			break;
+		case BlockFormat::BC5:
+			flipChannelBlock(block, rows);
+			flipChannelBlock(block + 8, rows);
+			break;
+		}
+	}
+
+}
+
+bool readDDS(const std::string& path, CompressedImage& image, int firstLevel) {
+	FileData file = FileSystem::readFile(path);
+	if (!file.isValid()) {
+		return false;
+	}
+
+	uint32_t magic = 0;
+	DDSHeader header;
+	if (file.size() < sizeof(magic) + sizeof(header)) {
+		std::cout << "Unsupported DDS file: " << path << std::endl;
+		return false;
+	}
+	std::memcpy(&magic, file.data(), sizeof(magic));
+	std::memcpy(&header, file.data() + sizeof(magic), sizeof(header));
+	if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || !(header.pixelFormat.flags & DDPF_FOURCC)) {
+		std::cout << "Unsupported DDS file: " << path << std::endl;
+		return false;
+	}
+
+	uint32_t code = header.pixelFormat.fourCC;
+	if (code == fourCC('D', 'X', 'T', '1')) {
+		image.format = BlockFormat::BC1;
+	}
+	else if (code == fourCC('D', 'X', 'T', '5')) {
+		image.format = BlockFormat::BC3;
+	}
+	else if (code == fourCC('A', 'T', 'I', '2') || code == fourCC('B', 'C', '5', 'U')) {
+		image.format = BlockFormat::BC5;
+	}
+	else {
+		std::cout << "Unsupported DDS format in " << path << std::endl;
+		return false;
+	}
+
+	image.width = int(header.width);
+	image.height = int(header.height);
+	int levelCount = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount > 0 ? int(header.mipMapCount) : 1;
+	image.levels.assign(levelCount, std::vector<unsigned char>());
+
+	size_t offset = sizeof(magic) + sizeof(header);
+	for (int level = 0; level < levelCount; level++) {
+		size_t size = getLevelSize(image, level);
+		if (size > file.size() - offset) {
+			std::cout << "Truncated DDS file: " << path << std::endl;
+			return false;
+		}
+		if (level >= firstLevel) {
+			image.levels[level].assign(file.bytesData() + offset, file.bytesData() + offset + size);
+		}
+		offset += size;
+	}
+	return true;
+}
+
+size_t getLevelSize(const CompressedImage& image, int level) {
+	return getCompressedSize(image.format, glm::max(1, image.width >> level), glm::max(1, image.height >> level));
+}
+
+bool writeDDS(const std::string& path, const CompressedImage& image) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		std::cout << "Could not write " << path << std::endl;
+		return false;
+	}
+
+	DDSHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.size = sizeof(DDSHeader);
+	header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header.height = uint32_t(image.height);
+	header.width = uint32_t(image.width);
+	header.pitchOrLinearSize = uint32_t(getCompressedSize(image.format, image.width, image.height));
+	header.mipMapCount = uint32_t(image.levels.size());
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+	header.pixelFormat.flags = DDPF_FOURCC;
+	switch (image.format) {
+	case BlockFormat::BC1: header.pixelFormat.fourCC = fourCC('D', 'X', 'T', '1'); break;
+	case BlockFormat::BC3: header.pixelFormat.fourCC = fourCC('D', 'X', 'T', '5'); break;
+	case BlockFormat::BC5: header.pixelFormat.fourCC = fourCC('A', 'T', 'I', '2'); break;
+	}
+	header.caps[0] = DDSCAPS_TEXTURE | (image.levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+	file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (const std::vector<unsigned char>& level : image.levels) {
+		file.write(reinterpret_cast<const char*>(level.data()), level.size());
+	}
+	return bool(file);
+}
+
+bool flipCompressedImage(CompressedImage& image) {
+	int height = image.height;
+	for (size_t level = 0; level < image.levels.size(); level++) {
+		if (height > 4 && height % 4 != 0) {
+			return false;
+		}
+		height = glm::max(1, height / 2);
+	}
+
+	int blockSize = getBlockSize(image.format);
+	int width = image.width;
+	height = image.height;
+	for (std::vector<unsigned char>& level : image.levels) {
+		if (level.empty()) {
+			// skipped by a partial read
+			width = glm::max(1, width / 2);
+			height = glm::max(1, height / 2);
+			continue;
+		}
+		int blocksX = (width + 3) / 4;
+		int blocksY = (height + 3) / 4;
+		size_t rowSize = size_t(blocksX) * blockSize;
+		int rows = glm::min(height, 4);
+
+		// swap whole block rows, then flip the pixel rows inside every block
+		for (int y = 0; y < blocksY / 2; y++) {
+			std::swap_ranges(level.begin() + y * rowSize, level.begin() + (y + 1) * rowSize, level.begin() + (blocksY - 1 - y) * rowSize);
+		}
+		for (size_t offset = 0; offset < level.size(); offset += blockSize) {
+			flipBlock(image.format, level.data() + offset, rows);
+		}
+
+		width = glm::max(1, width / 2);
+		height = glm::max(1, height / 2);
+	}
+	return true;
+}
+
+GLenum getCompressedFormat(BlockFormat format) {
+	switch (format) {
+	case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+	}
+	return GL_NONE;
+}
+
+void uploadCompressedImage(GLenum target, const CompressedImage& image) {
+	GLenum format = getCompressedFormat(image.format);
+	int width = image.width;
+	int height = image.height;
+	for (size_t level = 0; level < image.levels.size(); level++) {
+		glCompressedTexImage2D(target, GLint(level), format, width, height, 0, GLsizei(image.levels[level].size()), image.levels[level].data());
+		width = glm::max(1, width / 2);
+		height = glm::max(1, height / 2);
+	}
+}
+
+std::string getCompressedPath(const std::string& sourcePath) {
+	size_t dot = sourcePath.find_last_of('.');
+	size_t slash = sourcePath.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+		return sourcePath + ".dds";
+	}
+	return sourcePath.substr(0, dot) + ".dds";
+}
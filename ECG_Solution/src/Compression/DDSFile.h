@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include "BlockCompression.h"
+
+/*!
+ * A block compressed image with its complete mip chain, rows are stored top to bottom
+ */
+struct CompressedImage {
+	BlockFormat format = BlockFormat::BC1;
+	int width = 0;
+	int height = 0;
+	std::vector<std::vector<unsigned char>> levels;
+};
+
+/*!
+ * Reads a DDS file with DXT1, DXT5 or ATI2 (BC5) data
+ * @param firstLevel: levels before this one are skipped and left empty, so only the small levels can be read
+ * @return if the file exists and could be read
+ */
+bool readDDS(const std::string& path, CompressedImage& image, int firstLevel = 0);
+
+/*!
+ * @return size of one level of the image in bytes
+ */
+size_t getLevelSize(const CompressedImage& image, int level);
+
+/*!
+ * Writes the image and all its levels as DDS file
+ * @return if the file could be written
+ */
+bool writeDDS(const std::string& path, const CompressedImage& image);
+
+/*!
+ * Flips all levels upside down without decoding them (needed for bottom-up loaders like FreeImage)
+ * @return false if a level height is neither a multiple of 4 nor smaller than 4, the image is unchanged then
+ */
+bool flipCompressedImage(CompressedImage& image);
+
+/*!
+ * @return the OpenGL internal format of the block format
+ */
+GLenum getCompressedFormat(BlockFormat format);
+
+/*!
+ * Uploads all levels to the bound texture with glCompressedTexImage2D, no mipmaps are generated at runtime
+ * @param target: GL_TEXTURE_2D or one face of the bound cube map
+ */
+void uploadCompressedImage(GLenum target, const CompressedImage& image);
+
+/*!
+ * @return path of the compressed texture that belongs to a source image, e.g. "a/b.png" -> "a/b.dds"
+ */
+std::string getCompressedPath(const std::string& sourcePath);
@@ -0,0 +1,174 @@
+#include "LZ4.h"
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+	const int HASH_BITS = 16;
+	const size_t MIN_MATCH = 4;
+	const size_t MAX_OFFSET = 65535;
+	// the format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+	const size_t LAST_LITERALS = 5;
+	const size_t MATCH_START_LIMIT = 12;
+
+	uint32_t read32(const unsigned char* p) {
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t hash(uint32_t sequence) {
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	void writeLength(unsigned char*& out, size_t length) {
+		while (length >= 255) {
+			*out++ = 255;
+			length -= 255;
+		}
+		*out++ = static_cast<unsigned char>(length);
+	}
+
+	bool readLength(const unsigned char*& in, const unsigned char* end, size_t& length) {
+		unsigned char byte;
+		do {
+			if (in >= end) {
+				return false;
+			}
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	/*
+	 * Writes literals followed by a match, matchLength 0 writes the literals of the last sequence
+	 */
+	bool writeSequence(unsigned char*& out, const unsigned char* end, const unsigned char* literals, size_t literalCount, size_t offset, size_t matchLength) {
+		size_t worstCase = 1 + literalCount / 255 + 1 + literalCount + 2 + matchLength / 255 + 1;
+		if (worstCase > size_t(end - out)) {
+			return false;
+		}
+		unsigned char* token = out++;
+		*token = static_cast<unsigned char>((literalCount < 15 ? literalCount : 15) << 4);
+		if (literalCount >= 15) {
+			writeLength(out, literalCount - 15);
+		}
+		std::memcpy(out, literals, literalCount);
+		out += literalCount;
+		if (matchLength == 0) {
+			return true;
+		}
+
+		*out++ = static_cast<unsigned char>(offset & 0xFF);
+		*out++ = static_cast<unsigned char>(offset >> 8);
+		size_t length = matchLength - MIN_MATCH;
+		*token |= static_cast<unsigned char>(length < 15 ? length : 15);
+		if (length >= 15) {
+			writeLength(out, length - 15);
+		}
+		return true;
+	}
+
+}
+
+size_t lz4CompressBound(size_t size) {
+	return size + size / 255 + 16;
+}
+
+size_t lz4Compress(const unsigned char* source, size_t size, unsigned char* destination, size_t capacity) {
+	unsigned char* out = destination;
+	const unsigned char* end = destination + capacity;
+	size_t anchor = 0;
+
+	if (size > MATCH_START_LIMIT) {
+		// positions of the last 4 byte sequences, stale entries are caught by comparing the bytes
+		std::vector<size_t> table(size_t(1) << HASH_BITS, 0);
+		size_t matchEnd = size - LAST_LITERALS;
+		size_t i = 0;
+		while (i < size - MATCH_START_LIMIT) {
+			uint32_t sequence = read32(source + i);
+			uint32_t slot = hash(sequence);
+			size_t candidate = table[slot];
+			table[slot] = i;
+			if (candidate >= i || i - candidate > MAX_OFFSET || read32(source + candidate) != sequence) {
+				i++;
+				continue;
+			}
+
+			size_t length = MIN_MATCH;
+			while (i + length < matchEnd && source[candidate + length] == source[i + length]) {
+				length++;
+			}
+			while (i > anchor && candidate > 0 && source[i - 1] == source[candidate - 1]) {
+				i--;
+				candidate--;
+				length++;
+			}
+			if (!writeSequence(out, end, source + anchor, i - anchor, i - candidate, length)) {
+				return 0;
+			}
+			i += length;
+			anchor = i;
+		}
+	}
+
+	if (!writeSequence(out, end, source + anchor, size - anchor, 0, 0)) {
+		return 0;
+	}
+	return size_t(out - destination);
+}
+
+bool lz4Decompress(const unsigned char* source, size_t size, unsigned char* destination, size_t decompressedSize) {
+	const unsigned char* in = source;
+	const unsigned char* inEnd = source + size;
+	unsigned char* out = destination;
+	unsigned char* outEnd = destination + decompressedSize;
+
+	while (in < inEnd) {
+		unsigned char token = *in++;
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !readLength(in, inEnd, literalCount)) {
+			return false;
+		}
+		if (literalCount > size_t(inEnd - in) || literalCount > size_t(outEnd - out)) {
+			return false;
+		}
+		std::memcpy(out, in, literalCount);
+		in += literalCount;
+		out += literalCount;
+		if (in == inEnd) {
+			break;	// the last sequence has no match
+		}
+
+		if (inEnd - in < 2) {
+			return false;
+		}
+		size_t offset = size_t(in[0]) | (size_t(in[1]) << 8);
+		in += 2;
+		if (offset == 0 || offset > size_t(out - destination)) {
+			return false;
+		}
+		size_t length = token & 15;
+		if (length == 15 && !readLength(in, inEnd, length)) {
+			return false;
+		}
+		length += MIN_MATCH;
+		if (length > size_t(outEnd - out)) {
+			return false;
+		}
+		const unsigned char* match = out - offset;
+		if (offset >= length) {
+			std::memcpy(out, match, length);
+		}
+		else {
+			// overlapping matches repeat the last offset bytes
+			for (size_t i = 0; i < length; i++) {
+				out[i] = match[i];
+			}
+		}
+		out += length;
+	}
+	return out == outEnd;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+
+/*
+ * LZ4 block format (no frame header): sequences of literals and back references into the last 64 KB.
+ * Decoding is a few copies per sequence, so it runs at memory speed and is used for the asset archive.
+ */
+
+/*!
+ * @return the largest size lz4Compress can write for an input of the given size
+ */
+size_t lz4CompressBound(size_t size);
+
+/*!
+ * Compresses a block with a greedy single probe match finder
+ * @param capacity: size of destination, lz4CompressBound(size) always suffices
+ * @return compressed size, 0 if destination is too small
+ */
+size_t lz4Compress(const unsigned char* source, size_t size, unsigned char* destination, size_t capacity);
+
+/*!
+ * Decompresses a block, corrupt input never reads or writes outside the buffers
+ * @param decompressedSize: the exact size of the original data
+ * @return false if the block is corrupt or does not decompress to decompressedSize bytes
+ */
+bool lz4Decompress(const unsigned char* source, size_t size, unsigned char* destination, size_t decompressedSize);
@@ -0,0 +1,247 @@
+#include "TextureConverter.h"
+#include <iostream>
+#include <cmath>
+#include <cctype>
+#include <chrono>
+#include <sys/stat.h>
+#include <glm/glm.hpp>
+#include "../stb_image.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace {
+
+	float srgbToLinear[256];
+	bool srgbTableReady = false;
+
+	void initSrgbTable() {
+		if (srgbTableReady) {
+			return;
+		}
+		for (int i = 0; i < 256; i++) {
+			float c = i / 255.0f;
+			srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		srgbTableReady = true;
+	}
+
+	unsigned char linearToSrgb(float c) {
+		c = glm::clamp(c, 0.0f, 1.0f);
+		float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		return static_cast<unsigned char>(s * 255.0f + 0.5f);
+	}
+
+	unsigned char toByte(float c) {
+		return static_cast<unsigned char>(glm::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	bool isNormalMap(const std::string& path) {
+		std::string stem = path.substr(0, path.find_last_of('.'));
+		const std::string suffix = "_normal";
+		return stem.size() >= suffix.size() && stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	bool isSourceImage(const std::string& name) {
+		size_t dot = name.find_last_of('.');
+		if (dot == std::string::npos) {
+			return false;
+		}
+		std::string extension = name.substr(dot + 1);
+		for (char& c : extension) {
+			c = static_cast<char>(tolower(c));
+		}
+		return extension == "png" || extension == "jpg" || extension == "jpeg" || extension == "tga" || extension == "bmp";
+	}
+
+	bool getModificationTime(const std::string& path, time_t& time) {
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0) {
+			return false;
+		}
+		time = info.st_mtime;
+		return true;
+	}
+
+	std::vector<std::string> listImages(const std::string& directory) {
+		std::vector<std::string> files;
+#ifdef _WIN32
+		_finddata_t data;
+		intptr_t handle = _findfirst((directory + "/*").c_str(), &data);
+		if (handle == -1) {
+			return files;
+		}
+		do {
+			if (!(data.attrib & _A_SUBDIR) && isSourceImage(data.name)) {
+				files.push_back(directory + "/" + data.name);
+			}
+		} while (_findnext(handle, &data) == 0);
+		_findclose(handle);
+#else
+		DIR* dir = opendir(directory.c_str());
+		if (dir == nullptr) {
+			return files;
+		}
+		while (dirent* entry = readdir(dir)) {
+			if (isSourceImage(entry->d_name)) {
+				files.push_back(directory + "/" + entry->d_name);
+			}
+		}
+		closedir(dir);
+#endif
+		return files;
+	}
+
+}
+
+TextureConverter::TextureConverter(ThreadPool& pool) : pool(pool) {
+	initSrgbTable();
+}
+
+TextureConverter::~TextureConverter() {}
+
+void TextureConverter::buildMipChain(std::vector<std::vector<unsigned char>>& levels, int width, int height, BlockFormat format) {
+	while (width > 1 || height > 1) {
+		const std::vector<unsigned char>& source = levels.back();
+		int sourceWidth = width;
+		int sourceHeight = height;
+		width = glm::max(1, width / 2);
+		height = glm::max(1, height / 2);
+		std::vector<unsigned char> level(size_t(width) * height * 4);
+
+		// 2x2 box filter: colors are averaged in linear space and weighted by alpha,
+		// so transparent texels do not bleed their color into the smaller levels; normals are renormalized
+		pool.parallelFor(height, [&](int y) {
+			for (int x = 0; x < width; x++) {
+				glm::vec3 color = glm::vec3(0.0f);
+				glm::vec3 unweighted = glm::vec3(0.0f);
+				float alpha = 0.0f;
+				for (int j = 0; j < 2; j++) {
+					int sy = glm::min(2 * y + j, sourceHeight - 1);
+					for (int i = 0; i < 2; i++) {
+						int sx = glm::min(2 * x + i, sourceWidth - 1);
+						const unsigned char* p = &source[(size_t(sy) * sourceWidth + sx) * 4];
+						float a = p[3] / 255.0f;
+						glm::vec3 c;
+						if (format == BlockFormat::BC5) {
+							c = glm::vec3(p[0], p[1], p[2]) / 255.0f * 2.0f - 1.0f;
+						}
+						else {
+							c = glm::vec3(srgbToLinear[p[0]], srgbToLinear[p[1]], srgbToLinear[p[2]]);
+						}
+						color += c * a;
+						unweighted += c;
+						alpha += a;
+					}
+				}
+
+				unsigned char* out = &level[(size_t(y) * width + x) * 4];
+				if (format == BlockFormat::BC5) {
+					glm::vec3 normal = unweighted;
+					normal = glm::length(normal) > 1e-6f ? glm::normalize(normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+					out[0] = toByte(normal.x * 0.5f + 0.5f);
+					out[1] = toByte(normal.y * 0.5f + 0.5f);
+					out[2] = toByte(normal.z * 0.5f + 0.5f);
+					out[3] = 255;
+				}
+				else {
+					color = alpha > 0.0f ? color / alpha : unweighted / 4.0f;
+					out[0] = linearToSrgb(color.r);
+					out[1] = linearToSrgb(color.g);
+					out[2] = linearToSrgb(color.b);
+					out[3] = toByte(alpha / 4.0f);
+				}
+			}
+		});
+		levels.push_back(std::move(level));
+	}
+}
+
+bool TextureConverter::convert(const std::string& sourcePath, bool force) {
+	std::string targetPath = getCompressedPath(sourcePath);
+	time_t sourceTime, targetTime;
+	if (!getModificationTime(sourcePath, sourceTime)) {
+		std::cout << "Could not find image: " << sourcePath << std::endl;
+		return false;
+	}
+	if (!force && getModificationTime(targetPath, targetTime) && targetTime >= sourceTime) {
+		return true;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	int width, height, channels;
+	unsigned char* data = stbi_load(sourcePath.c_str(), &width, &height, &channels, 4);
+	if (data == nullptr) {
+		std::cout << "Failed to load image " << sourcePath << std::endl;
+		return false;
+	}
+
+	CompressedImage image;
+	image.width = width;
+	image.height = height;
+	if (isNormalMap(sourcePath)) {
+		image.format = BlockFormat::BC5;
+	}
+	else {
+		image.format = BlockFormat::BC1;
+		for (size_t i = 0; i < size_t(width) * height; i++) {
+			if (data[i * 4 + 3] < 255) {
+				image.format = BlockFormat::BC3;
+				break;
+			}
+		}
+	}
+
+	std::vector<std::vector<unsigned char>> levels;
+	levels.push_back(std::vector<unsigned char>(data, data + size_t(width) * height * 4));
+	stbi_image_free(data);
+	buildMipChain(levels, width, height, image.format);
+
+	image.levels.resize(levels.size());
+	int levelWidth = width;
+	int levelHeight = height;
+	size_t compressedSize = 0;
+	for (size_t i = 0; i < levels.size(); i++) {
+		compressImage(pool, image.format, levels[i].data(), levelWidth, levelHeight, image.levels[i]);
+		compressedSize += image.levels[i].size();
+		levelWidth = glm::max(1, levelWidth / 2);
+		levelHeight = glm::max(1, levelHeight / 2);
+	}
+
+	if (!writeDDS(targetPath, image)) {
+		return false;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	const char* formatNames[] = { "BC1", "BC3", "BC5" };
+	std::cout << targetPath << ": " << width << "x" << height << " " << formatNames[int(image.format)] << ", "
+		<< levels.size() << " levels, " << compressedSize / 1024 << " KB (" << (size_t(width) * height * 4 * 4 / 3) / 1024
+		<< " KB uncompressed), " << ms << " ms" << std::endl;
+	return true;
+}
+
+int TextureConverter::convertDirectory(const std::string& directory, bool force) {
+	int converted = 0;
+	for (const std::string& file : listImages(directory)) {
+		if (convert(file, force)) {
+			converted++;
+		}
+	}
+	return converted;
+}
+
+void TextureConverter::convertAssets(bool force) {
+	// the heightmap and the masks in assets/terrain are read on the CPU and stay uncompressed
+	const char* directories[] = { "assets/textures", "assets/terrain/textures", "assets/flares", "assets/skybox" };
+	auto start = std::chrono::high_resolution_clock::now();
+	int converted = 0;
+	for (const char* directory : directories) {
+		converted += convertDirectory(directory, force);
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << converted << " textures up to date in " << ms << " ms on " << pool.getThreadCount() + 1 << " threads" << std::endl;
+}
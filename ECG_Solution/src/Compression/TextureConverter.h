@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+#include "DDSFile.h"
+#include "../Jobs/ThreadPool.h"
+
+/*!
+ * Offline conversion of png/jpg textures to block compressed DDS files with a full mip chain.
+ * The DDS file is written next to the source (same name, .dds extension) and is preferred by the texture loaders.
+ * Opaque images become BC1, images with alpha BC3 and normal maps (name ends with "_normal") BC5.
+ */
+class TextureConverter {
+private:
+	ThreadPool& pool;
+
+	void buildMipChain(std::vector<std::vector<unsigned char>>& levels, int width, int height, BlockFormat format);
+
+public:
+	/*!
+	 * @param pool: mip generation and block compression run on this pool
+	 */
+	TextureConverter(ThreadPool& pool);
+	~TextureConverter();
+
+	/*!
+	 * Converts one image
+	 * @param sourcePath: png/jpg image
+	 * @param force: convert even if the DDS file is newer than the source
+	 * @return if the DDS file is up to date afterwards
+	 */
+	bool convert(const std::string& sourcePath, bool force);
+
+	/*!
+	 * Converts all png/jpg images in a directory (not recursive)
+	 * @return number of converted or already up to date images
+	 */
+	int convertDirectory(const std::string& directory, bool force);
+
+	/*!
+	 * Converts the texture directories of the game
+	 */
+	void convertAssets(bool force);
+};
@@ -0,0 +1,443 @@
+#include "Crowd.h"
+#include "FlowField.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define CROWD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+	const float EDGE_MARGIN = 10.0f;			// enemies stay this far inside the terrain
+
+	const float KNOCK_BACK_DECAY = 1.0f;
+	const float GRAVITY_PUSH = 98.0f;			// pulls controllers down that have no ground probe
+	const float PROBE_DEPTH = 5.0f;				// how far below its feet a probe looks for ground
+
+	const float SEPARATION_RADIUS = 6.0f;
+	const float SEPARATION_SPEED = 10.0f;
+	const int MAX_NEIGHBORS = 16;				// a dense crowd only pushes against the first few
+	const int CELLS = 256;						// of the spatial hash per axis, SEPARATION_RADIUS wide
+
+	unsigned int padded(unsigned int count) {
+		return (count + 3) & ~3u;
+	}
+
+	void setCollision(physx::PxController* controller, bool enabled) {
+		physx::PxRigidDynamic* actor = controller->getActor();
+		physx::PxShape* shapes[4];
+		physx::PxU32 shapeCount = actor->getShapes(shapes, 4);
+		for (physx::PxU32 i = 0; i < shapeCount; i++) {
+			shapes[i]->setFlag(physx::PxShapeFlag::eSCENE_QUERY_SHAPE, enabled);
+			shapes[i]->setFlag(physx::PxShapeFlag::eSIMULATION_SHAPE, enabled);
+		}
+	}
+}
+
+const float Crowd::PROMOTE_DISTANCE = 60.0f;
+const float Crowd::DEMOTE_DISTANCE = 80.0f;
+
+Crowd::Crowd()
+	: count(0), scheduler(100.0f, 250.0f, 500.0f), grid(SEPARATION_RADIUS, CELLS), boundsMin(0.0f), boundsMax(0.0f) {
+}
+
+void Crowd::setUpdateDistances(float nearDistance, float middleDistance, float farDistance) {
+	// promoted agents move their controller every step
+	scheduler.setDistances(std::max(nearDistance, DEMOTE_DISTANCE), middleDistance, farDistance);
+}
+
+unsigned int Crowd::add(const glm::vec3& position, physx::PxController* controller, float offset) {
+	unsigned int agent = count++;
+	unsigned int size = padded(count);
+	for (std::vector<float>* values : { &positionX, &positionY, &positionZ, &velocityX, &velocityZ, &knockBackX, &knockBackZ,
+		&targetX, &targetZ, &walkX, &walkZ, &speed }) {
+		values->resize(size, 0.0f);
+	}
+	heading.push_back(0.0f);
+	groundOffset.push_back(offset);
+	hp.push_back(0);
+	maxHp.push_back(0);
+	damage.push_back(0);
+	active.push_back(0);
+	hasSeenPlayer.push_back(0);
+	promoted.push_back(0);
+	controllers.push_back(controller);
+	groundProbes.push_back(-1);
+	elapsed.push_back(0.0f);
+	scheduler.add();
+	pushX.push_back(0.0f);
+	pushZ.push_back(0.0f);
+	freeAgents.push_back(agent);
+
+	resetStats(agent);
+	positionX[agent] = position.x;
+	positionY[agent] = position.y;
+	positionZ[agent] = position.z;
+	if (controller) {
+		setCollision(controller, false);
+	}
+	return agent;
+}
+
+void Crowd::resetStats(unsigned int agent) {
+	hp[agent] = 50;
+	maxHp[agent] = 50;
+	damage[agent] = 5;
+	speed[agent] = 20.0f;
+	velocityX[agent] = 0.0f;
+	velocityZ[agent] = 0.0f;
+	walkX[agent] = 0.0f;
+	walkZ[agent] = 0.0f;
+	knockBackX[agent] = 0.0f;
+	knockBackZ[agent] = 0.0f;
+}
+
+void Crowd::think(unsigned int first, unsigned int end, const glm::vec3& playerPos, float dt, const HeightField& heightField,
+	const FlowField* flowField) {
+	// enemies know where the player starts, afterwards they only follow what they can see
+	glm::vec3 playerEye = playerPos + glm::vec3(0, 2, 0);
+	for (unsigned int i = first; i < end; i++) {
+		if (!active[i] || !scheduler.isDue(i)) {
+			elapsed[i] = 0.0f;
+			continue;
+		}
+		elapsed[i] = scheduler.getElapsed(i, dt);
+		glm::vec3 eye(positionX[i], positionY[i] + 5.0f, positionZ[i]);
+		bool seesPlayer = heightField.hasLineOfSight(eye, playerEye);
+		glm::vec2 flow(0.0f);
+		if (!hasSeenPlayer[i] || seesPlayer) {
+			targetX[i] = playerPos.x;
+			targetZ[i] = playerPos.z;
+			hasSeenPlayer[i] = 1;
+			// the field leads to the player, not to where an agent saw the player last
+			if (flowField) {
+				flow = flowField->sample(positionX[i], positionZ[i]);
+			}
+		}
+
+		// agents within one unit of the last known position wait there, the knock back moves them anyway
+		// agents with a flow direction follow it instead of walking straight at the target
+		float dx = targetX[i] - positionX[i];
+		float dz = targetZ[i] - positionZ[i];
+		float lengthSq = dx * dx + dz * dz;
+		walkX[i] = 0.0f;
+		walkZ[i] = 0.0f;
+		if (lengthSq >= 1.0f) {
+			glm::vec2 direction = flow.x != 0.0f || flow.y != 0.0f ? flow : glm::vec2(dx, dz) / std::sqrt(lengthSq);
+			walkX[i] = direction.x * speed[i];
+			walkZ[i] = direction.y * speed[i];
+			heading[i] = 90.0f + glm::degrees(std::atan2(-direction.y, direction.x));
+		}
+
+		float playerX = positionX[i] - playerPos.x;
+		float playerZ = positionZ[i] - playerPos.z;
+		scheduler.updated(i, std::sqrt(playerX * playerX + playerZ * playerZ), seesPlayer);
+	}
+}
+
+void Crowd::integrate(unsigned int first, unsigned int end, float dt) {
+	// every agent moves every step, those that did not think keep walking the way they chose last, free agents have
+	// neither walk nor knock back
+#ifdef CROWD_SSE2
+	const __m128 step = _mm_set1_ps(dt);
+	const __m128 decay = _mm_set1_ps(1.0f - KNOCK_BACK_DECAY * dt);
+	const __m128 minX = _mm_set1_ps(boundsMin.x);
+	const __m128 maxX = _mm_set1_ps(boundsMax.x);
+	const __m128 minZ = _mm_set1_ps(boundsMin.y);
+	const __m128 maxZ = _mm_set1_ps(boundsMax.y);
+	for (unsigned int i = first; i < padded(end); i += 4) {
+		__m128 kx = _mm_loadu_ps(&knockBackX[i]);
+		__m128 kz = _mm_loadu_ps(&knockBackZ[i]);
+		__m128 vx = _mm_add_ps(_mm_loadu_ps(&walkX[i]), kx);
+		__m128 vz = _mm_add_ps(_mm_loadu_ps(&walkZ[i]), kz);
+		__m128 x = _mm_add_ps(_mm_loadu_ps(&positionX[i]), _mm_mul_ps(vx, step));
+		__m128 z = _mm_add_ps(_mm_loadu_ps(&positionZ[i]), _mm_mul_ps(vz, step));
+
+		_mm_storeu_ps(&positionX[i], _mm_min_ps(_mm_max_ps(x, minX), maxX));
+		_mm_storeu_ps(&positionZ[i], _mm_min_ps(_mm_max_ps(z, minZ), maxZ));
+		_mm_storeu_ps(&velocityX[i], vx);
+		_mm_storeu_ps(&velocityZ[i], vz);
+		_mm_storeu_ps(&knockBackX[i], _mm_mul_ps(kx, decay));
+		_mm_storeu_ps(&knockBackZ[i], _mm_mul_ps(kz, decay));
+	}
+#else
+	for (unsigned int i = first; i < end; i++) {
+		velocityX[i] = walkX[i] + knockBackX[i];
+		velocityZ[i] = walkZ[i] + knockBackZ[i];
+		positionX[i] = glm::clamp(positionX[i] + velocityX[i] * dt, boundsMin.x, boundsMax.x);
+		positionZ[i] = glm::clamp(positionZ[i] + velocityZ[i] * dt, boundsMin.y, boundsMax.y);
+		knockBackX[i] *= 1.0f - KNOCK_BACK_DECAY * dt;
+		knockBackZ[i] *= 1.0f - KNOCK_BACK_DECAY * dt;
+	}
+#endif
+}
+
+void Crowd::separate(unsigned int first, unsigned int end) {
+	const float radiusSq = SEPARATION_RADIUS * SEPARATION_RADIUS;
+	for (unsigned int i = first; i < end; i++) {
+		pushX[i] = 0.0f;
+		pushZ[i] = 0.0f;
+		// promoted agents are kept apart by their controllers, agents that are not due keep their way
+		if (promoted[i] || elapsed[i] == 0.0f) {
+			continue;
+		}
+		int neighbors = 0;
+		grid.visit(positionX[i], positionZ[i], SEPARATION_RADIUS, [&](unsigned int slot) {
+			float dx = positionX[i] - grid.getX(slot);
+			float dz = positionZ[i] - grid.getZ(slot);
+			float distanceSq = dx * dx + dz * dz;
+			if (grid.getIndex(slot) == i || distanceSq >= radiusSq || distanceSq < 1e-6f) {
+				return true;
+			}
+			float distance = std::sqrt(distanceSq);
+			float strength = (SEPARATION_RADIUS - distance) / (SEPARATION_RADIUS * distance);
+			pushX[i] += dx * strength;
+			pushZ[i] += dz * strength;
+			return ++neighbors < MAX_NEIGHBORS;
+		});
+		pushX[i] *= SEPARATION_SPEED * elapsed[i];
+		pushZ[i] *= SEPARATION_SPEED * elapsed[i];
+	}
+}
+
+void Crowd::settle(unsigned int first, unsigned int end, const HeightField& heightField) {
+	for (unsigned int i = first; i < end; i++) {
+		if (promoted[i] || !active[i]) {
+			continue;
+		}
+		positionX[i] = glm::clamp(positionX[i] + pushX[i], boundsMin.x, boundsMax.x);
+		positionZ[i] = glm::clamp(positionZ[i] + pushZ[i], boundsMin.y, boundsMax.y);
+		positionY[i] = heightField.getHeight(positionX[i], positionZ[i]) + groundOffset[i];
+	}
+}
+
+void Crowd::probeGround(SceneQueryBatch& queries) {
+	for (unsigned int i = 0; i < count; i++) {
+		groundProbes[i] = -1;
+		if (promoted[i] && scheduler.isDue(i)) {
+			groundProbes[i] = queries.addRaycast(getPosition(i), glm::vec3(0, -1, 0), groundOffset[i] + PROBE_DEPTH);
+		}
+	}
+}
+
+void Crowd::update(const glm::vec3& playerPos, float dt, const HeightField& heightField, const FlowField* flowField,
+	const SceneQueryBatch* queries, ThreadPool& pool) {
+	if (count == 0) {
+		return;
+	}
+	getBounds(heightField, boundsMin, boundsMax);
+	int batches = int((count + BATCH_SIZE - 1) / BATCH_SIZE);
+	pool.parallelFor(batches, [&](int batch) {
+		unsigned int first = static_cast<unsigned int>(batch) * BATCH_SIZE;
+		unsigned int end = std::min(first + BATCH_SIZE, count);
+		think(first, end, playerPos, dt, heightField, flowField);
+		integrate(first, end, dt);
+	});
+
+	// the push of every agent is computed from the same positions, then applied
+	grid.build(positionX.data(), positionY.data(), positionZ.data(), count, active.data());
+	pool.parallelFor(batches, [&](int batch) {
+		unsigned int first = static_cast<unsigned int>(batch) * BATCH_SIZE;
+		separate(first, std::min(first + BATCH_SIZE, count));
+	});
+	pool.parallelFor(batches, [&](int batch) {
+		unsigned int first = static_cast<unsigned int>(batch) * BATCH_SIZE;
+		settle(first, std::min(first + BATCH_SIZE, count), heightField);
+	});
+
+	// PhysX controllers can not be moved from several threads, there are only a few of them
+	for (unsigned int i = 0; i < count; i++) {
+		if (!controllers[i] || !active[i]) {
+			continue;
+		}
+		float dx = positionX[i] - playerPos.x;
+		float dz = positionZ[i] - playerPos.z;
+		float distanceSq = dx * dx + dz * dz;
+		if (!promoted[i] && distanceSq < PROMOTE_DISTANCE * PROMOTE_DISTANCE) {
+			setPromoted(i, true);
+		}
+		else if (promoted[i] && distanceSq > DEMOTE_DISTANCE * DEMOTE_DISTANCE) {
+			setPromoted(i, false);
+		}
+		if (!promoted[i] || elapsed[i] == 0.0f) {
+			continue;
+		}
+		// the controller walks where the agent went since it was due last and stops at the player and the level, its
+		// probe found the ground where it stood at the start of the step
+		float fall = -GRAVITY_PUSH * elapsed[i];
+		float groundDistance;
+		if (queries && queries->getRaycastHit(groundProbes[i], groundDistance)) {
+			fall = glm::max(groundOffset[i] - groundDistance, fall);
+		}
+		physx::PxExtendedVec3 current = controllers[i]->getPosition();
+		physx::PxVec3 displacement(float(positionX[i] - current.x), fall, float(positionZ[i] - current.z));
+		controllers[i]->move(displacement, 0.001f, elapsed[i], physx::PxControllerFilters());
+		physx::PxExtendedVec3 position = controllers[i]->getPosition();
+		positionX[i] = float(position.x);
+		positionY[i] = float(position.y);
+		positionZ[i] = float(position.z);
+	}
+
+	// queries of the game see where the agents ended this step
+	grid.build(positionX.data(), positionY.data(), positionZ.data(), count, active.data());
+	scheduler.advance();
+}
+
+void Crowd::setPromoted(unsigned int agent, bool promote) {
+	promoted[agent] = promote ? 1 : 0;
+	if (promote) {
+		// starts where the agent walked on the heightfield
+		controllers[agent]->setPosition(physx::PxExtendedVec3(positionX[agent], positionY[agent], positionZ[agent]));
+	}
+	setCollision(controllers[agent], promote);
+}
+
+void Crowd::place(unsigned int agent, const glm::vec3& position) {
+	positionX[agent] = position.x;
+	positionY[agent] = position.y;
+	positionZ[agent] = position.z;
+	velocityX[agent] = 0.0f;
+	velocityZ[agent] = 0.0f;
+	walkX[agent] = 0.0f;
+	walkZ[agent] = 0.0f;
+	knockBackX[agent] = 0.0f;
+	knockBackZ[agent] = 0.0f;
+	scheduler.wake(agent);
+	if (promoted[agent]) {
+		controllers[agent]->setPosition(physx::PxExtendedVec3(position.x, position.y, position.z));
+	}
+}
+
+void Crowd::hit(unsigned int agent, int amount, const glm::vec3& direction, float knockBackFactor) {
+	hp[agent] -= amount;
+	knockBackX[agent] = knockBackFactor * speed[agent] * direction.x;
+	knockBackZ[agent] = knockBackFactor * speed[agent] * direction.z;
+}
+
+int Crowd::spawn(const glm::vec3& position, unsigned int level) {
+	if (freeAgents.empty()) {
+		return -1;
+	}
+	unsigned int agent = freeAgents.back();
+	freeAgents.pop_back();
+
+	resetStats(agent);
+	maxHp[agent] += 5 * int(level);
+	hp[agent] = maxHp[agent];
+	damage[agent] += int(level);
+	speed[agent] += 0.2f * float(level);
+	place(agent, position + glm::vec3(0.0f, groundOffset[agent], 0.0f));
+	hasSeenPlayer[agent] = 0;
+	active[agent] = 1;
+	return int(agent);
+}
+
+void Crowd::despawn(unsigned int agent) {
+	if (!active[agent]) {
+		return;
+	}
+	if (promoted[agent]) {
+		setPromoted(agent, false);
+	}
+	active[agent] = 0;
+	walkX[agent] = 0.0f;
+	walkZ[agent] = 0.0f;
+	knockBackX[agent] = 0.0f;
+	knockBackZ[agent] = 0.0f;
+	// within the capacity reserved by add()
+	freeAgents.push_back(agent);
+}
+
+unsigned int Crowd::size() const {
+	return count;
+}
+
+unsigned int Crowd::getActiveCount() const {
+	return count - static_cast<unsigned int>(freeAgents.size());
+}
+
+bool Crowd::isActive(unsigned int agent) const {
+	return active[agent] != 0;
+}
+
+glm::vec3 Crowd::getPosition(unsigned int agent) const {
+	return glm::vec3(positionX[agent], positionY[agent], positionZ[agent]);
+}
+
+float Crowd::getHeading(unsigned int agent) const {
+	return heading[agent];
+}
+
+int Crowd::getHp(unsigned int agent) const {
+	return hp[agent];
+}
+
+int Crowd::getMaxHp(unsigned int agent) const {
+	return maxHp[agent];
+}
+
+int Crowd::getDamage(unsigned int agent) const {
+	return damage[agent];
+}
+
+bool Crowd::isPromoted(unsigned int agent) const {
+	return promoted[agent] != 0;
+}
+
+physx::PxController* Crowd::getController(unsigned int agent) const {
+	return controllers[agent];
+}
+
+const SpatialHash& Crowd::getSpatialHash() const {
+	return grid;
+}
+
+void Crowd::getBounds(const HeightField& heightField, glm::vec2& minimum, glm::vec2& maximum) {
+	// the terrain covers x from 0 to its dimension and z from minus its dimension to 0
+	float dimension = heightField.getDimension();
+	float margin = std::min(EDGE_MARGIN, dimension / 2.0f);
+	minimum = glm::vec2(margin, margin - dimension);
+	maximum = glm::vec2(dimension - margin, -margin);
+}
+
+void Crowd::benchmark(const HeightField& heightField, ThreadPool& pool) {
+	unsigned int counts[] = { 1000, 2000, 4000, 8000, 16000 };
+	const int warmup = 10;
+	const int measured = 60;
+	const float dt = 1.0f / 60.0f;
+	glm::vec3 player(512.0f, heightField.getHeight(512.0f, -512.0f), -512.0f);
+
+	std::cout << "Crowd benchmark, " << pool.getThreadCount() << " workers" << std::endl;
+	std::cout << std::setw(8) << "agents" << std::setw(14) << "ms/update" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	for (unsigned int agents : counts) {
+		Crowd crowd;
+		std::mt19937 random(1);
+		glm::vec2 minimum, maximum;
+		getBounds(heightField, minimum, maximum);
+		std::uniform_real_distribution<float> x(minimum.x, maximum.x);
+		std::uniform_real_distribution<float> z(minimum.y, maximum.y);
+		for (unsigned int i = 0; i < agents; i++) {
+			float spawnX = x(random);
+			float spawnZ = z(random);
+			glm::vec3 ground(spawnX, heightField.getHeight(spawnX, spawnZ), spawnZ);
+			crowd.add(ground, nullptr, 5.0f);
+			crowd.spawn(ground, 0);
+		}
+		for (int i = 0; i < warmup; i++) {
+			crowd.update(player, dt, heightField, nullptr, nullptr, pool);
+		}
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < measured; i++) {
+			crowd.update(player, dt, heightField, nullptr, nullptr, pool);
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		std::cout << std::setw(8) << agents << std::setw(14) << ms / measured << std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+}
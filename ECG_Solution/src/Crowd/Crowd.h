@@ -0,0 +1,157 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <PxPhysicsAPI.h>
+#include "../Terrain/HeightField.h"
+#include "../Jobs/ThreadPool.h"
+#include "SpatialHash.h"
+#include "UpdateScheduler.h"
+#include "../SceneQueryBatch.h"
+
+class FlowField;
+
+/*!
+ * Simulation state of all enemies, one array per value, so the movement handles four agents per SSE2
+ * instruction and runs in batches on the workers.
+ * Far agents only look for the player and steer every few steps, as the UpdateScheduler decides, and keep walking
+ * the way they chose in between.
+ * Agents far from the player walk on the heightfield and keep apart with a cheap separation push. Only agents near
+ * the player are promoted to their PhysX character controller, which collides with the player and the level; the
+ * controllers of all other agents are switched off, so PhysX does not pay for them.
+ * The agents are a fixed pool: all of them are added while loading, spawn() and despawn() only take an agent from
+ * the free list and put it back, so the game never allocates. Free agents stand still and are left out of the grid.
+ */
+class Crowd {
+private:
+	static const unsigned int BATCH_SIZE = 256;		// agents per worker job, a multiple of 4
+
+	unsigned int count;
+
+	// one entry per agent, padded to a multiple of 4 for the SIMD update
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> velocityX, velocityZ;
+	std::vector<float> knockBackX, knockBackZ;
+	std::vector<float> targetX, targetZ;		// where the player was seen last
+	std::vector<float> walkX, walkZ;			// velocity the agent chose when it was due last
+	std::vector<float> speed;
+
+	// one entry per agent
+	std::vector<float> heading;					// yaw in degrees
+	std::vector<float> groundOffset;			// height of the controller center above the ground
+	std::vector<int> hp, maxHp, damage;
+	std::vector<unsigned char> active, hasSeenPlayer, promoted;
+	std::vector<physx::PxController*> controllers;
+	std::vector<int> groundProbes;				// slot in the scene query batch, -1 without a probe
+	std::vector<float> elapsed;					// time since the last update of the agents due in this step, else 0
+	std::vector<unsigned int> freeAgents;		// used as a stack, its capacity is the pool
+
+	UpdateScheduler scheduler;
+
+	// separation, the grid is also queried by the game
+	SpatialHash grid;
+	std::vector<float> pushX, pushZ;
+
+	// x and z of the part of the terrain the agents stay on, taken from the height field of the update
+	glm::vec2 boundsMin, boundsMax;
+
+	void think(unsigned int first, unsigned int end, const glm::vec3& playerPos, float dt, const HeightField& heightField,
+		const FlowField* flowField);
+	void integrate(unsigned int first, unsigned int end, float dt);
+	void separate(unsigned int first, unsigned int end);
+	void settle(unsigned int first, unsigned int end, const HeightField& heightField);
+	void setPromoted(unsigned int agent, bool promote);
+	void resetStats(unsigned int agent);
+
+public:
+	static const float PROMOTE_DISTANCE;
+	static const float DEMOTE_DISTANCE;
+
+	Crowd();
+
+	/*!
+	 * Adds a free agent to the pool, called while loading
+	 * @param position: where the agent waits until it is spawned
+	 * @param controller: used while the agent is near the player, nullptr for agents that never collide
+	 * @param groundOffset: height of the controller center above the ground
+	 * @return index of the agent
+	 */
+	unsigned int add(const glm::vec3& position, physx::PxController* controller, float groundOffset);
+
+	/*!
+	 * Takes a free agent and puts it into the game, it has not seen the player yet
+	 * @param position: on the ground, the agent stands on it
+	 * @param level: 0 for the stats of the first wave, every level adds 5 hp, 1 damage and 0.2 speed
+	 * @return index of the agent, -1 if every agent of the pool is in the game
+	 */
+	int spawn(const glm::vec3& position, unsigned int level);
+
+	/*!
+	 * Takes the agent out of the game and back to the free list, its controller is switched off
+	 */
+	void despawn(unsigned int agent);
+
+	/*!
+	 * Distances from the player at which agents update every 2nd, 4th and 8th step, the near one is kept beyond the
+	 * promote distance
+	 */
+	void setUpdateDistances(float nearDistance, float middleDistance, float farDistance);
+
+	/*!
+	 * Adds a ray down from every promoted agent to the batch, the update snaps their controllers to the ground it hits
+	 */
+	void probeGround(SceneQueryBatch& queries);
+
+
+	/*!
+	 * Chases the player with every agent, the controllers of the promoted agents are moved on the calling thread
+	 * @param flowField: leads agents that see the player around slopes and obstacles, nullptr to walk straight
+	 * @param queries: executed batch with the ground probes, nullptr to let the controllers fall
+	 */
+	void update(const glm::vec3& playerPos, float dt, const HeightField& heightField, const FlowField* flowField,
+		const SceneQueryBatch* queries, ThreadPool& pool);
+
+	/*!
+	 * Damages an agent and pushes it away in the given direction
+	 */
+	void hit(unsigned int agent, int damage, const glm::vec3& direction, float knockBackFactor);
+
+	/*!
+	 * Moves an agent without chasing, its controller follows if it is promoted
+	 */
+	void place(unsigned int agent, const glm::vec3& position);
+
+	/*!
+	 * @return number of agents in the pool, free or not
+	 */
+	unsigned int size() const;
+
+	/*!
+	 * @return number of agents in the game
+	 */
+	unsigned int getActiveCount() const;
+	bool isActive(unsigned int agent) const;
+	glm::vec3 getPosition(unsigned int agent) const;
+	float getHeading(unsigned int agent) const;
+	int getHp(unsigned int agent) const;
+	int getMaxHp(unsigned int agent) const;
+	int getDamage(unsigned int agent) const;
+	bool isPromoted(unsigned int agent) const;
+	physx::PxController* getController(unsigned int agent) const;
+
+	/*!
+	 * Agents in the game bucketed where they ended the last update, indices are agents
+	 */
+	const SpatialHash& getSpatialHash() const;
+
+	/*!
+	 * Part of the terrain the agents stay on, a small margin inside its edges
+	 * @param minimum: smallest x and z
+	 * @param maximum: largest x and z
+	 */
+	static void getBounds(const HeightField& heightField, glm::vec2& minimum, glm::vec2& maximum);
+
+	/*!
+	 * Prints the update time of crowds with 1000 to 16000 agents, without controllers
+	 */
+	static void benchmark(const HeightField& heightField, ThreadPool& pool);
+};
@@ -0,0 +1,240 @@
+#include "FlowField.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <utility>
+
+namespace {
+	const unsigned int CACHE_MAGIC = 0x31574C46;	// "FLW1"
+
+	struct CacheHeader {
+		unsigned int magic;
+		int cells;
+		unsigned long long key;
+	};
+
+	// the first four neighbors are straight, the others diagonal
+	const int OFFSET_X[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+	const int OFFSET_Z[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+
+	void hashBytes(unsigned long long& hash, const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	}
+}
+
+FlowField::FlowField(const HeightField& heightField, const std::vector<glm::vec3>& obstacles, float cellSize, float maxSlope,
+	const std::string& cachePath)
+	: dimension(heightField.getDimension()), cellSize(cellSize), current(0), goal(-1), buildGoal(-1) {
+	cellsPerSide = std::max(1, int(std::ceil(dimension / cellSize)));
+	unsigned long long key = hash(heightField, obstacles, maxSlope);
+	if (cachePath.empty() || !loadCosts(cachePath, key)) {
+		computeCosts(heightField, obstacles, maxSlope);
+		if (!cachePath.empty()) {
+			saveCosts(cachePath, key);
+		}
+	}
+	fields[0].assign(costs.size(), glm::vec2(0.0f));
+	fields[1].assign(costs.size(), glm::vec2(0.0f));
+}
+
+FlowField::~FlowField() {
+	if (build.valid()) {
+		build.wait();
+	}
+}
+
+int FlowField::cellAt(float x, float z) const {
+	int cellX = glm::clamp(int(x / cellSize), 0, cellsPerSide - 1);
+	int cellZ = glm::clamp(int(-z / cellSize), 0, cellsPerSide - 1);
+	return cellZ * cellsPerSide + cellX;
+}
+
+glm::vec2 FlowField::centerOf(int cell) const {
+	return glm::vec2((cell % cellsPerSide + 0.5f) * cellSize, -(cell / cellsPerSide + 0.5f) * cellSize);
+}
+
+unsigned long long FlowField::hash(const HeightField& heightField, const std::vector<glm::vec3>& obstacles, float maxSlope) const {
+	unsigned long long hash = 14695981039346656037ull;
+	hashBytes(hash, &dimension, sizeof(dimension));
+	hashBytes(hash, &cellSize, sizeof(cellSize));
+	hashBytes(hash, &maxSlope, sizeof(maxSlope));
+	// the costs sample the terrain inside the cells, so every sample of the heightmap goes into the key
+	glm::ivec2 resolution = heightField.getResolution();
+	float terrainDimension = heightField.getDimension();
+	hashBytes(hash, &resolution, sizeof(resolution));
+	hashBytes(hash, &terrainDimension, sizeof(terrainDimension));
+	const std::vector<float>& samples = heightField.getSamples();
+	if (!samples.empty()) {
+		hashBytes(hash, samples.data(), samples.size() * sizeof(float));
+	}
+	if (!obstacles.empty()) {
+		hashBytes(hash, obstacles.data(), obstacles.size() * sizeof(glm::vec3));
+	}
+	return hash;
+}
+
+void FlowField::computeCosts(const HeightField& heightField, const std::vector<glm::vec3>& obstacles, float maxSlope) {
+	float minNormalY = std::cos(glm::radians(maxSlope));
+	float half = cellSize * 0.4f;
+	costs.assign(size_t(cellsPerSide) * cellsPerSide, 0.0f);
+	for (int cell = 0; cell < int(costs.size()); cell++) {
+		// steepest of the center and four points around it
+		glm::vec2 center = centerOf(cell);
+		float lowest = 1.0f;
+		glm::vec2 points[5] = { center, center + glm::vec2(-half, -half), center + glm::vec2(half, -half),
+			center + glm::vec2(-half, half), center + glm::vec2(half, half) };
+		for (const glm::vec2& point : points) {
+			lowest = std::min(lowest, heightField.getNormal(point.x, point.y).y);
+		}
+		if (lowest >= minNormalY) {
+			float slope = glm::degrees(std::acos(glm::clamp(lowest, -1.0f, 1.0f)));
+			costs[cell] = 1.0f + 2.0f * slope / maxSlope;
+		}
+	}
+
+	// block every cell a circle touches
+	for (const glm::vec3& obstacle : obstacles) {
+		int minX = glm::clamp(int((obstacle.x - obstacle.z) / cellSize), 0, cellsPerSide - 1);
+		int maxX = glm::clamp(int((obstacle.x + obstacle.z) / cellSize), 0, cellsPerSide - 1);
+		int minZ = glm::clamp(int(-(obstacle.y + obstacle.z) / cellSize), 0, cellsPerSide - 1);
+		int maxZ = glm::clamp(int(-(obstacle.y - obstacle.z) / cellSize), 0, cellsPerSide - 1);
+		for (int z = minZ; z <= maxZ; z++) {
+			for (int x = minX; x <= maxX; x++) {
+				glm::vec2 closest = glm::clamp(glm::vec2(obstacle.x, obstacle.y),
+					glm::vec2(x * cellSize, -(z + 1) * cellSize), glm::vec2((x + 1) * cellSize, -z * cellSize));
+				if (glm::distance(closest, glm::vec2(obstacle.x, obstacle.y)) < obstacle.z) {
+					costs[z * cellsPerSide + x] = 0.0f;
+				}
+			}
+		}
+	}
+}
+
+bool FlowField::loadCosts(const std::string& path, unsigned long long key) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	CacheHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != CACHE_MAGIC || header.key != key
+		|| header.cells != cellsPerSide) {
+		return false;
+	}
+	costs.resize(size_t(cellsPerSide) * cellsPerSide);
+	return bool(file.read(reinterpret_cast<char*>(costs.data()), costs.size() * sizeof(float)));
+}
+
+void FlowField::saveCosts(const std::string& path, unsigned long long key) const {
+	CacheHeader header;
+	header.magic = CACHE_MAGIC;
+	header.cells = cellsPerSide;
+	header.key = key;
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(costs.data()), costs.size() * sizeof(float));
+	if (!file) {
+		std::cout << "Could not write the navigation costs " << path << std::endl;
+	}
+}
+
+void FlowField::integrate(int goalCell, std::vector<glm::vec2>& field, ThreadPool& pool) {
+	int cells = int(costs.size());
+	distances.assign(cells, FLT_MAX);
+
+	// a neighbor can be entered if it is walkable, diagonally only if both cells beside the step are walkable as well
+	auto canStep = [this](int cellX, int cellZ, int direction) {
+		int x = cellX + OFFSET_X[direction];
+		int z = cellZ + OFFSET_Z[direction];
+		if (x < 0 || z < 0 || x >= cellsPerSide || z >= cellsPerSide || costs[z * cellsPerSide + x] <= 0.0f) {
+			return false;
+		}
+		return direction < 4 || (costs[cellZ * cellsPerSide + x] > 0.0f && costs[z * cellsPerSide + cellX] > 0.0f);
+	};
+
+	typedef std::pair<float, int> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+	distances[goalCell] = 0.0f;
+	open.push(Entry(0.0f, goalCell));
+	while (!open.empty()) {
+		Entry entry = open.top();
+		open.pop();
+		int cell = entry.second;
+		if (entry.first > distances[cell]) {
+			continue;
+		}
+		int cellX = cell % cellsPerSide;
+		int cellZ = cell / cellsPerSide;
+		// the player may stand in a blocked cell
+		float cost = costs[cell] > 0.0f ? costs[cell] : 1.0f;
+		for (int direction = 0; direction < 8; direction++) {
+			if (!canStep(cellX, cellZ, direction)) {
+				continue;
+			}
+			int neighbor = (cellZ + OFFSET_Z[direction]) * cellsPerSide + cellX + OFFSET_X[direction];
+			float length = direction < 4 ? 1.0f : 1.41421356f;
+			float distance = entry.first + length * 0.5f * (cost + costs[neighbor]);
+			if (distance < distances[neighbor]) {
+				distances[neighbor] = distance;
+				open.push(Entry(distance, neighbor));
+			}
+		}
+	}
+
+	// every cell points to its neighbor closest to the player
+	pool.parallelFor(cellsPerSide, [&](int cellZ) {
+		for (int cellX = 0; cellX < cellsPerSide; cellX++) {
+			int cell = cellZ * cellsPerSide + cellX;
+			field[cell] = glm::vec2(0.0f);
+			if (cell == goalCell || distances[cell] == FLT_MAX) {
+				continue;
+			}
+			float best = distances[cell];
+			for (int direction = 0; direction < 8; direction++) {
+				if (!canStep(cellX, cellZ, direction)) {
+					continue;
+				}
+				int neighbor = (cellZ + OFFSET_Z[direction]) * cellsPerSide + cellX + OFFSET_X[direction];
+				if (distances[neighbor] < best) {
+					best = distances[neighbor];
+					// z of the cells grows towards -z in the world
+					field[cell] = glm::normalize(glm::vec2(float(OFFSET_X[direction]), float(-OFFSET_Z[direction])));
+				}
+			}
+		}
+	});
+}
+
+void FlowField::update(const glm::vec3& playerPos, ThreadPool& pool) {
+	if (build.valid() && build.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		build.get();
+		current = 1 - current;
+		goal = buildGoal;
+	}
+	int cell = cellAt(playerPos.x, playerPos.z);
+	if (!build.valid() && cell != goal) {
+		buildGoal = cell;
+		std::vector<glm::vec2>* field = &fields[1 - current];
+		build = pool.submit([this, cell, field, &pool] {
+			integrate(cell, *field, pool);
+		});
+	}
+}
+
+glm::vec2 FlowField::sample(float x, float z) const {
+	if (goal < 0) {
+		return glm::vec2(0.0f);
+	}
+	return fields[current][cellAt(x, z)];
+}
+
+int FlowField::getCellsPerSide() const {
+	return cellsPerSide;
+}
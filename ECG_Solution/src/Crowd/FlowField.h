@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <future>
+#include <glm/glm.hpp>
+#include "../Terrain/HeightField.h"
+#include "../Jobs/ThreadPool.h"
+
+/*!
+ * Navigation towards the player that all enemies share.
+ * The terrain is split into square cells. A cell costs more the steeper it is, and too steep cells or cells under a
+ * static obstacle are blocked. The costs only depend on the terrain and the obstacles, so they are kept on disk
+ * under a hash of both.
+ * When the player enters another cell, one Dijkstra pass from that cell runs on a worker and turns into a direction
+ * per cell. Agents read their direction with a single lookup, so the cost does not grow with the number of enemies.
+ * The fields are double buffered: agents use the last finished one while the next is computed.
+ */
+class FlowField {
+private:
+	float dimension;
+	float cellSize;
+	int cellsPerSide;
+	std::vector<float> costs;		// per cell, 0 if blocked
+
+	std::vector<glm::vec2> fields[2];	// direction per cell, zero in the goal cell and where the player can not be reached
+	int current;						// field the agents read
+	int goal;							// cell of the player in the current field, -1 before the first field
+	int buildGoal;
+	std::future<void> build;
+	std::vector<float> distances;		// of the field that is built
+
+	void computeCosts(const HeightField& heightField, const std::vector<glm::vec3>& obstacles, float maxSlope);
+	unsigned long long hash(const HeightField& heightField, const std::vector<glm::vec3>& obstacles, float maxSlope) const;
+	bool loadCosts(const std::string& path, unsigned long long key);
+	void saveCosts(const std::string& path, unsigned long long key) const;
+	void integrate(int goalCell, std::vector<glm::vec2>& field, ThreadPool& pool);
+	int cellAt(float x, float z) const;
+	glm::vec2 centerOf(int cell) const;
+
+public:
+	/*!
+	 * Reads the costs from the cache or computes and stores them
+	 * @param obstacles: x, z and radius of every static obstacle
+	 * @param cellSize: width of a cell in world units
+	 * @param maxSlope: steepest walkable slope in degrees
+	 * @param cachePath: file of the cached costs, empty to compute them every time
+	 */
+	FlowField(const HeightField& heightField, const std::vector<glm::vec3>& obstacles, float cellSize, float maxSlope,
+		const std::string& cachePath);
+	~FlowField();
+
+	/*!
+	 * Swaps in a finished field and starts the next one on the workers if the player left the cell of the last one,
+	 * never waits
+	 */
+	void update(const glm::vec3& playerPos, ThreadPool& pool);
+
+	/*!
+	 * @return direction towards the player, zero if the agent should walk straight at the player
+	 */
+	glm::vec2 sample(float x, float z) const;
+
+	int getCellsPerSide() const;
+};
@@ -0,0 +1,177 @@
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+
+SpatialHash::SpatialHash(float cellSize, int cellsPerSide)
+	: cellSize(cellSize), cellsPerSide(cellsPerSide), cellStart(size_t(cellsPerSide) * cellsPerSide + 1, 0) {
+}
+
+int SpatialHash::cellCoordinate(float value) const {
+	return glm::clamp(int(std::floor(value / cellSize)), 0, cellsPerSide - 1);
+}
+
+void SpatialHash::build(const float* x, const float* y, const float* z, unsigned int count, const unsigned char* include) {
+	// the buffers keep the capacity of the largest build, so a pool of points never allocates again
+	unsigned int included = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		included += !include || include[i] ? 1 : 0;
+	}
+	cellOfPoint.resize(count);
+	for (std::vector<float>* sorted : { &sortedX, &sortedY, &sortedZ }) {
+		sorted->reserve(count);
+		sorted->resize(included);
+	}
+	sortedIndex.reserve(count);
+	sortedIndex.resize(included);
+
+	// count the points per cell, the running sum makes every entry the end of its cell
+	std::fill(cellStart.begin(), cellStart.end(), 0);
+	for (unsigned int i = 0; i < count; i++) {
+		if (include && !include[i]) {
+			continue;
+		}
+		unsigned int cell = static_cast<unsigned int>(cellCoordinate(-z[i]) * cellsPerSide + cellCoordinate(x[i]));
+		cellOfPoint[i] = cell;
+		cellStart[cell]++;
+	}
+	unsigned int sum = 0;
+	for (unsigned int& start : cellStart) {
+		sum += start;
+		start = sum;
+	}
+
+	// filled from the back, afterwards every entry is the start of its cell and the order within a cell is kept
+	for (unsigned int i = count; i-- > 0;) {
+		if (include && !include[i]) {
+			continue;
+		}
+		unsigned int slot = --cellStart[cellOfPoint[i]];
+		sortedX[slot] = x[i];
+		sortedY[slot] = y[i];
+		sortedZ[slot] = z[i];
+		sortedIndex[slot] = i;
+	}
+}
+
+void SpatialHash::querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& result) const {
+	result.clear();
+	float radiusSq = radius * radius;
+	visit(center.x, center.z, radius, [&](unsigned int slot) {
+		glm::vec3 offset(sortedX[slot] - center.x, sortedY[slot] - center.y, sortedZ[slot] - center.z);
+		if (glm::dot(offset, offset) <= radiusSq) {
+			result.push_back(sortedIndex[slot]);
+		}
+		return true;
+	});
+}
+
+void SpatialHash::queryCone(const glm::vec3& apex, const glm::vec3& direction, float halfAngle, float range,
+	std::vector<unsigned int>& result) const {
+	result.clear();
+	glm::vec2 axis(direction.x, direction.z);
+	if (glm::dot(axis, axis) < 1e-12f) {
+		return;
+	}
+	axis = glm::normalize(axis);
+	float minCos = std::cos(glm::radians(halfAngle));
+	float rangeSq = range * range;
+	visit(apex.x, apex.z, range, [&](unsigned int slot) {
+		glm::vec3 offset(sortedX[slot] - apex.x, sortedY[slot] - apex.y, sortedZ[slot] - apex.z);
+		if (glm::dot(offset, offset) > rangeSq) {
+			return true;
+		}
+		// a point right above or below the apex is inside every cone
+		glm::vec2 flat(offset.x, offset.z);
+		float flatLength = glm::length(flat);
+		if (flatLength < 1e-6f || glm::dot(flat, axis) >= minCos * flatLength) {
+			result.push_back(sortedIndex[slot]);
+		}
+		return true;
+	});
+}
+
+void SpatialHash::querySegment(const glm::vec3& from, const glm::vec3& to, float radius, std::vector<unsigned int>& result) const {
+	result.clear();
+	glm::vec3 segment = to - from;
+	float lengthSq = glm::dot(segment, segment);
+	glm::vec3 middle = (from + to) * 0.5f;
+	float radiusSq = radius * radius;
+	visit(middle.x, middle.z, std::sqrt(lengthSq) * 0.5f + radius, [&](unsigned int slot) {
+		glm::vec3 point(sortedX[slot], sortedY[slot], sortedZ[slot]);
+		float t = lengthSq > 0.0f ? glm::clamp(glm::dot(point - from, segment) / lengthSq, 0.0f, 1.0f) : 0.0f;
+		glm::vec3 offset = point - (from + segment * t);
+		if (glm::dot(offset, offset) <= radiusSq) {
+			result.push_back(sortedIndex[slot]);
+		}
+		return true;
+	});
+}
+
+void SpatialHash::queryNearest(const glm::vec3& center, unsigned int k, float maxDistance, std::vector<unsigned int>& result) const {
+	result.clear();
+	if (k == 0 || sortedIndex.empty()) {
+		return;
+	}
+	// result holds slots sorted by distance until the end
+	auto distanceSq = [&](unsigned int slot) {
+		glm::vec3 offset(sortedX[slot] - center.x, sortedY[slot] - center.y, sortedZ[slot] - center.z);
+		return glm::dot(offset, offset);
+	};
+	float maxDistanceSq = maxDistance * maxDistance;
+	int centerX = cellCoordinate(center.x);
+	int centerZ = cellCoordinate(-center.z);
+	int rings = std::min(int(std::ceil(maxDistance / cellSize)) + 1, cellsPerSide);
+
+	// rings of cells around the center, every point of ring r is at least (r - 1) cells away
+	for (int ring = 0; ring <= rings; ring++) {
+		if (result.size() == k) {
+			float reach = std::max(ring - 1, 0) * cellSize;
+			if (distanceSq(result.back()) <= reach * reach) {
+				break;
+			}
+		}
+		for (int cellZ = std::max(centerZ - ring, 0); cellZ <= std::min(centerZ + ring, cellsPerSide - 1); cellZ++) {
+			for (int cellX = std::max(centerX - ring, 0); cellX <= std::min(centerX + ring, cellsPerSide - 1); cellX++) {
+				if (std::max(std::abs(cellX - centerX), std::abs(cellZ - centerZ)) != ring) {
+					continue;
+				}
+				int cell = cellZ * cellsPerSide + cellX;
+				for (unsigned int slot = cellStart[cell]; slot < cellStart[cell + 1]; slot++) {
+					float distance = distanceSq(slot);
+					if (distance > maxDistanceSq || (result.size() == k && distance >= distanceSq(result.back()))) {
+						continue;
+					}
+					if (result.size() == k) {
+						result.pop_back();
+					}
+					auto position = std::upper_bound(result.begin(), result.end(), distance,
+						[&](float value, unsigned int other) { return value < distanceSq(other); });
+					result.insert(position, slot);
+				}
+			}
+		}
+	}
+	for (unsigned int& slot : result) {
+		slot = sortedIndex[slot];
+	}
+}
+
+unsigned int SpatialHash::size() const {
+	return static_cast<unsigned int>(sortedIndex.size());
+}
+
+float SpatialHash::getX(unsigned int slot) const {
+	return sortedX[slot];
+}
+
+float SpatialHash::getY(unsigned int slot) const {
+	return sortedY[slot];
+}
+
+float SpatialHash::getZ(unsigned int slot) const {
+	return sortedZ[slot];
+}
+
+unsigned int SpatialHash::getIndex(unsigned int slot) const {
+	return sortedIndex[slot];
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+/*!
+ * Uniform grid over points on the terrain for proximity queries.
+ * build() buckets all points with a counting sort, so the points of one cell lie next to each other and a query only
+ * reads the cells it overlaps. The cost of a query depends on how many points are near it, not on how many there are.
+ * Positions are copied on build, queries see the points where they were then.
+ */
+class SpatialHash {
+private:
+	float cellSize;
+	int cellsPerSide;
+	std::vector<unsigned int> cellStart;		// first slot of every cell, one more entry for the end
+	std::vector<unsigned int> cellOfPoint;
+	std::vector<float> sortedX, sortedY, sortedZ;
+	std::vector<unsigned int> sortedIndex;
+
+	int cellCoordinate(float value) const;
+
+public:
+	/*!
+	 * @param cellSize: width of a cell, about the most common query radius
+	 * @param cellsPerSide: points outside x in [0, cellSize * cellsPerSide] and z in [-cellSize * cellsPerSide, 0]
+	 * are put into the border cells
+	 */
+	SpatialHash(float cellSize, int cellsPerSide);
+
+	/*!
+	 * Buckets the points, every array holds count values
+	 * @param include: per point, 0 leaves it out of every query, nullptr includes all points
+	 */
+	void build(const float* x, const float* y, const float* z, unsigned int count, const unsigned char* include = nullptr);
+
+	/*!
+	 * Calls visit(slot) for every point in the cells a circle around x and z overlaps, stops when visit returns false.
+	 * The slot indexes getX/getY/getZ/getIndex.
+	 */
+	template <typename Visit>
+	void visit(float x, float z, float radius, Visit visit) const {
+		if (sortedIndex.empty()) {
+			return;
+		}
+		int minX = cellCoordinate(x - radius);
+		int maxX = cellCoordinate(x + radius);
+		int minZ = cellCoordinate(-z - radius);
+		int maxZ = cellCoordinate(-z + radius);
+		for (int cellZ = minZ; cellZ <= maxZ; cellZ++) {
+			for (int cellX = minX; cellX <= maxX; cellX++) {
+				int cell = cellZ * cellsPerSide + cellX;
+				for (unsigned int slot = cellStart[cell]; slot < cellStart[cell + 1]; slot++) {
+					if (!visit(slot)) {
+						return;
+					}
+				}
+			}
+		}
+	}
+
+	/*!
+	 * Points within radius of center
+	 * @param result: cleared, then filled with the indices of the points
+	 */
+	void querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& result) const;
+
+	/*!
+	 * Points within range of apex whose horizontal direction is at most halfAngle degrees from direction
+	 */
+	void queryCone(const glm::vec3& apex, const glm::vec3& direction, float halfAngle, float range,
+		std::vector<unsigned int>& result) const;
+
+	/*!
+	 * Points within radius of the segment between from and to, for sweeps of moving objects
+	 */
+	void querySegment(const glm::vec3& from, const glm::vec3& to, float radius, std::vector<unsigned int>& result) const;
+
+	/*!
+	 * The k points nearest to center, nearest first, none farther than maxDistance
+	 */
+	void queryNearest(const glm::vec3& center, unsigned int k, float maxDistance, std::vector<unsigned int>& result) const;
+
+	unsigned int size() const;
+	float getX(unsigned int slot) const;
+	float getY(unsigned int slot) const;
+	float getZ(unsigned int slot) const;
+	unsigned int getIndex(unsigned int slot) const;
+};
@@ -0,0 +1,49 @@
+#include "UpdateScheduler.h"
+#include <algorithm>
+
+UpdateScheduler::UpdateScheduler(float nearDistance, float middleDistance, float farDistance)
+	: step(0) {
+	setDistances(nearDistance, middleDistance, farDistance);
+}
+
+void UpdateScheduler::setDistances(float nearDistance, float middleDistance, float farDistance) {
+	distances[0] = nearDistance;
+	distances[1] = std::max(middleDistance, nearDistance);
+	distances[2] = std::max(farDistance, distances[1]);
+}
+
+void UpdateScheduler::add() {
+	intervals.push_back(1);
+	lastUpdates.push_back(step - 1);
+}
+
+void UpdateScheduler::wake(unsigned int agent) {
+	intervals[agent] = 1;
+	// the time the agent was away does not count, its first update covers one step
+	lastUpdates[agent] = step - 1;
+}
+
+bool UpdateScheduler::isDue(unsigned int agent) const {
+	// the agent index is the phase, the intervals are powers of two
+	return ((step + agent) & (intervals[agent] - 1u)) == 0;
+}
+
+float UpdateScheduler::getElapsed(unsigned int agent, float dt) const {
+	return float(step - lastUpdates[agent]) * dt;
+}
+
+void UpdateScheduler::updated(unsigned int agent, float distance, bool visible) {
+	int level = 0;
+	while (level < LEVELS - 1 && distance >= distances[level]) {
+		level++;
+	}
+	if (!visible) {
+		level = std::min(level + 1, LEVELS - 1);
+	}
+	intervals[agent] = static_cast<unsigned char>(1u << level);
+	lastUpdates[agent] = step;
+}
+
+void UpdateScheduler::advance() {
+	step++;
+}
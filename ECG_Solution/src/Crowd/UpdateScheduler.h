@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+
+/*!
+ * Decides in which steps an agent runs its full update: looking for the player, steering, separation and moving
+ * its controller. Its node only turns when the agent steered.
+ * Agents near the player are due every step, farther ones every 2nd, 4th or 8th step, and one level less often
+ * while they can not see the player. Every agent has a fixed phase, so the agents of a level are spread evenly
+ * over the steps instead of all being due in the same one.
+ */
+class UpdateScheduler {
+public:
+	static const int LEVELS = 4;
+
+private:
+	float distances[LEVELS - 1];		// where the levels 1 to 3 start
+	unsigned int step;
+	std::vector<unsigned char> intervals;
+	std::vector<unsigned int> lastUpdates;
+
+public:
+	/*!
+	 * @param nearDistance: agents closer than this are due every step
+	 * @param middleDistance: agents closer than this are due every 2nd step
+	 * @param farDistance: agents closer than this are due every 4th step, all others every 8th
+	 */
+	UpdateScheduler(float nearDistance, float middleDistance, float farDistance);
+
+	void setDistances(float nearDistance, float middleDistance, float farDistance);
+
+	/*!
+	 * A new agent, due in the next step
+	 */
+	void add();
+
+	/*!
+	 * Makes an agent due in the next step, after it was placed somewhere else, its first elapsed time is one step
+	 */
+	void wake(unsigned int agent);
+
+	bool isDue(unsigned int agent) const;
+
+	/*!
+	 * @return time since the last update of the agent, dt for agents due every step
+	 */
+	float getElapsed(unsigned int agent, float dt) const;
+
+	/*!
+	 * Marks the agent as updated in this step and picks its next interval
+	 */
+	void updated(unsigned int agent, float distance, bool visible);
+
+	/*!
+	 * Moves on to the next step, after all agents of this one were updated
+	 */
+	void advance();
+};
@@ -0,0 +1,82 @@
+#include "WaveSpawner.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+namespace {
+	const unsigned int SPAWNS_PER_STEP = 4;
+	const float SCATTER_RADIUS = 40.0f;			// around the spawn point
+	const float MIN_PLAYER_DISTANCE = 150.0f;	// spawn points nearer to the player are skipped
+}
+
+WaveSpawner::WaveSpawner(const std::vector<glm::vec2>& spawnPoints, unsigned int firstWaveSize, float growth, float interval)
+	: spawnPoints(spawnPoints), firstWaveSize(std::max(firstWaveSize, 1u)), growth(std::max(growth, 1.0f)), interval(interval) {
+	reset();
+}
+
+void WaveSpawner::reset() {
+	wave = 0;
+	pending = 0;
+	waveTime = 0.0f;
+	nextPoint = 0;
+	// every round gets the same scatter
+	random.seed(1);
+}
+
+glm::vec2 WaveSpawner::pickSpawnPoint(const glm::vec3& playerPos) {
+	// the points take turns, if all of them are near the player the next one is used anyway
+	glm::vec2 player(playerPos.x, playerPos.z);
+	for (size_t tries = 0; tries < spawnPoints.size(); tries++) {
+		const glm::vec2& point = spawnPoints[nextPoint];
+		nextPoint = (nextPoint + 1) % spawnPoints.size();
+		if (glm::distance(point, player) >= MIN_PLAYER_DISTANCE) {
+			return point;
+		}
+	}
+	const glm::vec2& point = spawnPoints[nextPoint];
+	nextPoint = (nextPoint + 1) % spawnPoints.size();
+	return point;
+}
+
+void WaveSpawner::update(Crowd& crowd, const glm::vec3& playerPos, float dt, const HeightField& heightField) {
+	if (spawnPoints.empty() || crowd.size() == 0) {
+		return;
+	}
+	waveTime += dt;
+	if (pending == 0 && (crowd.getActiveCount() == 0 || waveTime >= interval)) {
+		wave++;
+		pending = std::min(getWaveSize(wave), crowd.size());
+		waveTime = 0.0f;
+	}
+
+	// the same part of the terrain the crowd keeps its agents on
+	glm::vec2 boundsMin, boundsMax;
+	Crowd::getBounds(heightField, boundsMin, boundsMax);
+
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (unsigned int i = 0; i < SPAWNS_PER_STEP && pending > 0; i++) {
+		// uniform over the disk around the point
+		glm::vec2 point = pickSpawnPoint(playerPos);
+		float angle = unit(random) * glm::two_pi<float>();
+		float radius = std::sqrt(unit(random)) * SCATTER_RADIUS;
+		float x = glm::clamp(point.x + std::cos(angle) * radius, boundsMin.x, boundsMax.x);
+		float z = glm::clamp(point.y + std::sin(angle) * radius, boundsMin.y, boundsMax.y);
+		if (crowd.spawn(glm::vec3(x, heightField.getHeight(x, z), z), wave - 1) < 0) {
+			break;
+		}
+		pending--;
+	}
+}
+
+unsigned int WaveSpawner::getWave() const {
+	return wave;
+}
+
+unsigned int WaveSpawner::getWaveSize(unsigned int wave) const {
+	if (wave == 0) {
+		return 0;
+	}
+	// late waves are far larger than any pool
+	float size = float(firstWaveSize) * std::pow(growth, float(std::min(wave, 64u) - 1));
+	return static_cast<unsigned int>(std::round(std::min(size, 1e6f)));
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <glm/glm.hpp>
+#include "Crowd.h"
+
+/*!
+ * Sends the enemies of the Crowd pool in waves, every wave larger than the last, until the pool is used up.
+ * A wave starts when no enemy is left or its time is up, and only after the last wave is completely in the game.
+ * Its enemies appear a few per step, scattered around spawn points away from the player, so hundreds of them neither
+ * stand on one spot nor all arrive in the same step. A full pool holds the rest of the wave back until enemies die.
+ */
+class WaveSpawner {
+private:
+	std::vector<glm::vec2> spawnPoints;
+	unsigned int firstWaveSize;
+	float growth;
+	float interval;
+
+	unsigned int wave;			// the current one, 0 before the first
+	unsigned int pending;		// enemies of the current wave that are not in the game yet
+	float waveTime;				// since the current wave started
+	unsigned int nextPoint;
+	std::minstd_rand random;
+
+	glm::vec2 pickSpawnPoint(const glm::vec3& playerPos);
+
+public:
+	/*!
+	 * @param spawnPoints: x and z of the places the enemies come from
+	 * @param firstWaveSize: enemies of the first wave
+	 * @param growth: every wave has this many times the enemies of the one before
+	 * @param interval: seconds after which the next wave starts even if enemies are left
+	 */
+	WaveSpawner(const std::vector<glm::vec2>& spawnPoints, unsigned int firstWaveSize, float growth, float interval);
+
+	/*!
+	 * Back to before the first wave, the enemies have to be despawned by the caller
+	 */
+	void reset();
+
+	/*!
+	 * Starts the next wave when it is time and spawns the next few enemies of the current one
+	 * @param heightField: places the enemies on the ground, they stay within its bounds
+	 */
+	void update(Crowd& crowd, const glm::vec3& playerPos, float dt, const HeightField& heightField);
+
+	unsigned int getWave() const;
+
+	/*!
+	 * @return enemies of a wave, the first wave is 1
+	 */
+	unsigned int getWaveSize(unsigned int wave) const;
+};
@@ -0,0 +1,202 @@
+#include "DrawBatch.h"
+#include <algorithm>
+
+DrawBatch::DrawBatch()
+	: drawCapacity(0) {
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &positionBuffer);
+	glGenBuffers(1, &normalBuffer);
+	glGenBuffers(1, &uvBuffer);
+	glGenBuffers(1, &indexBuffer);
+	glGenBuffers(1, &drawIDBuffer);
+	glGenBuffers(1, &drawBuffer);
+	glGenBuffers(1, &commandBuffer);
+}
+
+DrawBatch::~DrawBatch() {
+	glDeleteBuffers(1, &positionBuffer);
+	glDeleteBuffers(1, &normalBuffer);
+	glDeleteBuffers(1, &uvBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+	glDeleteBuffers(1, &drawIDBuffer);
+	glDeleteBuffers(1, &drawBuffer);
+	glDeleteBuffers(1, &commandBuffer);
+	glDeleteVertexArrays(1, &vao);
+}
+
+int DrawBatch::add(GLuint positions, GLuint normals, GLuint uvs, GLuint indices, GLuint vertexCount, GLuint indexCount) {
+	SourceMesh source;
+	source.positions = positions;
+	source.normals = normals;
+	source.uvs = uvs;
+	source.indices = indices;
+	source.vertexCount = vertexCount;
+	source.indexCount = indexCount;
+	sources.push_back(source);
+	return int(sources.size()) - 1;
+}
+
+void DrawBatch::build() {
+	GLuint vertexCount = 0, indexCount = 0;
+	for (const SourceMesh& source : sources) {
+		vertexCount += source.vertexCount;
+		indexCount += source.indexCount;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, positionBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, vertexCount * sizeof(glm::vec4), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, normalBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, vertexCount * sizeof(glm::vec4), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, uvBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, vertexCount * sizeof(glm::vec2), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, indexCount * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+
+	// indices stay as they are, baseVertex moves them to the vertices of their mesh
+	GLuint firstVertex = 0, firstIndex = 0;
+	for (const SourceMesh& source : sources) {
+		const GLuint buffers[4][2] = {
+			{ source.positions, positionBuffer }, { source.normals, normalBuffer }, { source.uvs, uvBuffer }, { source.indices, indexBuffer }
+		};
+		const GLintptr offsets[4] = {
+			GLintptr(firstVertex * sizeof(glm::vec4)), GLintptr(firstVertex * sizeof(glm::vec4)), GLintptr(firstVertex * sizeof(glm::vec2)), GLintptr(firstIndex * sizeof(GLuint))
+		};
+		const GLsizeiptr sizes[4] = {
+			GLsizeiptr(source.vertexCount * sizeof(glm::vec4)), GLsizeiptr(source.vertexCount * sizeof(glm::vec4)), GLsizeiptr(source.vertexCount * sizeof(glm::vec2)), GLsizeiptr(source.indexCount * sizeof(GLuint))
+		};
+		for (int i = 0; i < 4; i++) {
+			glBindBuffer(GL_COPY_READ_BUFFER, buffers[i][0]);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[i][1]);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offsets[i], sizes[i]);
+		}
+
+		DrawCommand command;
+		command.count = source.indexCount;
+		command.instanceCount = 1;
+		command.firstIndex = firstIndex;
+		command.baseVertex = GLint(firstVertex);
+		command.baseInstance = 0;
+		meshes.push_back(command);
+
+		firstVertex += source.vertexCount;
+		firstIndex += source.indexCount;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	sources.clear();
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, uvBuffer);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+	// one id per instance, the baseInstance of every command selects its entry
+	glBindBuffer(GL_ARRAY_BUFFER, drawIDBuffer);
+	glEnableVertexAttribArray(DRAW_ID_LOCATION);
+	glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, 0, 0);
+	glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	reserveDrawIDs(meshes.size());
+}
+
+void DrawBatch::reserveDrawIDs(size_t count) {
+	if (count <= drawCapacity) {
+		return;
+	}
+	drawCapacity = glm::max(count, drawCapacity * 2);
+	std::vector<GLuint> ids(drawCapacity);
+	for (size_t i = 0; i < drawCapacity; i++) {
+		ids[i] = GLuint(i);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, drawIDBuffer);
+	glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DrawBatch::begin() {
+	commands.clear();
+	commandPages.clear();
+	draws.clear();
+}
+
+void DrawBatch::queue(int mesh, const glm::mat4& modelMatrix, GLuint material) {
+	DrawCommand command = meshes[mesh];
+	command.baseInstance = GLuint(draws.size());
+	commands.push_back(command);
+	MaterialTable* table = MaterialTable::getInstance();
+	commandPages.push_back(table != nullptr ? table->getPage(int(material)) : 0);
+
+	DrawData draw;
+	draw.modelMatrix = modelMatrix;
+	draw.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(modelMatrix))));
+	draw.material = material;
+	draws.push_back(draw);
+}
+
+void DrawBatch::draw(Shader* shader) {
+	if (commands.empty()) {
+		return;
+	}
+	reserveDrawIDs(draws.size());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, draws.size() * sizeof(DrawData), draws.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BINDING, drawBuffer);
+
+	// counting sort by page, baseInstance still finds the draw data of every command
+	int pageEnds[MaterialTable::MAX_PAGES] = {};
+	for (int page : commandPages) {
+		pageEnds[page]++;
+	}
+	for (int page = 1; page < MaterialTable::MAX_PAGES; page++) {
+		pageEnds[page] += pageEnds[page - 1];
+	}
+	int pageStarts[MaterialTable::MAX_PAGES];
+	for (int page = 0; page < MaterialTable::MAX_PAGES; page++) {
+		pageStarts[page] = page > 0 ? pageEnds[page - 1] : 0;
+	}
+	sortedCommands.resize(commands.size());
+	int next[MaterialTable::MAX_PAGES];
+	std::copy(pageStarts, pageStarts + MaterialTable::MAX_PAGES, next);
+	for (size_t i = 0; i < commands.size(); i++) {
+		sortedCommands[next[commandPages[i]]++] = commands[i];
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, sortedCommands.size() * sizeof(DrawCommand), sortedCommands.data(), GL_STREAM_DRAW);
+
+	shader->use();
+	glBindVertexArray(vao);
+	MaterialTable* table = MaterialTable::getInstance();
+	if (table == nullptr || table->isBindless()) {
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, GLsizei(sortedCommands.size()), 0);
+	}
+	else {
+		for (int page = 0; page < MaterialTable::MAX_PAGES; page++) {
+			GLsizei count = GLsizei(pageEnds[page] - pageStarts[page]);
+			if (count == 0) {
+				continue;
+			}
+			shader->setUniform("page", int(MaterialTable::FIRST_PAGE_UNIT) + page);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(pageStarts[page] * sizeof(DrawCommand)), count, 0);
+		}
+	}
+	glBindVertexArray(0);
+	shader->unuse();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+size_t DrawBatch::getDrawCount() const {
+	return commands.size();
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Shader.h"
+#include "MaterialTable.h"
+
+/*!
+ * Copies the vertex and index buffers of many meshes into shared buffers, so all of them are drawn with a single
+ * glMultiDrawElementsIndirect call no matter which material they use.
+ * Without bindless textures the draws are grouped by the texture array page of their material and every group is
+ * one multi-draw with its page bound, since the sampler must be the same for all draws of a call.
+ * Every queued draw gets its model matrix and material index through a shader storage buffer; the shader finds its
+ * entry through the instanced drawID attribute, which starts at the baseInstance of the draw command.
+ */
+class DrawBatch {
+private:
+	struct SourceMesh {
+		GLuint positions, normals, uvs, indices;
+		GLuint vertexCount, indexCount;
+	};
+
+	// layout of glMultiDrawElementsIndirect
+	struct DrawCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// std430 layout of one entry of the draw buffer
+	struct DrawData {
+		glm::mat4 modelMatrix;
+		glm::mat4 normalMatrix;
+		GLuint material;
+		GLuint padding[3];
+	};
+
+	std::vector<SourceMesh> sources;	// meshes added before build()
+	std::vector<DrawCommand> meshes;	// command of every built mesh
+	std::vector<DrawCommand> commands;
+	std::vector<int> commandPages;			// texture array page of every queued command
+	std::vector<DrawCommand> sortedCommands;	// commands grouped by page
+	std::vector<DrawData> draws;
+
+	GLuint vao;
+	GLuint positionBuffer, normalBuffer, uvBuffer, indexBuffer;
+	GLuint drawIDBuffer, drawBuffer, commandBuffer;
+	size_t drawCapacity;
+
+	void reserveDrawIDs(size_t count);
+
+public:
+	static const GLuint DRAW_BINDING = 9;		// shader storage binding of the draw buffer
+	static const GLuint DRAW_ID_LOCATION = 3;
+	static const GLuint NO_DRAW = 0xFFFFFFFFu;	// drawID of single draws, they use the uniforms instead
+
+	DrawBatch();
+	~DrawBatch();
+
+	/*!
+	 * Adds a mesh with vec4 positions, vec4 normals, vec2 uvs and unsigned int indices, the buffers are copied by build()
+	 * @return index of the mesh for queue()
+	 */
+	int add(GLuint positions, GLuint normals, GLuint uvs, GLuint indices, GLuint vertexCount, GLuint indexCount);
+
+	/*!
+	 * Copies all added meshes into the shared buffers on the GPU, called once after the last add()
+	 */
+	void build();
+
+	/*!
+	 * Starts collecting the draws of a frame
+	 */
+	void begin();
+
+	/*!
+	 * Draws a mesh with the next draw() call
+	 * @param material: index of the material in the MaterialTable
+	 */
+	void queue(int mesh, const glm::mat4& modelMatrix, GLuint material);
+
+	/*!
+	 * Draws everything that was queued since begin()
+	 */
+	void draw(Shader* shader);
+
+	/*!
+	 * @return number of meshes drawn by the last draw() call
+	 */
+	size_t getDrawCount() const;
+};
@@ -1,22 +1,20 @@
 #pragma once
 
 #include "Node.h"
+#include "Crowd/Crowd.h"
 #include "irrklang/irrKlang.h"
 
+/*!
+ * Drawn node of one crowd agent, the state of the enemy lives in the Crowd.
+ * Every agent of the pool has its node, it is only drawn while the agent is in the game.
+ */
 class Enemy : public Node
 {
 protected:
-	int hp;
-	int maxHp;
-	int damage;
-	int speed;
-	float knockBackDecay;
-	float knockBackFactor;
-	glm::vec3 _knockBackForce;
-	glm::vec3 _position;
-	physx::PxExtendedVec3 _spawnPosition;
-	physx::PxController* _pxChar;
+	Crowd* _crowd = nullptr;
+	unsigned int _agent = 0;
 	irrklang::ISoundEngine* _soundEngine;// = irrklang::createIrrKlangDevice();
+	bool _audible = true;
 
 	long long* highscore;
 
@@ -26,21 +24,32 @@ public:
 	~Enemy();
 	
 	bool hasActor(physx::PxRigidActor* actor);
-	bool isDead(glm::vec3 playerPos);
-	void knockBack(glm::vec3 dir, float dt);
+	/*!
+	 * Scores and despawns the enemy if it has no hp left
+	 */
+	bool isDead();
 	int hitWithDamage(int damage, glm::vec3 dir, float dt, bool hitByDash);
 	int getDamage();
 	int getHp();
 	int getMaxHp();
-	void setCharacterController(physx::PxController* pxChar);
+	void setAgent(Crowd* crowd, unsigned int agent);
+
+	/*!
+	 * Only audible enemies play sounds, so a crowd does not use up the voices of the sound engine
+	 */
+	void setAudible(bool audible);
+	unsigned int getAgent();
 	physx::PxController* getCharacterController();
-	void move(float forward, float strafeLeft, float dt);
 	void updateBoundingBox(glm::vec3 posDelta);
-	void move2(glm::vec3 dir, float speed, float dt);
-	void updateRotation(float angle);
-	void updateCharacter(float dt);
-	void chase(glm::vec3& playerPos, float dt);
-	void respawn(physx::PxExtendedVec3 position, glm::vec3 playerPos);
-	void setSpawnPosition(physx::PxExtendedVec3 position);
-
-};
\ No newline at end of file
+
+	/*!
+	 * Moves the node to the position and heading of its agent, hides it while the agent is free
+	 */
+	void syncWithCrowd();
+
+	/*!
+	 * Returns the agent to the pool of the crowd
+	 */
+	void despawn();
+
+};
@@ -0,0 +1,414 @@
+#include "Archive.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstring>
+#include "../Compression/LZ4.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+	const unsigned int ARCHIVE_MAGIC = 0x41474345;	// "ECGA"
+	const unsigned int ARCHIVE_VERSION = 1;
+	const unsigned int ENTRY_COMPRESSED = 1;
+
+	struct ArchiveHeader {
+		unsigned int magic;
+		unsigned int version;
+		unsigned int entryCount;
+		unsigned int reserved;
+		unsigned long long indexOffset;
+		unsigned long long indexSize;
+	};
+
+	// followed by pathLength bytes of the path
+	struct IndexEntry {
+		unsigned long long offset;
+		unsigned long long storedSize;
+		unsigned long long size;
+		unsigned int flags;
+		unsigned int pathLength;
+	};
+
+	bool isExcluded(const std::string& path, const std::vector<std::string>& excluded) {
+		for (const std::string& prefix : excluded) {
+			if (!prefix.empty() && path.compare(0, prefix.size(), prefix) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void listFiles(const std::string& directory, std::vector<std::string>& files) {
+#ifdef _WIN32
+		_finddata_t data;
+		intptr_t handle = _findfirst((directory + "/*").c_str(), &data);
+		if (handle == -1) {
+			return;
+		}
+		do {
+			std::string name = data.name;
+			if (name == "." || name == "..") {
+				continue;
+			}
+			if (data.attrib & _A_SUBDIR) {
+				listFiles(directory + "/" + name, files);
+			}
+			else {
+				files.push_back(directory + "/" + name);
+			}
+		} while (_findnext(handle, &data) == 0);
+		_findclose(handle);
+#else
+		DIR* dir = opendir(directory.c_str());
+		if (dir == nullptr) {
+			return;
+		}
+		while (dirent* entry = readdir(dir)) {
+			std::string name = entry->d_name;
+			if (name == "." || name == "..") {
+				continue;
+			}
+			struct stat info;
+			std::string path = directory + "/" + name;
+			if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+				listFiles(path, files);
+			}
+			else {
+				files.push_back(path);
+			}
+		}
+		closedir(dir);
+#endif
+	}
+
+	bool shouldCompress(const std::string& path) {
+		// the texture streamer reads single mip levels, pages of a stored entry are only touched when they are read
+		size_t dot = path.find_last_of('.');
+		return dot == std::string::npos || path.substr(dot) != ".dds";
+	}
+
+}
+
+Archive::Archive()
+	: mapping(nullptr), mappingSize(0), file(nullptr), fileMapping(nullptr) {
+}
+
+Archive::~Archive() {
+	close();
+}
+
+std::string Archive::normalizePath(const std::string& path) {
+	std::vector<std::string> parts;
+	std::string part;
+	for (size_t i = 0; i <= path.size(); i++) {
+		char c = i < path.size() ? path[i] : '/';
+		if (c != '/' && c != '\\') {
+			part += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+			continue;
+		}
+		if (part == ".." && !parts.empty() && parts.back() != "..") {
+			parts.pop_back();
+		}
+		else if (!part.empty() && part != ".") {
+			parts.push_back(part);
+		}
+		part.clear();
+	}
+	std::string normalized;
+	for (const std::string& p : parts) {
+		normalized += normalized.empty() ? p : "/" + p;
+	}
+	return normalized;
+}
+
+bool Archive::open(const std::string& path) {
+	close();
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	file = handle;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+		close();
+		return false;
+	}
+	mappingSize = size_t(size.QuadPart);
+	fileMapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (fileMapping != nullptr) {
+		mapping = static_cast<const unsigned char*>(MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	int descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(descriptor, &info) == 0 && info.st_size > 0) {
+		mappingSize = size_t(info.st_size);
+		void* view = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		mapping = view == MAP_FAILED ? nullptr : static_cast<const unsigned char*>(view);
+	}
+	::close(descriptor);
+#endif
+	if (mapping == nullptr) {
+		std::cout << "Could not map the archive " << path << std::endl;
+		close();
+		return false;
+	}
+
+	ArchiveHeader header;
+	if (mappingSize < sizeof(header)) {
+		close();
+		return false;
+	}
+	std::memcpy(&header, mapping, sizeof(header));
+	if (header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION
+		|| header.indexOffset > mappingSize || header.indexSize > mappingSize - header.indexOffset) {
+		std::cout << "Invalid archive " << path << std::endl;
+		close();
+		return false;
+	}
+
+	const unsigned char* index = mapping + header.indexOffset;
+	const unsigned char* indexEnd = index + header.indexSize;
+	entries.resize(header.entryCount);
+	for (Entry& entry : entries) {
+		IndexEntry indexEntry;
+		if (size_t(indexEnd - index) < sizeof(indexEntry)) {
+			break;
+		}
+		std::memcpy(&indexEntry, index, sizeof(indexEntry));
+		index += sizeof(indexEntry);
+		if (size_t(indexEnd - index) < indexEntry.pathLength || indexEntry.offset > mappingSize
+			|| indexEntry.storedSize > mappingSize - indexEntry.offset) {
+			break;
+		}
+		entry.path.assign(reinterpret_cast<const char*>(index), indexEntry.pathLength);
+		index += indexEntry.pathLength;
+		entry.offset = indexEntry.offset;
+		entry.storedSize = indexEntry.storedSize;
+		entry.size = indexEntry.size;
+		entry.compressed = (indexEntry.flags & ENTRY_COMPRESSED) != 0;
+		entry.valid = !entry.compressed;
+		lookup[normalizePath(entry.path)] = &entry - entries.data();
+	}
+	if (lookup.size() != entries.size()) {
+		std::cout << "Invalid archive index in " << path << std::endl;
+		close();
+		return false;
+	}
+	decompressed.reset(new std::once_flag[entries.size()]);
+	return true;
+}
+
+void Archive::close() {
+#ifdef _WIN32
+	if (mapping != nullptr) {
+		UnmapViewOfFile(mapping);
+	}
+	if (fileMapping != nullptr) {
+		CloseHandle(fileMapping);
+	}
+	if (file != nullptr) {
+		CloseHandle(file);
+	}
+#else
+	if (mapping != nullptr) {
+		munmap(const_cast<unsigned char*>(mapping), mappingSize);
+	}
+#endif
+	mapping = nullptr;
+	mappingSize = 0;
+	file = nullptr;
+	fileMapping = nullptr;
+	entries.clear();
+	lookup.clear();
+	decompressed.reset();
+}
+
+bool Archive::isOpen() const {
+	return mapping != nullptr;
+}
+
+size_t Archive::getEntryCount() const {
+	return entries.size();
+}
+
+void Archive::decompress(size_t index) {
+	Entry& entry = entries[index];
+	if (!entry.compressed) {
+		return;
+	}
+	std::call_once(decompressed[index], [this, &entry] {
+		entry.data.resize(size_t(entry.size));
+		entry.valid = lz4Decompress(mapping + entry.offset, size_t(entry.storedSize),
+			reinterpret_cast<unsigned char*>(entry.data.data()), entry.data.size());
+		if (!entry.valid) {
+			std::cout << "Corrupt archive entry " << entry.path << std::endl;
+			std::vector<char>().swap(entry.data);
+		}
+	});
+}
+
+void Archive::decompressAll(ThreadPool& pool) {
+	std::vector<size_t> compressed;
+	size_t bytes = 0;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i].compressed) {
+			compressed.push_back(i);
+			bytes += size_t(entries[i].size);
+		}
+	}
+	auto start = std::chrono::high_resolution_clock::now();
+	pool.parallelFor(int(compressed.size()), [this, &compressed](int i) {
+		decompress(compressed[i]);
+	});
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "Decompressed " << compressed.size() << " files (" << (bytes >> 10) << " KB) in " << ms << " ms" << std::endl;
+}
+
+bool Archive::contains(const std::string& path) const {
+	return lookup.find(normalizePath(path)) != lookup.end();
+}
+
+bool Archive::read(const std::string& path, const char*& data, size_t& size) {
+	auto found = lookup.find(normalizePath(path));
+	if (found == lookup.end()) {
+		return false;
+	}
+	decompress(found->second);
+	const Entry& entry = entries[found->second];
+	if (!entry.valid) {
+		return false;
+	}
+	data = entry.compressed ? entry.data.data() : reinterpret_cast<const char*>(mapping + entry.offset);
+	size = size_t(entry.size);
+	return true;
+}
+
+std::vector<std::string> Archive::list(const std::string& prefix) const {
+	std::string normalized = normalizePath(prefix);
+	std::vector<std::string> paths;
+	for (const auto& entry : lookup) {
+		if (entry.first.compare(0, normalized.size(), normalized) == 0) {
+			paths.push_back(entries[entry.second].path);
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+bool Archive::build(const std::string& directory, const std::string& archivePath, const std::vector<std::string>& excluded, ThreadPool& pool) {
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::string> normalizedExcluded;
+	for (const std::string& path : excluded) {
+		normalizedExcluded.push_back(normalizePath(path));
+	}
+	normalizedExcluded.push_back(normalizePath(archivePath));
+
+	std::vector<std::string> files;
+	listFiles(directory, files);
+	files.erase(std::remove_if(files.begin(), files.end(), [&normalizedExcluded](const std::string& path) {
+		return isExcluded(normalizePath(path), normalizedExcluded);
+	}), files.end());
+	std::sort(files.begin(), files.end());
+
+	// files are read and compressed in parallel, the archive is written in path order afterwards
+	std::vector<std::vector<char>> contents(files.size());
+	std::vector<std::vector<unsigned char>> compressed(files.size());
+	std::vector<unsigned char> readable(files.size(), 0);	// not vector<bool>, the workers write neighbouring entries
+	pool.parallelFor(int(files.size()), [&](int i) {
+		std::ifstream input(files[i], std::ios::binary | std::ios::ate);
+		if (!input) {
+			return;
+		}
+		contents[i].resize(size_t(input.tellg()));
+		input.seekg(0);
+		readable[i] = input.read(contents[i].data(), contents[i].size()) ? 1 : 0;
+		if (!readable[i] || !shouldCompress(normalizePath(files[i]))) {
+			return;
+		}
+		const unsigned char* source = reinterpret_cast<const unsigned char*>(contents[i].data());
+		compressed[i].resize(lz4CompressBound(contents[i].size()));
+		size_t size = lz4Compress(source, contents[i].size(), compressed[i].data(), compressed[i].size());
+		// already compressed formats (jpg, png, mp3) are stored, they would only cost decompression time
+		if (size == 0 || size > contents[i].size() - contents[i].size() / 8) {
+			size = 0;
+		}
+		compressed[i].resize(size);
+		compressed[i].shrink_to_fit();
+	});
+
+	std::ofstream output(archivePath, std::ios::binary);
+	if (!output) {
+		std::cout << "Could not create the archive " << archivePath << std::endl;
+		return false;
+	}
+	ArchiveHeader header = {};
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	std::vector<IndexEntry> index;
+	std::vector<std::string> paths;
+	unsigned long long offset = sizeof(header);
+	unsigned long long totalSize = 0;
+	for (size_t i = 0; i < files.size(); i++) {
+		if (!readable[i]) {
+			std::cout << "Could not read " << files[i] << std::endl;
+			continue;
+		}
+		IndexEntry entry;
+		entry.offset = offset;
+		entry.size = contents[i].size();
+		entry.flags = compressed[i].empty() ? 0 : ENTRY_COMPRESSED;
+		entry.storedSize = compressed[i].empty() ? contents[i].size() : compressed[i].size();
+		entry.pathLength = static_cast<unsigned int>(files[i].size());
+		if (compressed[i].empty()) {
+			output.write(contents[i].data(), contents[i].size());
+		}
+		else {
+			output.write(reinterpret_cast<const char*>(compressed[i].data()), compressed[i].size());
+		}
+		offset += entry.storedSize;
+		totalSize += entry.size;
+		index.push_back(entry);
+		paths.push_back(files[i]);
+	}
+
+	header.magic = ARCHIVE_MAGIC;
+	header.version = ARCHIVE_VERSION;
+	header.entryCount = static_cast<unsigned int>(index.size());
+	header.indexOffset = offset;
+	for (size_t i = 0; i < index.size(); i++) {
+		output.write(reinterpret_cast<const char*>(&index[i]), sizeof(IndexEntry));
+		output.write(paths[i].data(), paths[i].size());
+		header.indexSize += sizeof(IndexEntry) + paths[i].size();
+	}
+	output.seekp(0);
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (!output) {
+		std::cout << "Could not write the archive " << archivePath << std::endl;
+		return false;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "Packed " << index.size() << " files (" << (totalSize >> 10) << " KB) into " << archivePath
+		<< " (" << (offset >> 10) << " KB) in " << ms << " ms" << std::endl;
+	return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "../Jobs/ThreadPool.h"
+
+/*!
+ * Read only archive of many asset files in one file.
+ * The archive is memory mapped as a whole, an index at its end maps every path to a range of the file.
+ * Entries are stored LZ4 compressed, or uncompressed when that does not pay off. Uncompressed entries are read
+ * straight from the mapping without a copy, compressed ones are decompressed once and kept in memory.
+ */
+class Archive {
+private:
+	struct Entry {
+		std::string path;
+		unsigned long long offset;
+		unsigned long long storedSize;
+		unsigned long long size;
+		bool compressed;
+		bool valid;				// false if the compressed data is corrupt
+		std::vector<char> data;	// decompressed bytes of compressed entries
+	};
+
+	std::vector<Entry> entries;
+	std::unordered_map<std::string, size_t> lookup;	// normalized path -> entry
+	std::unique_ptr<std::once_flag[]> decompressed;
+	const unsigned char* mapping;
+	size_t mappingSize;
+	void* file;
+	void* fileMapping;
+
+	void decompress(size_t index);
+
+public:
+	Archive();
+	~Archive();
+
+	/*!
+	 * Maps the archive and reads its index, the file stays open until close()
+	 * @return false if the file does not exist or is not a valid archive
+	 */
+	bool open(const std::string& path);
+	void close();
+	bool isOpen() const;
+
+	/*!
+	 * Decompresses all compressed entries on the workers and the calling thread, in file order
+	 */
+	void decompressAll(ThreadPool& pool);
+
+	bool contains(const std::string& path) const;
+
+	/*!
+	 * @param data: set to the bytes of the file, valid as long as the archive is open
+	 * @return false if the archive has no such file or its data is corrupt
+	 */
+	bool read(const std::string& path, const char*& data, size_t& size);
+
+	/*!
+	 * @return paths of all files whose normalized path starts with the normalized prefix
+	 */
+	std::vector<std::string> list(const std::string& prefix) const;
+
+	size_t getEntryCount() const;
+
+	/*!
+	 * Packs every file below directory into an archive, files are compressed on the thread pool
+	 * @param excluded: files and directories that stay loose, e.g. files the game writes
+	 */
+	static bool build(const std::string& directory, const std::string& archivePath, const std::vector<std::string>& excluded, ThreadPool& pool);
+
+	/*!
+	 * @return the path in lower case with forward slashes and without "." and ".." parts
+	 */
+	static std::string normalizePath(const std::string& path);
+};
@@ -0,0 +1,79 @@
+#include "AssimpIOSystem.h"
+#include <cstring>
+
+AssimpMemoryStream::AssimpMemoryStream(const FileData& file)
+	: file(file), position(0) {
+}
+
+size_t AssimpMemoryStream::Read(void* buffer, size_t size, size_t count) {
+	if (size == 0 || position >= file.size()) {
+		return 0;
+	}
+	size_t available = (file.size() - position) / size;
+	count = count < available ? count : available;
+	std::memcpy(buffer, file.data() + position, size * count);
+	position += size * count;
+	return count;
+}
+
+size_t AssimpMemoryStream::Write(const void*, size_t, size_t) {
+	return 0;
+}
+
+aiReturn AssimpMemoryStream::Seek(size_t offset, aiOrigin origin) {
+	size_t target;
+	switch (origin) {
+	case aiOrigin_SET:
+		target = offset;
+		break;
+	case aiOrigin_CUR:
+		target = position + offset;
+		break;
+	case aiOrigin_END:
+		// Assimp passes the distance from the end
+		if (offset > file.size()) {
+			return aiReturn_FAILURE;
+		}
+		target = file.size() - offset;
+		break;
+	default:
+		return aiReturn_FAILURE;
+	}
+	if (target > file.size()) {
+		return aiReturn_FAILURE;
+	}
+	position = target;
+	return aiReturn_SUCCESS;
+}
+
+size_t AssimpMemoryStream::Tell() const {
+	return position;
+}
+
+size_t AssimpMemoryStream::FileSize() const {
+	return file.size();
+}
+
+void AssimpMemoryStream::Flush() {}
+
+bool AssimpIOSystem::Exists(const char* path) const {
+	FileSystem* fileSystem = FileSystem::getInstance();
+	return fileSystem != nullptr ? fileSystem->exists(path) : FileSystem::readFile(path).isValid();
+}
+
+char AssimpIOSystem::getOsSeparator() const {
+	return '/';
+}
+
+Assimp::IOStream* AssimpIOSystem::Open(const char* path, const char* mode) {
+	// the archive is read only
+	if (std::strchr(mode, 'w') != nullptr || std::strchr(mode, 'a') != nullptr) {
+		return nullptr;
+	}
+	FileData file = FileSystem::readFile(path);
+	return file.isValid() ? new AssimpMemoryStream(file) : nullptr;
+}
+
+void AssimpIOSystem::Close(Assimp::IOStream* stream) {
+	delete stream;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include "FileSystem.h"
+
+/*!
+ * Read only stream over the bytes of a file of the virtual file system
+ */
+class AssimpMemoryStream : public Assimp::IOStream {
+private:
+	FileData file;
+	size_t position;
+
+public:
+	AssimpMemoryStream(const FileData& file);
+
+	size_t Read(void* buffer, size_t size, size_t count) override;
+	size_t Write(const void* buffer, size_t size, size_t count) override;
+	aiReturn Seek(size_t offset, aiOrigin origin) override;
+	size_t Tell() const override;
+	size_t FileSize() const override;
+	void Flush() override;
+};
+
+/*!
+ * Lets Assimp open models and the files they reference (.mtl) through the virtual file system,
+ * set it with Importer::SetIOHandler, the importer deletes it
+ */
+class AssimpIOSystem : public Assimp::IOSystem {
+public:
+	bool Exists(const char* path) const override;
+	char getOsSeparator() const override;
+	Assimp::IOStream* Open(const char* path, const char* mode = "rb") override;
+	void Close(Assimp::IOStream* stream) override;
+};
@@ -0,0 +1,99 @@
+#include "FileSystem.h"
+#include <iostream>
+#include <fstream>
+
+FileSystem* FileSystem::instance = nullptr;
+
+bool FileData::isValid() const {
+	return bytes != nullptr;
+}
+
+const char* FileData::data() const {
+	return bytes;
+}
+
+const unsigned char* FileData::bytesData() const {
+	return reinterpret_cast<const unsigned char*>(bytes);
+}
+
+size_t FileData::size() const {
+	return length;
+}
+
+std::string FileData::toString() const {
+	return bytes != nullptr ? std::string(bytes, length) : std::string();
+}
+
+FileSystem::FileSystem() {
+	instance = this;
+}
+
+FileSystem::~FileSystem() {
+	if (instance == this) {
+		instance = nullptr;
+	}
+}
+
+FileSystem* FileSystem::getInstance() {
+	return instance;
+}
+
+FileData FileSystem::readFile(const std::string& path) {
+	return instance != nullptr ? instance->read(path) : readLooseFile(path);
+}
+
+FileData FileSystem::readLooseFile(const std::string& path) {
+	FileData file;
+	std::ifstream input(path, std::ios::binary | std::ios::ate);
+	if (!input) {
+		return file;
+	}
+	file.buffer = std::make_shared<std::vector<char>>(size_t(input.tellg()));
+	input.seekg(0);
+	// one extra byte, so an empty file still has a valid pointer
+	file.buffer->reserve(file.buffer->size() + 1);
+	if (!input.read(file.buffer->data(), file.buffer->size())) {
+		file.buffer.reset();
+		return file;
+	}
+	file.bytes = file.buffer->data();
+	file.length = file.buffer->size();
+	return file;
+}
+
+bool FileSystem::mount(const std::string& archivePath) {
+	if (!archive.open(archivePath)) {
+		return false;
+	}
+	std::cout << "Mounted " << archivePath << " with " << archive.getEntryCount() << " files" << std::endl;
+	return true;
+}
+
+bool FileSystem::isMounted() const {
+	return archive.isOpen();
+}
+
+void FileSystem::decompressAll(ThreadPool& pool) {
+	if (archive.isOpen()) {
+		archive.decompressAll(pool);
+	}
+}
+
+bool FileSystem::exists(const std::string& path) const {
+	if (archive.contains(path)) {
+		return true;
+	}
+	return bool(std::ifstream(path, std::ios::binary));
+}
+
+FileData FileSystem::read(const std::string& path) {
+	FileData file;
+	if (archive.read(path, file.bytes, file.length)) {
+		return file;
+	}
+	return readLooseFile(path);
+}
+
+std::vector<std::string> FileSystem::listArchived(const std::string& directory) const {
+	return archive.list(directory);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include "Archive.h"
+
+/*!
+ * Bytes of one file, either a view into the mounted archive or an owned copy of a loose file
+ */
+class FileData {
+private:
+	const char* bytes = nullptr;
+	size_t length = 0;
+	std::shared_ptr<std::vector<char>> buffer;
+
+	friend class FileSystem;
+
+public:
+	bool isValid() const;
+	const char* data() const;
+	const unsigned char* bytesData() const;
+	size_t size() const;
+	std::string toString() const;
+};
+
+/*!
+ * Virtual file system of the assets. Files are looked up in the mounted archive first and read from disk
+ * otherwise, so a missing archive or a file that is not packed (settings, highscores) still works.
+ * Data of archived files stays valid as long as the file system exists.
+ * Create it before anything is loaded, the file system that was created last is used by the loaders.
+ */
+class FileSystem {
+private:
+	static FileSystem* instance;
+
+	Archive archive;
+
+	static FileData readLooseFile(const std::string& path);
+
+public:
+	FileSystem();
+	~FileSystem();
+
+	/*!
+	 * @return the file system used by the loaders, nullptr if there is none
+	 */
+	static FileSystem* getInstance();
+
+	/*!
+	 * Reads a file with the file system if there is one, from disk otherwise
+	 * @return invalid data if the file does not exist
+	 */
+	static FileData readFile(const std::string& path);
+
+	/*!
+	 * Opens and maps the archive, its files hide loose files with the same path
+	 * @return false if there is no valid archive at the path, loose files are used then
+	 */
+	bool mount(const std::string& archivePath);
+	bool isMounted() const;
+
+	/*!
+	 * Decompresses everything in the archive up front on the thread pool, otherwise files are decompressed
+	 * on their first read
+	 */
+	void decompressAll(ThreadPool& pool);
+
+	bool exists(const std::string& path) const;
+	FileData read(const std::string& path);
+
+	/*!
+	 * @return paths of the archived files below a directory
+	 */
+	std::vector<std::string> listArchived(const std::string& directory) const;
+};
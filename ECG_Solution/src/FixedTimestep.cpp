@@ -0,0 +1,29 @@
+#include "FixedTimestep.h"
+#include <algorithm>
+
+FixedTimestep::FixedTimestep(float rate, int maxSteps)
+	: step(1.0f / std::max(rate, 1.0f)), maxSteps(std::max(maxSteps, 1)), accumulator(0.0f) {
+}
+
+int FixedTimestep::advance(float frameTime) {
+	accumulator += std::max(frameTime, 0.0f);
+	int steps = int(accumulator / step);
+	if (steps > maxSteps) {
+		steps = maxSteps;
+		accumulator = step * steps;
+	}
+	accumulator -= step * steps;
+	return steps;
+}
+
+float FixedTimestep::getStep() const {
+	return step;
+}
+
+float FixedTimestep::getAlpha() const {
+	return std::min(accumulator / step, 1.0f);
+}
+
+void FixedTimestep::reset() {
+	accumulator = 0.0f;
+}
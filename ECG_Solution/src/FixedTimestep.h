@@ -0,0 +1,39 @@
+#pragma once
+
+/*!
+ * Turns the variable frame time into a whole number of simulation steps of the same length.
+ * Time that does not fill a step stays in the accumulator for the next frame, getAlpha() tells how far the
+ * rendered frame lies between the last two steps. A frame never runs more than maxSteps steps, the rest of a
+ * long frame is dropped so a slow machine does not fall further behind every frame.
+ */
+class FixedTimestep {
+private:
+	float step;
+	int maxSteps;
+	float accumulator;
+
+public:
+	/*!
+	 * @param rate: steps per second
+	 * @param maxSteps: most steps one frame may run
+	 */
+	FixedTimestep(float rate, int maxSteps);
+
+	/*!
+	 * Adds the time of a frame
+	 * @return number of steps to run this frame
+	 */
+	int advance(float frameTime);
+
+	/*!
+	 * @return length of a step in seconds
+	 */
+	float getStep() const;
+
+	/*!
+	 * @return 0 at the second to last step, 1 at the last one
+	 */
+	float getAlpha() const;
+
+	void reset();
+};
@@ -152,14 +152,22 @@ void Geometry::draw(glm::mat4 matrix)
 	glm::mat4 accumModel = matrix * _transformMatrix * _modelMatrix;
 
 	if (_isCharacter || _viewFrustum->boxInFrustum(_boudingBox) != FrustumG::OUTSIDE) {
-		if (!_isEmpty) {
+		if (!_isEmpty && _batch != nullptr) {
+			_material->requestTextures(getBoundingSphereCenter(accumModel), getBoundingSphereRadius());
+			_batch->queue(_batchMesh, accumModel, _material->getMaterialIndex());
+			(*_drawnObjects)++;
+		}
+		else if (!_isEmpty) {
 			Shader* shader = _material->getShader();
 			shader->use();
 
 			shader->setUniform("modelMatrix", accumModel);
 			shader->setUniform("normalMatrix", glm::mat3(glm::transpose(glm::inverse(accumModel))));
+			_material->requestTextures(getBoundingSphereCenter(accumModel), getBoundingSphereRadius());
 			_material->setUniforms();
 
+			// the shader takes matrices and material from the uniforms
+			glVertexAttribI1ui(DrawBatch::DRAW_ID_LOCATION, DrawBatch::NO_DRAW);
 			glBindVertexArray(_vao);
 			glDrawElements(GL_TRIANGLES, _elements, GL_UNSIGNED_INT, 0);
 			glBindVertexArray(0);
@@ -185,7 +193,6 @@ void Geometry::draw(Shader* shader, glm::mat4 matrix)
 
 			shader->setUniform("modelMatrix", accumModel);
 			shader->setUniform("normalMatrix", glm::mat3(glm::transpose(glm::inverse(accumModel))));
-			shader->setUniform("isTerrain", false);
 
 			glBindVertexArray(_vao);
 			glDrawElements(GL_TRIANGLES, _elements, GL_UNSIGNED_INT, 0);
@@ -202,6 +209,33 @@ void Geometry::draw(Shader* shader, glm::mat4 matrix)
 
 }
 
+glm::vec3 Geometry::getBoundingSphereCenter(const glm::mat4& matrix)
+{
+	// the box of the character is not moved with it, its transformation is used instead
+	if (_isCharacter || !_boudingBox || _boudingBox->empty()) {
+		return glm::vec3(matrix[3]);
+	}
+	glm::vec3 center = glm::vec3(0.0f);
+	for (const glm::vec3& corner : *_boudingBox) {
+		center += corner;
+	}
+	return center / float(_boudingBox->size());
+}
+
+float Geometry::getBoundingSphereRadius()
+{
+	if (!_boudingBox || _boudingBox->empty()) {
+		return 1.0f;
+	}
+	glm::vec3 minCorner = _boudingBox->at(0);
+	glm::vec3 maxCorner = _boudingBox->at(0);
+	for (const glm::vec3& corner : *_boudingBox) {
+		minCorner = glm::min(minCorner, corner);
+		maxCorner = glm::max(maxCorner, corner);
+	}
+	return glm::length(maxCorner - minCorner) * 0.5f;
+}
+
 void Geometry::transform(glm::mat4 transformation)
 {
 	_modelMatrix = transformation * _modelMatrix;
@@ -223,6 +257,17 @@ Geometry* Geometry::addChild(std::shared_ptr<Geometry> child)
 	return (_children.end() - 1)->get();
 }
 
+void Geometry::setBatch(DrawBatch* batch)
+{
+	if (!_isEmpty) {
+		_batch = batch;
+		_batchMesh = batch->add(_vboPositions, _vboNormals, _vboUVs, _vboIndices, vector_size, _elements);
+	}
+	for (size_t i = 0; i < _children.size(); i++) {
+		_children[i]->setBatch(batch);
+	}
+}
+
 
 physx::PxRigidActor* Geometry::getActor() {
 	return _actor;
@@ -16,6 +16,7 @@
 #include <glm\gtc\matrix_transform.hpp>
 #include "Shader.h"
 #include "Material.h"
+#include "DrawBatch.h"
 
 /* GAMEPLAY */
 #include "FrustumG.h"
@@ -52,6 +53,8 @@ protected:
 	//unsigned int _elements;
 
 	std::shared_ptr<Material> _material;
+	DrawBatch* _batch = nullptr;
+	int _batchMesh = -1;
 
 	glm::mat4 _modelMatrix;
 	glm::mat4 _transformMatrix;
@@ -92,5 +95,12 @@ public:
 	void resetModelMatrix();
 	void updateBoundingBox(glm::vec3 posDelta);
 	void drawDebug(glm::mat4 matrix, std::string name);
+	glm::vec3 getBoundingSphereCenter(const glm::mat4& matrix);
+	float getBoundingSphereRadius();
 	Geometry* addChild(std::shared_ptr<Geometry> child);
+
+	/*!
+	 * Adds this geometry and its children to the batch, draw() queues them there from now on
+	 */
+	void setBatch(DrawBatch* batch);
 };
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "GrassRenderer.h"
+
+// vertices of one blade, see grass.vert
+static const GLuint BLADE_VERTICES = 7;
+
+GrassRenderer::GrassRenderer(GLuint computeShader, std::shared_ptr<Shader> shader, const char* densityMaskPath, float quality, float maxDistance)
+	: _computeShader(computeShader), _shader(shader), _densityMask(densityMaskPath, true), _maxDistance(maxDistance)
+{
+	// quality scales the number of blades per area, not the spacing
+	_cellSize = quality > 0.0f ? 0.5f / glm::sqrt(quality) : 0.0f;
+
+	// square grid of whole 16x16 tiles that covers the view distance
+	gridSize = 0;
+	if (_cellSize > 0.0f) {
+		int tiles = int(glm::ceil(2.0f * maxDistance / (_cellSize * 16))) + 1;
+		gridSize = tiles * 16;
+	}
+}
+
+GrassRenderer::~GrassRenderer() {
+	glDeleteBuffers(1, &instanceBuffer);
+	glDeleteBuffers(1, &commandBuffer);
+	glDeleteVertexArrays(1, &vao);
+}
+
+void GrassRenderer::init() {
+	// there can never be more blades than cells, so the append can not overflow
+	GLsizeiptr maxInstances = GLsizeiptr(gridSize) * gridSize;
+	glGenBuffers(1, &instanceBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, glm::max(maxInstances, GLsizeiptr(1)) * 2 * sizeof(glm::vec4), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// count, instance count, first, base instance
+	GLuint command[4] = { BLADE_VERTICES, 0, 0, 0 };
+	glGenBuffers(1, &commandBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), command, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	// blades are built from gl_VertexID and the instance buffer, the VAO stays empty
+	glGenVertexArrays(1, &vao);
+
+	gridOriginPos = glGetUniformLocation(_computeShader, "GridOrigin");
+	cellSizePos = glGetUniformLocation(_computeShader, "CellSize");
+	cameraPositionPos = glGetUniformLocation(_computeShader, "CameraPosition");
+	maximumDistancePos = glGetUniformLocation(_computeShader, "MaximumDistance");
+	frustumPlanesPos = glGetUniformLocation(_computeShader, "FrustumPlanes");
+	heightMapPos = glGetUniformLocation(_computeShader, "heightMap");
+	densityMaskPos = glGetUniformLocation(_computeShader, "densityMask");
+	scaleXZPos = glGetUniformLocation(_computeShader, "scaleXZ");
+	scaleYPos = glGetUniformLocation(_computeShader, "scaleY");
+}
+
+void GrassRenderer::calculate(glm::mat4 viewProjection, glm::vec3 cameraPosition, GLuint heightMap, float scaleXZ, float scaleY) {
+	if (gridSize == 0) {
+		return;
+	}
+
+	// frustum planes from the view projection matrix (Gribb/Hartmann)
+	glm::mat4 m = glm::transpose(viewProjection);
+	glm::vec4 planes[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+	for (glm::vec4& plane : planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	// the grid follows the camera in whole tiles, cells keep their world position
+	float tileSize = _cellSize * 16;
+	glm::ivec2 cameraTile = glm::ivec2(glm::floor(glm::vec2(cameraPosition.x, cameraPosition.z) / tileSize));
+	int tiles = gridSize / 16;
+	glm::ivec2 gridOrigin = (cameraTile - tiles / 2) * 16;
+
+	GLuint zero = 0;
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, sizeof(GLuint), sizeof(GLuint), &zero);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glUseProgram(_computeShader);
+	glUniform2i(gridOriginPos, gridOrigin.x, gridOrigin.y);
+	glUniform1f(cellSizePos, _cellSize);
+	glUniform3fv(cameraPositionPos, 1, glm::value_ptr(cameraPosition));
+	glUniform1f(maximumDistancePos, _maxDistance);
+	glUniform4fv(frustumPlanesPos, 6, glm::value_ptr(planes[0]));
+	glUniform1f(scaleXZPos, scaleXZ);
+	glUniform1f(scaleYPos, scaleY);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, heightMap);
+	glUniform1i(heightMapPos, 0);
+	_densityMask.bind(1);
+	glUniform1i(densityMaskPos, 1);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer);
+	glDispatchCompute(tiles, tiles, 1);
+
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	glUseProgram(0);
+}
+
+void GrassRenderer::draw(glm::mat4 viewProjection, glm::vec3 lightPosition, float brightness, float time) {
+	if (gridSize == 0) {
+		return;
+	}
+
+	_shader->use();
+	_shader->setUniform("viewProjMatrix", viewProjection);
+	_shader->setUniform("lightPosition", lightPosition);
+	_shader->setUniform("brightness", brightness);
+	_shader->setUniform("time", time);
+
+	// blades are seen from both sides
+	GLboolean culling = glIsEnabled(GL_CULL_FACE);
+	glDisable(GL_CULL_FACE);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBindVertexArray(vao);
+	glDrawArraysIndirect(GL_TRIANGLE_STRIP, 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	if (culling) {
+		glEnable(GL_CULL_FACE);
+	}
+	_shader->unuse();
+}
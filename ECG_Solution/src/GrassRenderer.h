@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "Utils.h"
+#include "Shader.h"
+#include "Texture.h"
+
+/*!
+ * Ground cover that is placed, culled and counted entirely on the GPU.
+ * Every frame a compute shader walks a grid of cells around the camera, places at most one blade per cell
+ * (hashed jitter, so the pattern stays fixed in world space) and appends visible blades to an instance buffer.
+ * The number of appended blades is written straight into an indirect draw command.
+ */
+class GrassRenderer
+{
+private:
+	GLuint _computeShader;
+	std::shared_ptr<Shader> _shader;
+	Texture _densityMask;
+
+	GLuint instanceBuffer;
+	GLuint commandBuffer;
+	GLuint vao;
+
+	float _cellSize;
+	float _maxDistance;
+	int gridSize;
+
+	GLint gridOriginPos, cellSizePos, cameraPositionPos, maximumDistancePos, frustumPlanesPos;
+	GLint heightMapPos, densityMaskPos, scaleXZPos, scaleYPos;
+
+public:
+	/*!
+	 * @param computeShader: program of grass.comp
+	 * @param shader: shader that draws the blades
+	 * @param densityMaskPath: mask that adds grass on top of the grass region of the terrain
+	 * @param quality: density scale, 1 is one blade every 0.5 units, 0 disables the grass
+	 * @param maxDistance: blades further away from the camera are not generated
+	 */
+	GrassRenderer(GLuint computeShader, std::shared_ptr<Shader> shader, const char* densityMaskPath, float quality, float maxDistance = 60.0f);
+	~GrassRenderer();
+
+	void init();
+
+	/*!
+	 * Generates the visible blades for this frame
+	 * @param heightMap: texture id of the terrain heightmap
+	 */
+	void calculate(glm::mat4 viewProjection, glm::vec3 cameraPosition, GLuint heightMap, float scaleXZ, float scaleY);
+
+	void draw(glm::mat4 viewProjection, glm::vec3 lightPosition, float brightness, float time);
+};
@@ -0,0 +1,65 @@
+#include "Image.h"
+#include <iostream>
+#include "stb_image.h"
+#include "FileSystem/FileSystem.h"
+
+Image::Image(const char* path) {
+	int nrChannels;
+	FileData file = FileSystem::readFile(path);
+	unsigned char* data = file.isValid() ? stbi_load_from_memory(file.bytesData(), int(file.size()), &width, &height, &nrChannels, 4) : nullptr;
+	if (data) {
+		pixels.assign(data, data + 4 * width * height);
+	}
+	else {
+		std::cout << "Failed to load image: " << path << std::endl;
+		width = 0;
+		height = 0;
+	}
+	stbi_image_free(data);
+}
+
+Image::~Image() {}
+
+bool Image::isValid() const {
+	return !pixels.empty();
+}
+
+int Image::getWidth() const {
+	return width;
+}
+
+int Image::getHeight() const {
+	return height;
+}
+
+const unsigned char* Image::getPixels() const {
+	return pixels.data();
+}
+
+unsigned char Image::getPixel(int x, int y, int channel) const {
+	if (pixels.empty()) {
+		return 0;
+	}
+	x = glm::clamp(x, 0, width - 1);
+	y = glm::clamp(y, 0, height - 1);
+	return pixels[4 * (y * width + x) + channel];
+}
+
+float Image::sample(glm::vec2 uv, int channel) const {
+	int x = int(glm::floor(uv.x * width));
+	int y = int(glm::floor(uv.y * height));
+	return float(getPixel(x, y, channel)) / 255;
+}
+
+float Image::sampleLinear(glm::vec2 uv, int channel) const {
+	float x = uv.x * width - 0.5f;
+	float y = uv.y * height - 0.5f;
+	int x0 = int(glm::floor(x));
+	int y0 = int(glm::floor(y));
+	float fx = x - x0;
+	float fy = y - y0;
+
+	float top = glm::mix(float(getPixel(x0, y0, channel)), float(getPixel(x0 + 1, y0, channel)), fx);
+	float bottom = glm::mix(float(getPixel(x0, y0 + 1, channel)), float(getPixel(x0 + 1, y0 + 1, channel)), fx);
+	return glm::mix(top, bottom, fy) / 255;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+/*!
+ * RGBA8 image kept in CPU memory, so several systems can do lookups
+ * into the same mask or heightmap without loading it again
+ */
+class Image {
+private:
+	int width, height;
+	std::vector<unsigned char> pixels;
+
+public:
+	/*!
+	 * Loads the image, every pixel is expanded to 4 channels
+	 * @param path: path to the image file
+	 */
+	Image(const char* path);
+	~Image();
+
+	bool isValid() const;
+	int getWidth() const;
+	int getHeight() const;
+
+	/*!
+	 * @return RGBA8 rows from the top, width * height * 4 bytes
+	 */
+	const unsigned char* getPixels() const;
+
+	/*!
+	 * @return the value of a channel at the given pixel, coordinates are clamped to the image
+	 */
+	unsigned char getPixel(int x, int y, int channel = 0) const;
+
+	/*!
+	 * Nearest neighbour lookup with normalized coordinates
+	 * @param uv: position in [0, 1], values outside are clamped
+	 * @param channel: channel to read (0 = red)
+	 * @return value of the channel in [0, 1]
+	 */
+	float sample(glm::vec2 uv, int channel = 0) const;
+
+	/*!
+	 * Bilinear lookup with normalized coordinates, pixel centers like GL_LINEAR
+	 * @param uv: position in [0, 1], values outside are clamped
+	 * @param channel: channel to read (0 = red)
+	 * @return value of the channel in [0, 1]
+	 */
+	float sampleLinear(glm::vec2 uv, int channel = 0) const;
+};
@@ -0,0 +1,227 @@
+#include "JobGraph.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <exception>
+
+namespace {
+	// an exception must not leave a worker job started but never done, the graph would wait for it forever
+	bool runWork(const std::function<void()>& work, std::string& error) {
+		try {
+			work();
+			return true;
+		}
+		catch (const std::exception& exception) {
+			error = exception.what();
+		}
+		catch (...) {
+			error = "unknown exception";
+		}
+		return false;
+	}
+}
+
+JobGraph::JobGraph(ThreadPool& pool)
+	: pool(pool), begun(false), stalled(false), failed(false), totalTime(0.0) {
+}
+
+JobGraph::~JobGraph() {
+	for (std::future<void>& future : futures) {
+		future.wait();
+	}
+}
+
+double JobGraph::now() const {
+	return std::chrono::duration<double>(Clock::now() - runStart).count();
+}
+
+int JobGraph::add(const std::string& name, Thread thread, std::function<void()> work, const std::vector<int>& dependencies) {
+	int id = int(jobs.size());
+	Job job;
+	job.name = name;
+	job.thread = thread;
+	job.work = std::move(work);
+	job.waitingFor = int(dependencies.size());
+	jobs.push_back(std::move(job));
+	for (int dependency : dependencies) {
+		jobs[dependency].dependents.push_back(id);
+	}
+	return id;
+}
+
+void JobGraph::finish(int job) {
+	if (jobs[job].threw) {
+		jobs[job].failed = true;
+		std::cout << "Job " << jobs[job].name << " failed: " << jobs[job].error << std::endl;
+		failed = true;
+		return;
+	}
+	jobs[job].done = true;
+	finished.push_back(job);
+	for (int dependent : jobs[job].dependents) {
+		jobs[dependent].waitingFor--;
+	}
+}
+
+bool JobGraph::step(bool wait) {
+	if (!begun) {
+		runStart = Clock::now();
+		begun = true;
+	}
+	if (isFinished()) {
+		return true;
+	}
+	if (failed) {
+		return false;
+	}
+
+	// everything that became ready goes to the workers first, so they are busy while this thread works
+	int mainJob = -1;
+	for (int i = 0; i < int(jobs.size()); i++) {
+		Job& job = jobs[i];
+		if (job.started || job.waitingFor > 0) {
+			continue;
+		}
+		if (job.thread == Thread::Main) {
+			mainJob = mainJob < 0 ? i : mainJob;
+			continue;
+		}
+		job.started = true;
+		job.start = now();
+		futures.push_back(pool.submit([this, i] {
+			std::string error;
+			bool succeeded = runWork(jobs[i].work, error);
+			double end = now();
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs[i].duration = end - jobs[i].start;
+			jobs[i].threw = !succeeded;
+			jobs[i].error = error;
+			completed.push_back(i);
+			condition.notify_one();
+		}));
+	}
+
+	if (mainJob >= 0) {
+		Job& job = jobs[mainJob];
+		job.started = true;
+		job.start = now();
+		job.threw = !runWork(job.work, job.error);
+		job.duration = now() - job.start;
+		finish(mainJob);
+	}
+	else {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (completed.empty()) {
+			bool running = false;
+			for (const Job& job : jobs) {
+				running = running || (job.started && !job.done && !job.failed);
+			}
+			if (!running) {
+				if (!stalled) {
+					std::cout << "Job graph stalled, " << jobs.size() - finished.size() << " jobs wait for each other" << std::endl;
+				}
+				stalled = true;
+				return false;
+			}
+			if (wait) {
+				condition.wait_for(lock, std::chrono::milliseconds(30));
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!completed.empty()) {
+			finish(completed.front());
+			completed.pop_front();
+		}
+	}
+	if (isFinished()) {
+		totalTime = now();
+	}
+	return !failed;
+}
+
+void JobGraph::run(const std::function<void()>& progress) {
+	while (!isFinished() && step(true)) {
+		progress();
+	}
+}
+
+void JobGraph::runUntil(const std::vector<int>& required, const std::function<void()>& progress) {
+	auto requiredDone = [this, &required] {
+		for (int job : required) {
+			if (!jobs[job].done) {
+				return false;
+			}
+		}
+		return true;
+	};
+	while (!requiredDone() && step(true)) {
+		progress();
+	}
+}
+
+bool JobGraph::update() {
+	step(false);
+	return isFinished();
+}
+
+bool JobGraph::isFinished() const {
+	return finished.size() == jobs.size();
+}
+
+bool JobGraph::hasFailed() const {
+	return failed;
+}
+
+int JobGraph::getJobCount() const {
+	return int(jobs.size());
+}
+
+int JobGraph::getFinishedCount() const {
+	return int(finished.size());
+}
+
+int JobGraph::getFinishedJob(int index) const {
+	return finished[index];
+}
+
+const std::string& JobGraph::getName(int job) const {
+	return jobs[job].name;
+}
+
+bool JobGraph::isRunning(int job) const {
+	return jobs[job].started && !jobs[job].done && !jobs[job].failed;
+}
+
+bool JobGraph::isDone(int job) const {
+	return jobs[job].done;
+}
+
+double JobGraph::getDuration(int job) const {
+	return jobs[job].duration;
+}
+
+double JobGraph::getTotalTime() const {
+	return totalTime;
+}
+
+void JobGraph::printReport() const {
+	std::vector<int> order(jobs.size());
+	double sum = 0.0;
+	for (size_t i = 0; i < jobs.size(); i++) {
+		order[i] = int(i);
+		sum += jobs[i].duration;
+	}
+	std::sort(order.begin(), order.end(), [this](int a, int b) { return jobs[a].start < jobs[b].start; });
+
+	std::cout << std::fixed << std::setprecision(1);
+	for (int i : order) {
+		const Job& job = jobs[i];
+		std::cout << std::setw(8) << job.start * 1000.0 << " ms  " << std::setw(8) << job.duration * 1000.0 << " ms  "
+			<< (job.thread == Thread::Main ? "main   " : "worker ") << job.name << std::endl;
+	}
+	std::cout << "Loading took " << totalTime * 1000.0 << " ms, the jobs alone " << sum * 1000.0 << " ms" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include "ThreadPool.h"
+
+/*!
+ * Named jobs that run in dependency order.
+ * Worker jobs go to the thread pool as soon as everything they depend on is done, main jobs run on the thread
+ * that calls run() (the one with the GL context), one at a time in the order they were added.
+ * Between jobs and while waiting for the workers run() calls a progress callback, so a splash screen stays alive.
+ * runUntil() returns as soon as some jobs are done, update() then runs the rest a step per frame.
+ * Every job is timed, the timings can be shown while loading and are printed by printReport().
+ * A job that throws is reported and stops the graph, no further job is started and its dependents never run.
+ */
+class JobGraph {
+public:
+	enum class Thread { Worker, Main };
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Job {
+		std::string name;
+		Thread thread;
+		std::function<void()> work;
+		std::vector<int> dependents;
+		int waitingFor = 0;		// dependencies that are not done yet
+		bool started = false;
+		bool done = false;
+		bool threw = false;		// set with error by the thread that ran the job
+		std::string error;
+		bool failed = false;	// threw and was reported, never done
+		double start = 0.0;		// seconds since the first step
+		double duration = 0.0;
+	};
+
+	ThreadPool& pool;
+	std::vector<Job> jobs;
+	std::vector<std::future<void>> futures;
+	Clock::time_point runStart;
+	bool begun;
+	bool stalled;
+	bool failed;
+	double totalTime;
+	std::vector<int> finished;	// jobs in the order they were done
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<int> completed;	// worker jobs that finished, their dependents are released by the next step
+
+	double now() const;
+	void finish(int job);
+
+	/*!
+	 * Starts the worker jobs that are ready, runs at most one main job and releases the dependents of finished jobs
+	 * @param wait: without a main job to run, wait up to 30 ms for a worker
+	 * @return false if the remaining jobs wait for each other or a job failed
+	 */
+	bool step(bool wait);
+
+public:
+	JobGraph(ThreadPool& pool);
+	~JobGraph();
+
+	/*!
+	 * Adds a job, dependencies have to be added before
+	 * @param thread: Worker for CPU work, Main for everything that touches GL
+	 * @param dependencies: jobs that have to be done before this one starts
+	 * @return id of the job
+	 */
+	int add(const std::string& name, Thread thread, std::function<void()> work, const std::vector<int>& dependencies = std::vector<int>());
+
+	/*!
+	 * Runs all jobs and returns once they are done
+	 * @param progress: called on this thread after every main job and about every 30 ms while waiting
+	 */
+	void run(const std::function<void()>& progress);
+
+	/*!
+	 * Runs jobs until the required ones are done, the others keep going and are finished by update()
+	 */
+	void runUntil(const std::vector<int>& required, const std::function<void()>& progress);
+
+	/*!
+	 * One step without waiting, at most one main job runs, for the frame loop after runUntil()
+	 * @return true once all jobs are done
+	 */
+	bool update();
+	bool isFinished() const;
+
+	/*!
+	 * @return true once a job threw, the graph does not start any job from then on
+	 */
+	bool hasFailed() const;
+
+	int getJobCount() const;
+	int getFinishedCount() const;
+
+	/*!
+	 * @return the job that was done as the index-th one
+	 */
+	int getFinishedJob(int index) const;
+	const std::string& getName(int job) const;
+	bool isRunning(int job) const;
+	bool isDone(int job) const;
+
+	/*!
+	 * @return seconds the job ran, valid once it is done
+	 */
+	double getDuration(int job) const;
+
+	/*!
+	 * @return seconds from the first step until all jobs were done, valid once isFinished()
+	 */
+	double getTotalTime() const;
+
+	/*!
+	 * Prints every job with its thread, start and duration, and the total against the sum of all jobs
+	 */
+	void printReport() const;
+};
@@ -0,0 +1,107 @@
+#include "PhysXDispatcher.h"
+#include <PxPhysicsAPI.h>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+	double stepScene(physx::PxPhysics& physics, physx::PxCpuDispatcher* dispatcher, int enemyCount) {
+		using namespace physx;
+		const int warmupSteps = 30;
+		const int measuredSteps = 120;
+
+		PxSceneDesc sceneDesc(physics.getTolerancesScale());
+		sceneDesc.gravity = PxVec3(0.0f, -9.8f, 0.0f);
+		sceneDesc.cpuDispatcher = dispatcher;
+		sceneDesc.filterShader = PxDefaultSimulationFilterShader;
+		PxScene* scene = physics.createScene(sceneDesc);
+		PxMaterial* material = physics.createMaterial(0.5f, 0.5f, 0.5f);
+		scene->addActor(*PxCreatePlane(physics, PxPlane(0, 1, 0, 0), *material));
+
+		// the enemies start on a grid and all run to the center, so they pile up and collide
+		std::vector<PxRigidDynamic*> enemies;
+		int columns = int(std::ceil(std::sqrt(float(enemyCount))));
+		PxQuat upright(PxHalfPi, PxVec3(0, 0, 1));
+		for (int i = 0; i < enemyCount; i++) {
+			PxVec3 position(float(i % columns) * 6.0f - columns * 3.0f, 3.0f, float(i / columns) * 6.0f - columns * 3.0f);
+			PxRigidDynamic* enemy = PxCreateDynamic(physics, PxTransform(position, upright), PxCapsuleGeometry(1.0f, 1.0f), *material, 10.0f);
+			enemy->setRigidDynamicLockFlags(PxRigidDynamicLockFlag::eLOCK_ANGULAR_X | PxRigidDynamicLockFlag::eLOCK_ANGULAR_Z);
+			scene->addActor(*enemy);
+			enemies.push_back(enemy);
+		}
+
+		double ms = 0.0;
+		for (int step = 0; step < warmupSteps + measuredSteps; step++) {
+			for (PxRigidDynamic* enemy : enemies) {
+				PxVec3 position = enemy->getGlobalPose().p;
+				PxVec3 direction(-position.x, 0.0f, -position.z);
+				float distance = direction.magnitude();
+				PxVec3 velocity = distance > 1.0f ? direction * (20.0f / distance) : PxVec3(0.0f);
+				enemy->setLinearVelocity(PxVec3(velocity.x, enemy->getLinearVelocity().y, velocity.z));
+			}
+			auto start = std::chrono::high_resolution_clock::now();
+			scene->simulate(1.0f / 60.0f);
+			scene->fetchResults(true);
+			if (step >= warmupSteps) {
+				ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			}
+		}
+
+		scene->release();
+		material->release();
+		return ms / measuredSteps;
+	}
+
+}
+
+PhysXDispatcher::PhysXDispatcher(ThreadPool& pool, unsigned int workerCount)
+	: pool(pool), workerCount(workerCount > 0 ? workerCount : pool.getThreadCount()) {
+}
+
+void PhysXDispatcher::submitTask(physx::PxBaseTask& task) {
+	// the task belongs to PhysX, release() hands it back once it has run
+	physx::PxBaseTask* pxTask = &task;
+	pool.post([pxTask] {
+		pxTask->run();
+		pxTask->release();
+	});
+}
+
+uint32_t PhysXDispatcher::getWorkerCount() const {
+	return workerCount;
+}
+
+void PhysXDispatcher::benchmark(physx::PxPhysics& physics, unsigned int maxThreads) {
+	if (maxThreads == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		maxThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+	int enemyCounts[] = { 9, 50, 100, 200, 400, 800 };
+
+	std::cout << "PhysX dispatcher benchmark, ms per step" << std::endl;
+	std::cout << std::setw(8) << "enemies" << std::setw(12) << "default 1";
+	for (unsigned int threads : threadCounts) {
+		std::cout << std::setw(9) << "pool " << std::setw(3) << threads;
+	}
+	std::cout << std::endl << std::fixed << std::setprecision(2);
+
+	physx::PxDefaultCpuDispatcher* defaultDispatcher = physx::PxDefaultCpuDispatcherCreate(1);
+	for (int enemyCount : enemyCounts) {
+		std::cout << std::setw(8) << enemyCount << std::setw(12) << stepScene(physics, defaultDispatcher, enemyCount);
+		for (unsigned int threads : threadCounts) {
+			ThreadPool pool(threads);
+			PhysXDispatcher dispatcher(pool);
+			std::cout << std::setw(12) << stepScene(physics, &dispatcher, enemyCount);
+		}
+		std::cout << std::endl;
+	}
+	defaultDispatcher->release();
+	std::cout.unsetf(std::ios::floatfield);
+}
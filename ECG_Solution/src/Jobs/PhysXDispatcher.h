@@ -0,0 +1,31 @@
+#pragma once
+#include <task/PxCpuDispatcher.h>
+#include <task/PxTask.h>
+#include <PxPhysics.h>
+#include "ThreadPool.h"
+
+/*!
+ * Runs the tasks of the PhysX simulation on the engine's thread pool, so physics and loading share the same
+ * workers instead of each bringing their own threads
+ */
+class PhysXDispatcher : public physx::PxCpuDispatcher {
+private:
+	ThreadPool& pool;
+	unsigned int workerCount;
+
+public:
+	/*!
+	 * @param workerCount: how many tasks PhysX splits its work into, 0 uses the number of workers of the pool
+	 */
+	PhysXDispatcher(ThreadPool& pool, unsigned int workerCount = 0);
+
+	void submitTask(physx::PxBaseTask& task) override;
+	uint32_t getWorkerCount() const override;
+
+	/*!
+	 * Steps a scene with a growing number of enemy sized capsules chasing the center, once with the default
+	 * single threaded dispatcher and once with a pool of every tested size, and prints the ms per step
+	 * @param maxThreads: largest pool that is tested, 0 uses one less than the hardware threads
+	 */
+	static void benchmark(physx::PxPhysics& physics, unsigned int maxThreads);
+};
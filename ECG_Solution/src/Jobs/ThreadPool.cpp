@@ -0,0 +1,193 @@
+#include "ThreadPool.h"
+
+namespace {
+	// lets post() find the queue of the worker it is called on
+	thread_local const ThreadPool* currentPool = nullptr;
+	thread_local unsigned int currentWorker = 0;
+}
+
+void ThreadPool::Queue::push(std::function<void()>&& job) {
+	if (count == jobs.size()) {
+		// unroll the ring into a larger one
+		std::vector<std::function<void()>> larger(jobs.size() < 16 ? 32 : jobs.size() * 2);
+		for (size_t i = 0; i < count; i++) {
+			larger[i] = std::move(jobs[(first + i) % jobs.size()]);
+		}
+		jobs.swap(larger);
+		first = 0;
+	}
+	jobs[(first + count) % jobs.size()] = std::move(job);
+	count++;
+}
+
+void ThreadPool::Queue::popNewest(std::function<void()>& job) {
+	count--;
+	job = std::move(jobs[(first + count) % jobs.size()]);
+	jobs[(first + count) % jobs.size()] = nullptr;
+}
+
+void ThreadPool::Queue::popOldest(std::function<void()>& job) {
+	job = std::move(jobs[first]);
+	jobs[first] = nullptr;
+	first = (first + 1) % jobs.size();
+	count--;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+	: nextQueue(0), queuedJobs(0) {
+	if (threadCount == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+	queues.reset(new Queue[threadCount]);
+	// enough for a call from every worker and the main thread at once, more are made when nested calls need them
+	for (unsigned int i = 0; i <= threadCount; i++) {
+		parallelForStates.emplace_back(new ParallelFor());
+		freeParallelFors.push_back(parallelForStates.back().get());
+	}
+	for (unsigned int i = 0; i < threadCount; i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+bool ThreadPool::takeJob(unsigned int index, std::function<void()>& job) {
+	// newest own job first, it is likely still in the cache
+	{
+		Queue& own = queues[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (own.count > 0) {
+			own.popNewest(job);
+			queuedJobs--;
+			return true;
+		}
+	}
+	// oldest job of another worker, that one is the furthest from being run by its owner
+	unsigned int count = static_cast<unsigned int>(workers.size());
+	for (unsigned int i = 1; i < count; i++) {
+		Queue& victim = queues[(index + i) % count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (victim.count > 0) {
+			victim.popOldest(job);
+			queuedJobs--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+	currentPool = this;
+	currentWorker = index;
+	while (true) {
+		std::function<void()> job;
+		if (takeJob(index, job)) {
+			job();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeUp.wait(lock, [this] { return stopping || queuedJobs > 0; });
+		if (stopping && queuedJobs == 0) {
+			return;
+		}
+	}
+}
+
+void ThreadPool::post(std::function<void()> job) {
+	unsigned int index = currentPool == this ? currentWorker : nextQueue++ % static_cast<unsigned int>(workers.size());
+	{
+		std::lock_guard<std::mutex> lock(queues[index].mutex);
+		queues[index].push(std::move(job));
+	}
+	{
+		// counted under the sleep lock, so a worker that is about to sleep sees the job
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		queuedJobs++;
+	}
+	wakeUp.notify_one();
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> job) {
+	auto task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+	std::future<void> result = task->get_future();
+	post([task] { (*task)(); });
+	return result;
+}
+
+ThreadPool::ParallelFor* ThreadPool::acquireParallelFor() {
+	std::lock_guard<std::mutex> lock(parallelForMutex);
+	if (freeParallelFors.empty()) {
+		parallelForStates.emplace_back(new ParallelFor());
+		freeParallelFors.reserve(parallelForStates.size());
+		return parallelForStates.back().get();
+	}
+	ParallelFor* state = freeParallelFors.back();
+	freeParallelFors.pop_back();
+	return state;
+}
+
+void ThreadPool::leaveParallelFor(ParallelFor* state) {
+	// helper jobs may only start after the call has returned, the last one to leave hands the state back
+	if (--state->users == 0) {
+		std::lock_guard<std::mutex> lock(parallelForMutex);
+		freeParallelFors.push_back(state);
+	}
+}
+
+void ThreadPool::runParallelFor(ParallelFor* state) {
+	// every participant pulls the next index until all are taken,
+	// the function is only touched while indices are left, so the caller is still waiting
+	int count = state->count;
+	for (int i = state->next++; i < count; i = state->next++) {
+		state->call(state->function, i);
+		if (++state->done == count) {
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->finished.notify_all();
+		}
+	}
+}
+
+void ThreadPool::parallelFor(int count, IndexFunction call, const void* function) {
+	if (count <= 0) {
+		return;
+	}
+
+	int helpers = int(workers.size()) < count - 1 ? int(workers.size()) : count - 1;
+	ParallelFor* state = acquireParallelFor();
+	state->next = 0;
+	state->done = 0;
+	state->users = helpers + 1;
+	state->count = count;
+	state->call = call;
+	state->function = function;
+
+	for (int i = 0; i < helpers; i++) {
+		// small enough for std::function to keep it without allocating
+		post([this, state] {
+			runParallelFor(state);
+			leaveParallelFor(state);
+		});
+	}
+
+	// the caller works as well, so nested calls from a worker can not deadlock
+	runParallelFor(state);
+	{
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->finished.wait(lock, [state, count] { return state->done == count; });
+	}
+	leaveParallelFor(state);
+}
+
+unsigned int ThreadPool::getThreadCount() const {
+	return static_cast<unsigned int>(workers.size());
+}
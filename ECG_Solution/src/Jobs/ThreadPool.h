@@ -0,0 +1,93 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+
+/*!
+ * Fixed set of worker threads that execute queued jobs.
+ * Every worker has its own queue: jobs queued by a worker go to its own queue and are taken newest first,
+ * jobs from other threads are spread over the queues. A worker without jobs steals the oldest job of another
+ * queue, so nested work (parallelFor in a job, PhysX tasks spawning tasks) stays on the cores that are free.
+ */
+class ThreadPool {
+private:
+	// ring buffer of jobs, it only grows, so queueing jobs in the game loop does not allocate
+	struct Queue {
+		std::mutex mutex;
+		std::vector<std::function<void()>> jobs;
+		size_t first = 0;
+		size_t count = 0;
+
+		void push(std::function<void()>&& job);
+		void popNewest(std::function<void()>& job);
+		void popOldest(std::function<void()>& job);
+	};
+
+	typedef void(*IndexFunction)(const void* function, int index);
+
+	// state of one parallelFor call, shared with its helper jobs and reused afterwards
+	struct ParallelFor {
+		std::atomic<int> next;
+		std::atomic<int> done;
+		std::atomic<int> users;		// the caller and the helpers that have not run yet
+		int count;
+		IndexFunction call;
+		const void* function;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	std::vector<std::thread> workers;
+	std::unique_ptr<Queue[]> queues;
+	std::atomic<unsigned int> nextQueue;	// round robin for jobs from threads outside the pool
+	std::atomic<int> queuedJobs;
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+	bool stopping = false;
+	std::mutex parallelForMutex;
+	std::vector<std::unique_ptr<ParallelFor>> parallelForStates;
+	std::vector<ParallelFor*> freeParallelFors;
+
+	void workerLoop(unsigned int index);
+	bool takeJob(unsigned int index, std::function<void()>& job);
+	ParallelFor* acquireParallelFor();
+	void leaveParallelFor(ParallelFor* state);
+	void runParallelFor(ParallelFor* state);
+	void parallelFor(int count, IndexFunction call, const void* function);
+
+public:
+	/*!
+	 * Starts the worker threads
+	 * @param threadCount: number of workers, 0 uses one less than the hardware threads
+	 */
+	ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	/*!
+	 * Queues a job
+	 * @return future that becomes ready once the job has run
+	 */
+	std::future<void> submit(std::function<void()> job);
+
+	/*!
+	 * Queues a job nobody waits for, cheaper than submit for many small jobs
+	 */
+	void post(std::function<void()> job);
+
+	/*!
+	 * Calls function(i) for every i in [0, count) on the workers and the calling thread,
+	 * returns once all calls are done. The function is not copied and the call state is reused, so a parallelFor
+	 * in the game loop does not allocate.
+	 */
+	template<typename Function>
+	void parallelFor(int count, const Function& function) {
+		parallelFor(count, [](const void* target, int i) { (*static_cast<const Function*>(target))(i); }, &function);
+	}
+
+	unsigned int getThreadCount() const;
+};
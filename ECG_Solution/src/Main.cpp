@@ -7,30 +7,50 @@
 
 #include "Utils.h"
 #include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
 #include "Camera.h"
 #include "Shader.h"
 #include "Geometry.h"
 #include "Material.h"
+#include "MaterialTable.h"
+#include "ProgramCache.h"
+#include "FileSystem/FileSystem.h"
 #include "Light.h"
 #include "Texture.h"
 #include "Mesh.h"
 #include "Terrain/TerrainShader.h"
 #include "Terrain/Terrain.h"
+#include "Terrain/HeightField.h"
+#include "Terrain/TiledScatter.h"
+#include "Crowd/FlowField.h"
+#include "Crowd/WaveSpawner.h"
+#include "Jobs/ThreadPool.h"
+#include "Jobs/JobGraph.h"
+#include "Jobs/PhysXDispatcher.h"
+#include "Compression/TextureConverter.h"
+#include "Streaming/AsyncTextureLoader.h"
+#include "Streaming/TextureStreamer.h"
 #include "Skybox/Skybox.h"
 #include "Shadowmap/ShadowMap.h"
 #include "GUI/GuiTexture.h"
 #include "GUI/GuiRenderer.h"
 #include "Flare/FlareManager.h"
 #include "PoissonDiskSampling.h"
+#include "FixedTimestep.h"
 
 #include <PxPhysicsAPI.h>
 #include <FreeImagePlus.h>
 #include "SimulationCallback.h"
+#include "ActorHandle.h"
+#include "SceneQueryBatch.h"
 #include "PlayerCamera.h"
 #include "Scene.h"
 #include "FrustumG.h"
 #include "TextRenderer.h"
 #include "ParticleRenderer.h";
+#include "GrassRenderer.h"
 #include "irrklang/irrKlang.h"
 
 using namespace physx;
@@ -49,12 +69,12 @@ bool move_character(GLFWwindow* window, Character* character, PlayerCamera* play
 void setPerFrameUniformsNormal(Shader* shader, PlayerCamera& camera, PointLight& pointL, ShadowMap& shadowMap);
 void setPerFrameUniforms(TerrainShader* shader, PlayerCamera& camera, PointLight& pointL, ShadowMap& shadowMap);
 int main(int argc, char** argv);
-float getYPosition(float x, float z);
 void renderQuad();
 void loadHighscores();
 void saveHighscore();
 void showHighscores(TextRenderer* hud, glm::vec3 color = glm::vec3(1.0f));
 void showHelp(TextRenderer* hud, glm::vec3 color = glm::vec3(1.0f)); 
+void showLoadingProgress(TextRenderer* hud, const std::string& title, const JobGraph& jobs);
 glm::vec3 getViewDirection(float yaw);
 
 
@@ -81,13 +101,13 @@ double lastypos = 0;
 int selectedFPS = 60;
 
 
-bool hitDetection = false;
-int enemyDetection = -1;
+// per enemy of the pool
+std::vector<bool> enemiesTouching;
+std::vector<bool> enemiesHitByDash;
 
 bool dashInProgress = false;
 float dashDuration = 0.5f;
 float dashCoolDown = 0.0f; 
-bool enemiesHitByDash[9] = { false };
 int dashOrder[] = { 3, 3, 3, 3 };
 
 bool attackInProgress = false;
@@ -98,9 +118,8 @@ bool rendering = false;
 
 bool disableTextures = false;
 float brightness = 1.0;
-int imgWidth, imgHeight, nrChannels;
-unsigned char* data;
 float playerSpeed = 30.f;
+float cameraDistance = 6.0f;
 
 int terrainPlaneSize = 1024;
 int terrainHeight = 250;
@@ -110,6 +129,7 @@ long long highscore = 0;
 std::string highscoresN[5];
 long long highscores[5];
 bool isSaved = false;
+bool restartRequested = false;
 irrklang::ISoundEngine* soundEngine = irrklang::createIrrKlangDevice();
 
 
@@ -122,6 +142,7 @@ int main(int argc, char** argv)
 	/* --------------------------------------------- */
 	// Load settings.ini
 	/* --------------------------------------------- */
+	auto startupStart = std::chrono::steady_clock::now();
 	INIReader reader("assets/settings.ini");
 
 	window_width = reader.GetInteger("window", "width", 1600);
@@ -135,6 +156,59 @@ int main(int argc, char** argv)
 	brightness = float(reader.GetReal("window", "brightness", 1.0));
 	selectedFPS = reader.GetInteger("window", "fps", 60);
 	playerName = reader.Get("player", "name", "Unknown");
+	unsigned int terrainSeed = reader.GetInteger("terrain", "seed", 1);
+	bool benchmarkPoisson = reader.GetBoolean("debug", "benchmark_poisson", false);
+	bool benchmarkPhysics = reader.GetBoolean("debug", "benchmark_physics", false);
+	bool benchmarkCrowd = reader.GetBoolean("debug", "benchmark_crowd", false);
+	bool benchmarkQueries = reader.GetBoolean("debug", "benchmark_queries", false);
+	unsigned int workerThreads = reader.GetInteger("jobs", "threads", 0);
+	unsigned int physicsWorkers = reader.GetInteger("jobs", "physics_workers", 0);
+	float grassQuality = float(reader.GetReal("graphics", "grass_quality", 1.0f));
+	int uploadRingMB = reader.GetInteger("textures", "upload_ring_mb", 32);
+	int uploadMBPerFrame = reader.GetInteger("textures", "upload_mb_per_frame", 8);
+	int streamingBudgetMB = reader.GetInteger("textures", "streaming_budget_mb", 256);
+	std::string shaderCacheDirectory = reader.Get("shaders", "cache_directory", "assets/shader/cache/");
+	std::string assetArchive = reader.Get("assets", "archive", "assets.pak");
+	bool progressiveLoading = reader.GetBoolean("loading", "progressive", true);
+	float simulationRate = float(reader.GetReal("simulation", "rate", 60.0));
+	int maxSimulationSteps = reader.GetInteger("simulation", "max_steps", 5);
+	std::string navigationCache = reader.Get("navigation", "cache", "assets/navigation.bin");
+	float navigationCellSize = float(reader.GetReal("navigation", "cell_size", 8.0));
+	float navigationMaxSlope = float(reader.GetReal("navigation", "max_slope", 35.0));
+	unsigned int enemyVoices = reader.GetInteger("audio", "enemy_voices", 4);
+	float hearingDistance = float(reader.GetReal("audio", "hearing_distance", 150.0));
+	float updateNear = float(reader.GetReal("enemies", "update_near", 100.0));
+	float updateMiddle = float(reader.GetReal("enemies", "update_middle", 250.0));
+	float updateFar = float(reader.GetReal("enemies", "update_far", 500.0));
+	unsigned int enemyPoolCapacity = reader.GetInteger("enemies", "pool_capacity", 256);
+	unsigned int firstWaveSize = reader.GetInteger("enemies", "first_wave", 9);
+	float waveGrowth = float(reader.GetReal("enemies", "wave_growth", 1.5));
+	float waveInterval = float(reader.GetReal("enemies", "wave_interval", 60.0));
+
+	// Offline conversion of all textures to block compressed DDS files, no window is opened
+	if (argc > 1 && std::string(argv[1]) == "--convert-textures") {
+		ThreadPool converterPool(workerThreads);
+		TextureConverter converter(converterPool);
+		converter.convertAssets(argc > 2 && std::string(argv[2]) == "--force");
+		return EXIT_SUCCESS;
+	}
+
+	// Offline packing of the assets into one archive, files the game writes or the player edits stay loose
+	if (argc > 1 && std::string(argv[1]) == "--pack-assets") {
+		ThreadPool packerPool(workerThreads);
+		bool packed = Archive::build("assets", assetArchive, { "assets/settings.ini", "assets/highscores", shaderCacheDirectory, navigationCache }, packerPool);
+		return packed ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	// Assets are read from the archive if there is one, loose files are the fallback
+	FileSystem fileSystem;
+	if (fileSystem.mount(assetArchive)) {
+		// irrKlang looks sounds up by name, so the play calls find the archived ones
+		for (const std::string& path : fileSystem.listArchived("assets/audio")) {
+			FileData sound = fileSystem.read(path);
+			soundEngine->addSoundSourceFromMemory(const_cast<char*>(sound.data()), irrklang::ik_s32(sound.size()), path.c_str());
+		}
+	}
 
 	//Load highscores
 	loadHighscores();
@@ -225,6 +299,9 @@ int main(int argc, char** argv)
 	glEnable(GL_CULL_FACE);
 
 
+	// Linked programs are kept on disk, warm starts skip compiling GLSL
+	ProgramCache programCache(shaderCacheDirectory);
+
 	/* --------------------------------------------- */
 	// Init HUD / Text / SPLASHSCREEN
 	/* --------------------------------------------- */
@@ -240,6 +317,10 @@ int main(int argc, char** argv)
 	showHelp(hud, glm::vec3(0.0));
 	glfwSwapBuffers(window);
 
+	// Worker threads shared by loading and the PhysX simulation, so the two do not compete with extra threads
+	ThreadPool threadPool(workerThreads);
+	PhysXDispatcher physicsDispatcher(threadPool, physicsWorkers);
+
 	/* --------------------------------------------- */
 	// Init Physx
 	/* --------------------------------------------- */
@@ -264,11 +345,18 @@ int main(int argc, char** argv)
 		EXIT_WITH_ERROR("Failed to init cooking")
 	}
 
-	SimulationCallback* simulationCallback = new SimulationCallback(&hitDetection, &enemyDetection, &dashInProgress);
+	if (benchmarkPhysics) {
+		PhysXDispatcher::benchmark(*gPhysicsSDK, workerThreads);
+	}
+	if (benchmarkQueries) {
+		SceneQueryBatch::benchmark(*gPhysicsSDK);
+	}
+
+	SimulationCallback* simulationCallback = new SimulationCallback();
 	PxScene* gScene = nullptr;
 	PxSceneDesc sceneDesc(gPhysicsSDK->getTolerancesScale());
 	sceneDesc.gravity = PxVec3(0.0f, -9.8f, 0.0f);
-	sceneDesc.cpuDispatcher = PxDefaultCpuDispatcherCreate(1);
+	sceneDesc.cpuDispatcher = &physicsDispatcher;
 	sceneDesc.filterShader = PxDefaultSimulationFilterShader;
 	gScene = gPhysicsSDK->createScene(sceneDesc);
 	PxMaterial* mMaterial = gPhysicsSDK->createMaterial(0.5f, 0.5f, 0.5f);
@@ -284,9 +372,9 @@ int main(int argc, char** argv)
 	cDesc.slopeLimit = 0.2f;
 	cDesc.upDirection = PxVec3(0, 1, 0);
 	cDesc.material = mMaterial;
-	//cDesc.reportCallback = simulationCallback;
+	cDesc.reportCallback = simulationCallback;
 	PxController* pxChar = gManager->createController(cDesc);
-	pxChar->getActor()->setName("larry");
+	ActorHandle::set(pxChar->getActor(), ActorHandle::Kind::Player);
 
 
 
@@ -295,32 +383,260 @@ int main(int argc, char** argv)
 	/* --------------------------------------------- */
 	{
 
-		// Load shader(s)
-		std::shared_ptr<Shader> textureShader = std::make_shared<Shader>("texture.vert", "texture.frag");
-		std::shared_ptr<Shader> debugShader = std::make_shared<Shader>("debug.vert", "debug.frag");
-		std::shared_ptr<Shader> skyboxShader = std::make_shared<Shader>("skybox.vert", "skybox.frag");
-		std::shared_ptr<Shader> shadowMapDebugShader = std::make_shared<Shader>("shadowMapQuadDebug.vert", "shadowMapQuadDebug.frag");
-		std::shared_ptr<Shader> shadowMapDepthShader = std::make_shared<Shader>("shadowmap_depth.vert", "shadowmap_depth.frag");
-		std::shared_ptr<Shader> guiShader = std::make_shared<Shader>("gui.vert", "gui.frag");
-		std::shared_ptr<TerrainShader> tessellationShader = std::make_shared<TerrainShader>(
-			"assets/shader/terrain.vert",
-			"assets/shader/terrain.tessc",
-			"assets/shader/terrain.tesse",
-			"assets/shader/terrain.frag"
-			);
+		// Compressed archive entries are unpacked on all threads before the loaders ask for them
+		fileSystem.decompressAll(threadPool);
+
+		// Textures are decoded on the workers and uploaded a few per frame, a fallback texel is shown until then
+		AsyncTextureLoader textureLoader(threadPool, size_t(uploadRingMB) << 20, size_t(uploadMBPerFrame) << 20);
+
+		// Model textures with a DDS version keep only the mip levels resident that their size on screen needs
+		TextureStreamer textureStreamer(threadPool, size_t(streamingBudgetMB) << 20, size_t(uploadMBPerFrame) << 20);
+
+		// Material parameters and texture references of all materials live in one buffer
+		MaterialTable materialTable;
+
+		// Initialize light
+		PointLight pointL(glm::vec3(.5f), glm::vec3(-900, 1020, -1500), glm::vec3(0.08f, 0.03f, 0.01f));
+
+		// Initialize camera
+		PlayerCamera playerCamera(_fov, float(window_width) / float(window_height), nearZ, farZ);
+		std::shared_ptr<FrustumG> viewFrustum = std::make_shared<FrustumG>();
+		viewFrustum->setCamInternals(_fov, float(window_width) / float(window_height), nearZ, farZ);
+		glm::mat4 camModel = playerCamera.getModel();
+		viewFrustum->setCamDef(getWorldPosition(camModel), getLookVector(camModel), getUpVector(camModel));
+
+		/* --------------------------------------------- */
+		// Load assets
+		// Files are read, decoded, cooked and placed on the workers, the main jobs only compile
+		// shaders and upload what the workers prepared, the splash shows the progress meanwhile
+		/* --------------------------------------------- */
+
+		std::shared_ptr<Shader> textureShader, debugShader, skyboxShader, shadowMapDebugShader, shadowMapDepthShader, guiShader, grassShader;
+		std::shared_ptr<TerrainShader> tessellationShader, terrainShadowShader;
+		GLuint animateShader = 0, renderProgram = 0, computeShader = 0, grassComputeShader = 0;
+
+		std::unique_ptr<Image> heightMapImage, treeMaskImage;
+		std::unique_ptr<HeightField> heightFieldPtr;
+		std::unique_ptr<Terrain> terrain;
+		std::unique_ptr<Scene> levelPtr;
+		std::unique_ptr<Character> characterPtr;
+		std::unique_ptr<ParticleRenderer> particleRendererPtr;
+		std::unique_ptr<GrassRenderer> grassRendererPtr;
+		std::unique_ptr<FlowField> flowFieldPtr;
+
+		std::vector<ScatterInstance> trees;
+		PreparedScene levelModel, sunbedModel, characterModel;
+		std::shared_ptr<SceneImport> palmTreeImport;
+		std::vector<PreparedScene> treeModels;
+		std::vector<PreparedScene> enemyModels;
+		const physx::PxExtendedVec3 playerSpawn(370, 104, -223);
+
+		JobGraph loading(threadPool);
+
+		int heightMapJob = loading.add("Heightmap", JobGraph::Thread::Worker, [&] {
+			heightMapImage.reset(new Image(heightMapPath));
+		});
+		int treeMaskJob = loading.add("Tree mask", JobGraph::Thread::Worker, [&] {
+			treeMaskImage.reset(new Image(treeMaskPath));
+		});
+		int heightFieldJob = loading.add("Height field", JobGraph::Thread::Worker, [&] {
+			heightFieldPtr.reset(new HeightField(*heightMapImage, terrainPlaneSize, terrainHeight));
+		}, { heightMapJob });
+
+		// Tree positions
+		int scatterJob = loading.add("Tree positions", JobGraph::Thread::Worker, [&] {
+			if (benchmarkPoisson) {
+				PossionDiskSampling::benchmark(*treeMaskImage, *heightMapImage, terrainHeight);
+			}
+			ScatterLayer treeLayer;
+			treeLayer.minDist = 80;
+			treeLayer.maxDist = 120;
+			treeLayer.maxSlope = 40;
+			treeLayer.minScale = 5;
+			treeLayer.maxScale = 5;
+			TiledScatter treeScatter(*heightFieldPtr, *treeMaskImage, treeLayer, terrainSeed);
+			treeScatter.generate(threadPool);
+			trees.resize(treeScatter.getCount());
+			treeScatter.write(threadPool, trees.data());
+		}, { heightFieldJob, treeMaskJob });
+
+		// the enemies walk around the trees and the sunbed, the level meshes are left to their controllers
+		int navigationJob = loading.add("Navigation", JobGraph::Thread::Worker, [&] {
+			std::vector<glm::vec3> obstacles;
+			for (const ScatterInstance& tree : trees) {
+				obstacles.push_back(glm::vec3(tree.positionScale.x, tree.positionScale.z, 2.0f));
+			}
+			obstacles.push_back(glm::vec3(375.0f, -220.0f, 8.0f));
+			flowFieldPtr.reset(new FlowField(*heightFieldPtr, obstacles, navigationCellSize, navigationMaxSlope, navigationCache));
+		}, { heightFieldJob, scatterJob });
+
+		int levelImportJob = loading.add("Import level", JobGraph::Thread::Worker, [&] {
+			levelModel = Scene::prepare(Scene::importFile("assets/models/cook_map_detailed.obj", gCooking), 1, PxExtendedVec3(0, 0, 0));
+		});
+		int palmTreeImportJob = loading.add("Import palm tree", JobGraph::Thread::Worker, [&] {
+			palmTreeImport = Scene::importFile("assets/models/palmTree.obj", gCooking);
+		});
+		// every tree shares the import and the cooked collision mesh of the file
+		int treePrepareJob = loading.add("Place trees", JobGraph::Thread::Worker, [&] {
+			treeModels.resize(trees.size());
+			threadPool.parallelFor(int(trees.size()), [&](int i) {
+				glm::vec4 pos = trees[i].positionScale;
+				treeModels[i] = Scene::prepare(palmTreeImport, pos.w, PxExtendedVec3(pos.x, pos.y, pos.z));
+			});
+		}, { palmTreeImportJob, scatterJob });
+		int sunbedImportJob = loading.add("Import sunbed", JobGraph::Thread::Worker, [&] {
+			sunbedModel = Scene::prepare(Scene::importFile("assets/models/sunbed.obj", gCooking), 3, PxExtendedVec3(375, heightFieldPtr->getHeight(375, -220) - 5, -220));
+		}, { heightFieldJob });
+		// the whole enemy pool is made while loading, waves only spawn and despawn its agents
+		int enemyImportJob = loading.add("Import enemies", JobGraph::Thread::Worker, [&] {
+			HeightField& heightField = *heightFieldPtr;
+			std::shared_ptr<SceneImport> enemyImport = Scene::importFile("assets/models/enemy.obj", gCooking);
+			// free enemies wait hidden in the middle of the map, their controllers are switched off
+			float middle = terrainPlaneSize / 2.0f;
+			physx::PxExtendedVec3 waitingPosition(middle, heightField.getHeight(middle, -middle) + 15, -middle);
+			enemyModels.reserve(enemyPoolCapacity);
+			for (unsigned int i = 0; i < enemyPoolCapacity; i++) {
+				enemyModels.push_back(Scene::prepare(enemyImport, 10, waitingPosition));
+			}
+		}, { heightFieldJob });
+		int characterImportJob = loading.add("Import character", JobGraph::Thread::Worker, [&] {
+			characterModel = Scene::prepare(Scene::importFile("assets/models/larry_final_final.obj", gCooking), 1, PxExtendedVec3(0, 0, 0));
+		});
 
+		// Load shader(s)
+		int shaderJob = loading.add("Shaders", JobGraph::Thread::Main, [&] {
+			textureShader = std::make_shared<Shader>("texture.vert", "texture.frag");
+			debugShader = std::make_shared<Shader>("debug.vert", "debug.frag");
+			skyboxShader = std::make_shared<Shader>("skybox.vert", "skybox.frag");
+			shadowMapDebugShader = std::make_shared<Shader>("shadowMapQuadDebug.vert", "shadowMapQuadDebug.frag");
+			shadowMapDepthShader = std::make_shared<Shader>("shadowmap_depth.vert", "shadowmap_depth.frag");
+			guiShader = std::make_shared<Shader>("gui.vert", "gui.frag");
+			tessellationShader = std::make_shared<TerrainShader>(
+				"assets/shader/terrain.vert",
+				"assets/shader/terrain.tessc",
+				"assets/shader/terrain.tesse",
+				"assets/shader/terrain.frag"
+				);
+			terrainShadowShader = std::make_shared<TerrainShader>(
+				"assets/shader/terrain.vert",
+				"assets/shader/terrain_shadow.tessc",
+				"assets/shader/terrain_shadow.tesse",
+				"assets/shader/shadowmap_depth.frag"
+				);
+			animateShader = getComputeShader("assets/shader/animator.comp");
+			renderProgram = getParticleShader("assets/shader/particle.vert", "assets/shader/particle.geom", "assets/shader/particle.frag");
+			computeShader = getComputeShader("assets/shader/particle.comp");
+			grassShader = std::make_shared<Shader>("grass.vert", "grass.frag");
+			grassComputeShader = getComputeShader("assets/shader/grass.comp");
+		});
 
 		// Create Terrain
 		// heightmap muss ein vielfaches von 20 (oder 2^n?) sein, ansonsten wirds nicht korrekt abgebildet
-		Terrain plane = Terrain(terrainPlaneSize, 50, terrainHeight, heightMapPath, false);
-		Terrain planeShadow = Terrain(terrainPlaneSize, 50, terrainHeight, heightMapPath, true);
+		int terrainJob = loading.add("Terrain", JobGraph::Thread::Main, [&] {
+			terrain.reset(new Terrain(terrainPlaneSize, 50, terrainHeight, *heightMapImage));
+		}, { heightMapJob });
+
+		int levelJob = loading.add("Level", JobGraph::Thread::Main, [&] {
+			levelPtr.reset(new Scene(textureShader, levelModel, gPhysicsSDK, gCooking, gScene, mMaterial, gManager, viewFrustum, &highscore, soundEngine));
+			levelModel = PreparedScene();
+		}, { shaderJob, levelImportJob });
+
+		// Load trees
+		int treeJob = loading.add("Trees", JobGraph::Thread::Main, [&] {
+			for (PreparedScene& tree : treeModels) {
+				levelPtr->addPrepared(tree);
+			}
+			treeModels.clear();
+		}, { levelJob, treePrepareJob });
+
+		// Load sunbed
+		int sunbedJob = loading.add("Sunbed", JobGraph::Thread::Main, [&] {
+			levelPtr->addPrepared(sunbedModel);
+			sunbedModel = PreparedScene();
+		}, { treeJob, sunbedImportJob });
+
+		//Add enemys, in this order they get the crowd agents of the pool
+		int enemyJob = loading.add("Enemies", JobGraph::Thread::Main, [&] {
+			for (PreparedScene& enemy : enemyModels) {
+				levelPtr->addPrepared(enemy, simulationCallback);
+			}
+			enemyModels.clear();
+		}, { sunbedJob, enemyImportJob });
+
+		// all meshes of the level are drawn with one multi-draw call
+		loading.add("Draw batch", JobGraph::Thread::Main, [&] {
+			levelPtr->buildBatch();
+		}, { enemyJob });
+
+		// Init character
+		int characterJob = loading.add("Character", JobGraph::Thread::Main, [&] {
+			characterPtr.reset(new Character(textureShader, characterModel, gPhysicsSDK, gCooking, gScene, mMaterial, pxChar, &playerCamera, gManager, animateShader, viewFrustum, soundEngine));
+			characterModel = PreparedScene();
+
+			// Adjust character to 3d person cam
+			for (int i = 0; i < characterPtr->nodes.size(); i++) {
+				characterPtr->nodes[i]->setTransformMatrix(glm::rotate(glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(1)), glm::vec3(0.0f, -2.0f, 0.0f)), glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+			}
+			characterPtr->init();
+
+			//Relocate the character & camera
+			characterPtr->relocate(playerSpawn);
+		}, { shaderJob, characterImportJob });
+
+		//particle renderer
+		int particleJob = loading.add("Particles", JobGraph::Thread::Main, [&] {
+			particleRendererPtr.reset(new ParticleRenderer(computeShader, renderProgram, playerCamera.getProjection()));
+			particleRendererPtr->init();
+		}, { shaderJob });
+
+		// Init grass
+		loading.add("Grass", JobGraph::Thread::Main, [&] {
+			grassRendererPtr.reset(new GrassRenderer(grassComputeShader, grassShader, treeMaskPath, grassQuality));
+			grassRendererPtr->init();
+		}, { shaderJob });
+
+		// redrawn at most 30 times per second, texture uploads go on in between
+		double lastSplash = 0.0;
+		auto showSplash = [&] {
+			textureLoader.update();
+			programCache.update();
+			if (glfwGetTime() - lastSplash < 1.0 / 30.0) {
+				return;
+			}
+			lastSplash = glfwGetTime();
+			showLoadingProgress(hud, window_title, loading);
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+		};
+		if (progressiveLoading) {
+			// play starts on the terrain, the level and the character, trees, sunbed, enemies and grass follow while playing
+			loading.runUntil({ heightFieldJob, terrainJob, levelJob, characterJob, particleJob }, showSplash);
+		}
+		else {
+			loading.run(showSplash);
+		}
+		if (loading.hasFailed()) {
+			EXIT_WITH_ERROR("Loading failed")
+		}
+		programCache.finish();
+		if (loading.isFinished()) {
+			loading.printReport();
+		}
+		std::cout << "Programs: " << programCache.getLoadedCount() << " from the cache, " << programCache.getCompiledCount() << " compiled" << std::endl;
+
+		Terrain& plane = *terrain;
+		HeightField& heightField = *heightFieldPtr;
+		Scene& level = *levelPtr;
+		level.crowd.setUpdateDistances(updateNear, updateMiddle, updateFar);
+		if (benchmarkCrowd) {
+			Crowd::benchmark(heightField, threadPool);
+		}
+		Character& character = *characterPtr;
+		ParticleRenderer& particleRenderer = *particleRendererPtr;
 
 		// Create Skybox
 		Skybox skybox = Skybox(skyboxShader.get());
 
-		// Initialize light
-		PointLight pointL(glm::vec3(.5f), glm::vec3(-900, 1020, -1500), glm::vec3(0.08f, 0.03f, 0.01f));
-
 		// Shadow Map
 		ShadowMap shadowMap = ShadowMap(shadowMapDepthShader.get(), pointL.position, nearZ, farZ, 400.0f, glm::vec3(terrainPlaneSize / 2, 0, -terrainPlaneSize / 2));
 
@@ -329,10 +645,7 @@ int main(int argc, char** argv)
 		std::shared_ptr<MeshMaterial> depth = std::make_shared<MeshMaterial>(shadowMapDepthShader, glm::vec3(0.5f, 0.7f, 0.3f), 8.0f);
 
 		Mesh frust = Mesh(glm::translate(glm::mat4(1), glm::vec3(0)), Mesh::createCubeMesh(1, 1, 1), debug);
-
-		// Tree positions
-		PossionDiskSampling treePositions = PossionDiskSampling(terrainPlaneSize, treeMaskPath, heightMapPath, terrainHeight, 80, 10);
-		std::vector<glm::vec3> points = treePositions.getPoints();
+		viewFrustum->setDebugMesh(frust);
 
 		// Flares
 		std::vector<GuiTexture> flares;
@@ -374,65 +687,6 @@ int main(int argc, char** argv)
 
 		FlareManager flareMangaer = FlareManager(guiShader.get(), 0.15f, flares, window_width);
 
-		// Initialize camera
-		PlayerCamera playerCamera(_fov, float(window_width) / float(window_height), nearZ, farZ);
-		std::shared_ptr<FrustumG> viewFrustum = std::make_shared<FrustumG>();
-		viewFrustum->setDebugMesh(frust);
-		viewFrustum->setCamInternals(_fov, float(window_width) / float(window_height), nearZ, farZ);
-		glm::mat4 camModel = playerCamera.getModel();
-		viewFrustum->setCamDef(getWorldPosition(camModel), getLookVector(camModel), getUpVector(camModel));
-
-		Scene level(textureShader, "assets/models/cook_map_detailed.obj", gPhysicsSDK, gCooking, gScene, mMaterial, gManager, viewFrustum, &highscore, soundEngine);
-
-		// Load heightmap
-		data = stbi_load(heightMapPath, &imgWidth, &imgHeight, &nrChannels, 4);
-
-		// Load trees
-		for (glm::vec3 pos : points)
-		{
-			pos.z -= terrainPlaneSize;
-			level.addStaticObject("assets/models/palmTree.obj", PxExtendedVec3(pos.x, pos.y, pos.z), 5);
-		}
-
-		// Load sunbed
-		level.addStaticObject("assets/models/sunbed.obj", PxExtendedVec3(375, getYPosition(375, -220) - 5, -220), 3);
-		
-		//Add enemys
-		// bot left, top left, top right, bot right
-		level.addEnemy(physx::PxExtendedVec3(100, getYPosition(100, -100) + 15, -100), 10, simulationCallback);
-		level.addEnemy(physx::PxExtendedVec3(900, getYPosition(900, -100) + 15, -100), 10, simulationCallback);
-		level.addEnemy(physx::PxExtendedVec3(900, getYPosition(900, -900) + 15, -900), 10, simulationCallback);
-		level.addEnemy(physx::PxExtendedVec3(100, getYPosition(100, -900) + 15, -900), 10, simulationCallback);
-
-		// half diagonal pos
-		level.addEnemy(physx::PxExtendedVec3(350, getYPosition(350, -350) + 15, -350), 10, simulationCallback);
-		level.addEnemy(physx::PxExtendedVec3(650, getYPosition(650, -350) + 15, -350), 10, simulationCallback);
-		level.addEnemy(physx::PxExtendedVec3(650, getYPosition(650, -650) + 15, -650), 10, simulationCallback);
-		level.addEnemy(physx::PxExtendedVec3(350, getYPosition(350, -650) + 15, -650), 10, simulationCallback);
-
-		// mid pos
-		level.addEnemy(physx::PxExtendedVec3(terrainPlaneSize / 2, getYPosition(terrainPlaneSize / 2, -terrainPlaneSize / 2) + 5, -terrainPlaneSize / 2), 10, simulationCallback);
-
-		// Init character
-		GLuint animateShader = getComputeShader("assets/shader/animator.comp");
-		
-		Character character(textureShader, "assets/models/larry_final_final.obj", gPhysicsSDK, gCooking, gScene, mMaterial, pxChar, &playerCamera, gManager, animateShader, viewFrustum, soundEngine);
-
-		// Adjust character to 3d person cam
-		for (int i = 0; i < character.nodes.size(); i++) {
-			character.nodes[i]->setTransformMatrix(glm::rotate(glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(1)), glm::vec3(0.0f, -2.0f, 0.0f)), glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
-		}
-		character.init();
-
-		//Relocate the character & camera
-		character.relocate(physx::PxExtendedVec3(370, 104, -223));
-
-		//particle renderer
-		GLuint renderProgram = getParticleShader("assets/shader/particle.vert", "assets/shader/particle.geom", "assets/shader/particle.frag");
-		GLuint computeShader = getComputeShader("assets/shader/particle.comp");
-		ParticleRenderer particleRenderer(computeShader, renderProgram, playerCamera.getProjection());
-		particleRenderer.init();
-
 
 		/* GAMEPLAY */
 		double xpos = 0;
@@ -447,11 +701,36 @@ int main(int argc, char** argv)
 		float fps_delta = 0.0f;
 		float fps_update = 4.0f; // 4 updates per second
 		int waitingMS = 0;
-		PxReal timeStep = 1.0f / 60.0f;
 		float timeStepFloat = 1.0f / 60.0f;
+		FixedTimestep simulationClock(simulationRate, maxSimulationSteps);
+		unsigned int simulationSteps = 0;
+		std::vector<HitEvent> hitEvents;
+		std::vector<unsigned int> enemiesFound;
+		std::vector<std::pair<unsigned int, int>> attackRays;	// enemy in the cone and the slot of its ray
+		// sized for the whole pool, so no step allocates however many enemies are in the game
+		hitEvents.reserve(enemyPoolCapacity);
+		enemiesFound.reserve(enemyPoolCapacity);
+		attackRays.reserve(enemyPoolCapacity);
+		enemiesTouching.assign(enemyPoolCapacity, false);
+		enemiesHitByDash.assign(enemyPoolCapacity, false);
+
+		// waves come from the corners, the half diagonals and the middle of the map
+		std::vector<glm::vec2> spawnPoints = {
+			glm::vec2(100, -100), glm::vec2(900, -100), glm::vec2(900, -900), glm::vec2(100, -900),
+			glm::vec2(350, -350), glm::vec2(650, -350), glm::vec2(650, -650), glm::vec2(350, -650),
+			glm::vec2(terrainPlaneSize / 2, -terrainPlaneSize / 2)
+		};
+		WaveSpawner waves(spawnPoints, firstWaveSize, waveGrowth, waveInterval);
+		// a ground probe and an attack ray for every enemy of the pool at most
+		SceneQueryBatch sceneQueries(gScene, glm::max(1024u, 2 * enemyPoolCapacity), 4);
+		PxSphereGeometry cameraSphere(0.5f);
+		float cameraBoomDistance = cameraDistance;
 		std::shared_ptr<Enemy> selectedEnemy = nullptr;
 		std::string info = "";
 		float infoTime = 0.0f;
+		// wave announcements are formatted into reserved space, the steps do not allocate
+		char infoText[64];
+		info.reserve(sizeof(infoText));
 		int fps = 0;
 		int fpsCnt = 0;
 		boolean drawFire = false;
@@ -462,13 +741,69 @@ int main(int argc, char** argv)
 		// Background Music
 		irrklang::ISound* bgm = soundEngine->play2D("assets/audio/Komiku_-_07_-_Last_Boss__Lets_see_what_we_got.mp3", true, false, true, irrklang::ESM_AUTO_DETECT, false);
 
+		// The last step is simulated on the workers while the frame is drawn, its results are fetched before the next
+		// step. Everything that writes to the physics scene outside of a step has to wait for it first.
+		bool simulationRunning = false;
+		auto finishSimulation = [&] {
+			if (simulationRunning) {
+				gScene->fetchResults(true);
+				simulationRunning = false;
+			}
+		};
+
+		// A new round only resets the gameplay state, meshes, textures, shaders and cooked physics stay loaded
+		float startBrightness = brightness;
+		auto restartRound = [&] {
+			auto start = std::chrono::steady_clock::now();
+			finishSimulation();
+			highscore = 0;
+			isSaved = false;
+			brightness = startBrightness;
+			attackInProgress = false;
+			attackDuration = 0.3f;
+			dashInProgress = false;
+			dashDuration = 0.5f;
+			dashCoolDown = 0.0f;
+			infoTime = 0.0f;
+			std::fill(enemiesTouching.begin(), enemiesTouching.end(), false);
+			std::fill(enemiesHitByDash.begin(), enemiesHitByDash.end(), false);
+			animationStep = 0;
+			animationStepBuffer = 0.0f;
+
+			character.reset(playerSpawn);
+			level.despawnEnemies();
+			waves.reset();
+			particleRenderer.reset();
+			simulationClock.reset();
+
+			bgm->drop();
+			bgm = soundEngine->play2D("assets/audio/Komiku_-_07_-_Last_Boss__Lets_see_what_we_got.mp3", true, false, true, irrklang::ESM_AUTO_DETECT, false);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "New round ready in " << ms << " ms" << std::endl;
+		};
+
+		// nothing has moved yet, so the first frame is drawn without interpolation
+		character.savePreviousState();
+
+		bool firstFrame = true;
 		while (!glfwWindowShouldClose(window)) {
+			// Assets that did not block the first frame arrive one main job per frame, a job adds its whole group at once
+			if (!loading.isFinished()) {
+				// the jobs add actors to the scene
+				finishSimulation();
+				if (loading.update()) {
+					double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupStart).count();
+					std::cout << "All assets loaded " << ms << " ms after start" << std::endl;
+					loading.printReport();
+				}
+			}
+
+			// Upload the textures that finished decoding since the last frame
+			textureLoader.update();
+
 			// Clear backbuffer
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-			gScene->simulate(timeStep);
-			gScene->fetchResults(true);
-
 			// Update camera
 			playerCamera.updateZoom(_fov);
 			
@@ -480,7 +815,6 @@ int main(int argc, char** argv)
 			lastypos = ypos;
 
 			playerCamera.rotate(-xRotate, -yRotate);
-			character.updateRotation(playerCamera.getYaw());
 			//keep cursor in screen
 			if (xpos < 100 || xpos > window_width - 100) {
 				lastxpos = window_width / 2;
@@ -492,82 +826,175 @@ int main(int argc, char** argv)
 				lastypos = window_height / 2;
 				glfwSetCursorPos(window, lastxpos, lastypos);
 			}
-			
 
-			// update character and camera position
-			is_moving = move_character(window, &character, &playerCamera, dt);
+			// Gameplay and physics run in steps of the same length, a fast frame may run none, a slow one several
+			int steps = simulationClock.advance(dt);
+			for (int step = 0; step < steps; step++) {
+				float stepTime = simulationClock.getStep();
+				// a dead player neither moves nor attacks until the round is restarted, the saved highscore stays final
+				bool alive = character.getHP() > 0;
+				if (!alive) {
+					attackInProgress = false;
+					dashInProgress = false;
+				}
+				character.savePreviousState();
+				level.savePreviousState();
+
+				finishSimulation();
+				simulationSteps++;
 
-			// update all enemy positions, deaths and player hits
-			for (size_t i = 0; i < level.enemies.size(); i++) {
+				// all scene queries of the step run in one batch, on the state at its start
+				sceneQueries.clear();
+				level.crowd.probeGround(sceneQueries);
 
-				level.enemies[i]->chase(character.getPosition(), dt);
+				// the attack hits every enemy in a cone of 45 degrees in front of the player, unless the level is in between
+				const SpatialHash& enemyGrid = level.crowd.getSpatialHash();
+				attackRays.clear();
 				if (attackInProgress && attackDuration == 0.3f) {
-					glm::vec3 enemyPos = level.enemies[i]->getPosition();
-					glm::vec3 dirToEnemy = glm::normalize( enemyPos - character.getPosition());
 					glm::vec3 viewDir = getViewDirection(playerCamera.getYaw());
-					float angle = M_PI - glm::acos(glm::dot(glm::vec3(viewDir.x, 0, viewDir.z), glm::vec3(dirToEnemy.x, 0, dirToEnemy.z)));
-					
-					if (glm::degrees(angle) <= 45 && glm::distance(character.getPosition(), enemyPos) <= 30) {
-						level.enemies[i]->hitWithDamage(20, dirToEnemy, dt, false);
-						level.enemies[i]->isDead(character.getPosition());
+					enemyGrid.queryCone(character.getPosition(), -viewDir, 45.0f, 30.0f, enemiesFound);
+					for (unsigned int enemy : enemiesFound) {
+						glm::vec3 toEnemy = level.enemies[enemy]->getPosition() - character.getPosition();
+						attackRays.push_back(std::make_pair(enemy, sceneQueries.addRaycast(character.getPosition(), toEnemy, glm::length(toEnemy))));
 					}
 				}
-			}
-			//attackInProgress = false; 
-
-			if (dashInProgress && enemyDetection >= 0) {
-				if (!enemiesHitByDash[enemyDetection]) {
-					glm::vec3 dirToEnemy = glm::normalize(level.enemies[enemyDetection]->getPosition() - character.getPosition());
-					level.enemies[enemyDetection]->hitWithDamage(100, dirToEnemy, dt, true);
-					level.enemies[enemyDetection]->isDead(character.getPosition());
-					
-					enemiesHitByDash[enemyDetection] = true;
+
+				// the camera boom collides with the level and the trees
+				glm::vec3 boomStart = -playerCamera.getPosition();
+				int cameraSweep = sceneQueries.addSweep(cameraSphere, boomStart, playerCamera.getBoomDirection(), cameraDistance);
+				sceneQueries.execute();
+				if (!sceneQueries.getSweepHit(cameraSweep, cameraBoomDistance)) {
+					cameraBoomDistance = cameraDistance;
 				}
-				enemyDetection = -1;
-			}
 
-			//attack
-			if (attackInProgress) {
-				attackDuration -= dt;
-				if (attackDuration < 0.0f) {
-					attackInProgress = false;
-					attackDuration = 0.3f;
-					animationStep = 0; //Sonst fhrt er eine falsche Animation aus dem Gang aus
+				// update character and camera position
+				is_moving = alive && move_character(window, &character, &playerCamera, stepTime);
+
+				// enemies only chase the player if the terrain does not block their sight, the flow field leads them around slopes and trees
+				const FlowField* flowField = nullptr;
+				if (loading.isDone(navigationJob)) {
+					flowField = flowFieldPtr.get();
+					flowFieldPtr->update(character.getPosition(), threadPool);
+				}
+				unsigned int wave = waves.getWave();
+				waves.update(level.crowd, character.getPosition(), stepTime, heightField);
+				if (waves.getWave() != wave) {
+					int length = std::snprintf(infoText, sizeof(infoText), "Wave %u: %u enemies", waves.getWave(),
+						glm::min(waves.getWaveSize(waves.getWave()), level.crowd.size()));
+					info.assign(infoText, glm::clamp(length, 0, int(sizeof(infoText)) - 1));
+					infoTime = 3.0f;
+				}
+				level.updateEnemies(character.getPosition(), stepTime, heightField, flowField, &sceneQueries, threadPool);
+
+				// only the nearest enemies are heard
+				level.updateAudibleEnemies(character.getPosition(), enemyVoices, hearingDistance);
+
+				float blockedAt;
+				for (const std::pair<unsigned int, int>& attackRay : attackRays) {
+					unsigned int enemy = attackRay.first;
+					if (!sceneQueries.getRaycastHit(attackRay.second, blockedAt)) {
+						glm::vec3 dirToEnemy = glm::normalize(level.enemies[enemy]->getPosition() - character.getPosition());
+						level.enemies[enemy]->hitWithDamage(20, dirToEnemy, stepTime, false);
+						if (level.enemies[enemy]->isDead()) {
+							enemiesTouching[enemy] = false;
+						}
+					}
+				}
+				//attackInProgress = false; 
+
+				// a dash damages every enemy it touches once
+				enemiesTouching.resize(level.enemies.size(), false);
+				enemiesHitByDash.resize(level.enemies.size(), false);
+				auto hitByDash = [&](unsigned int enemy) {
+					if (enemy >= level.enemies.size() || enemiesHitByDash[enemy] || !level.crowd.isActive(enemy)) {
+						return;
+					}
+					glm::vec3 dirToEnemy = glm::normalize(level.enemies[enemy]->getPosition() - character.getPosition());
+					level.enemies[enemy]->hitWithDamage(100, dirToEnemy, stepTime, true);
+					if (level.enemies[enemy]->isDead()) {
+						enemiesTouching[enemy] = false;
+					}
+					enemiesHitByDash[enemy] = true;
+				};
+				if (dashInProgress) {
+					// the sweep also finds enemies far from the player, whose controllers are switched off
+					enemyGrid.querySegment(character.getPreviousPosition(), character.getPosition(), 6.0f, enemiesFound);
+					for (unsigned int enemy : enemiesFound) {
+						hitByDash(enemy);
+					}
 				}
-			}
 
-			//dash attack
-			if (dashInProgress) {
-				dashCoolDown = 15.0f;
-				dashDuration -= dt;
-				if (dashDuration < 0.0f) {
-					dashInProgress = false;
-					enemiesHitByDash[0] = false;
-					enemiesHitByDash[1] = false;
-					enemiesHitByDash[2] = false;
-					enemiesHitByDash[3] = false;
-					enemiesHitByDash[4] = false;
-					enemiesHitByDash[5] = false;
-					enemiesHitByDash[6] = false;
-					enemiesHitByDash[7] = false;
-					enemiesHitByDash[8] = false;
-					dashDuration = 1.0f;
-
-					particleRenderer.reset(); //For smoke/dust "cloud" upon dash attack
+				// hits reported while the controllers moved
+				simulationCallback->takeEvents(hitEvents);
+				for (const HitEvent& hit : hitEvents) {
+					// enemies killed in this step touched the player before they despawned
+					if (!alive || hit.enemy >= level.enemies.size() || !level.crowd.isActive(hit.enemy)) {
+						continue;
+					}
+					if (!dashInProgress) {
+						enemiesTouching[hit.enemy] = true;
+					}
+					else {
+						hitByDash(hit.enemy);
+					}
 				}
-			}
-			else {
-				if (dashCoolDown > 0.0f) {
-					dashCoolDown -= dt;
+
+				//attack
+				if (attackInProgress) {
+					attackDuration -= stepTime;
+					if (attackDuration < 0.0f) {
+						attackInProgress = false;
+						attackDuration = 0.3f;
+						animationStep = 0; //Sonst fhrt er eine falsche Animation aus dem Gang aus
+					}
+				}
+
+				//dash attack
+				if (dashInProgress) {
+					dashCoolDown = 15.0f;
+					dashDuration -= stepTime;
+					if (dashDuration < 0.0f) {
+						dashInProgress = false;
+						std::fill(enemiesHitByDash.begin(), enemiesHitByDash.end(), false);
+						dashDuration = 1.0f;
+
+						particleRenderer.reset(); //For smoke/dust "cloud" upon dash attack
+					}
+				}
+				else {
+					if (dashCoolDown > 0.0f) {
+						dashCoolDown -= stepTime;
+					}
 				}
+
+				// every enemy that touched the player since the last hit deals its damage, one hit every 25 steps
+				if (simulationSteps % 25 == 0) {
+					for (size_t i = 0; i < enemiesTouching.size(); i++) {
+						if (enemiesTouching[i]) {
+							character.inflictDamage(level.enemies[i]->getDamage());
+							enemiesTouching[i] = false;
+						}
+					}
+				}
+
+				gScene->simulate(stepTime);
+				simulationRunning = true;
 			}
 
-			// hitDetection from physx callback -> locked on 60 fps
-			if (hitDetection && fpsCnt % 25 == 0 && enemyDetection >= 0) {
-				character.inflictDamage(level.enemies[enemyDetection]->getDamage());
-				hitDetection = false;
-				enemyDetection = -1;
+			// Draw everything between the last two steps, the view follows the mouse every frame
+			character.interpolate(simulationClock.getAlpha());
+			level.interpolate(simulationClock.getAlpha());
+			character.updateRotation(playerCamera.getYaw());
+
+			// pull the camera in front of dunes between character and camera, the level and trees were swept in the last step
+			glm::vec3 cameraPivot = -playerCamera.getPosition();
+			cameraPivot.y = glm::max(cameraPivot.y, heightField.getHeight(cameraPivot.x, cameraPivot.z) + 1.0f);
+			HeightFieldHit cameraHit;
+			float boomLength = cameraBoomDistance;
+			if (heightField.raycast(cameraPivot, playerCamera.getBoomDirection(), cameraDistance, cameraHit)) {
+				boomLength = glm::min(boomLength, cameraHit.distance - 0.5f);
 			}
+			playerCamera.setDistance(boomLength < cameraDistance ? glm::max(boomLength, 0.5f) : cameraDistance);
 
 			// Set per-frame uniforms
 			setPerFrameUniforms(tessellationShader.get(), playerCamera, pointL, shadowMap);
@@ -581,7 +1008,7 @@ int main(int argc, char** argv)
 				shadowMap.draw();
 				character.drawDepth(shadowMapDepthShader.get());
 				level.drawDepth(shadowMapDepthShader.get());
-				planeShadow.draw(shadowMapDepthShader.get());
+				plane.drawShadow(terrainShadowShader.get(), shadowMap);
 				shadowMap.unbindFBO();
 
 				// reset viewport
@@ -604,10 +1031,17 @@ int main(int argc, char** argv)
 
 			// 2. Render Scene
 			// --------------------------------------------------------------
+			textureStreamer.beginFrame(playerCamera.getActualPosition(), _fov, window_height);
+			materialTable.update();
 			// Skybox
 			skybox.draw(playerCamera, brightness);
 			// terrain
 			plane.draw(tessellationShader.get(), playerCamera, shadowMap, brightness);
+			// grass, loaded after the first frame
+			if (grassRendererPtr) {
+				grassRendererPtr->calculate(playerCamera.getViewProjectionMatrix(), playerCamera.getActualPosition(), plane.getHeightMapId(), terrainPlaneSize, terrainHeight);
+				grassRendererPtr->draw(playerCamera.getViewProjectionMatrix(), pointL.position, brightness, t);
+			}
 			// scene
 			level.draw();
 
@@ -641,13 +1075,20 @@ int main(int argc, char** argv)
 				hud->RenderText("Highscore: " + std::to_string(highscore), 
 					window_width - (170 + 16 * std::to_string(highscore).length()), 15.0f, 1.0f, glm::vec3(1, 0, 0));
 				showHighscores(hud, glm::vec3(1.0f, 0.0f, 0.0f));
-				brightness -= dt / 4;
-
-				if (brightness <= -1.0f) {
-					glfwSetWindowShouldClose(window, true);
+				hud->RenderText("Press R to play again",
+					window_width / 2 - 200, window_height / 2 + 20.0f, 1.0f, glm::vec3(1, 0, 0));
+				if (restartRequested) {
+					restartRequested = false;
+					restartRound();
+				}
+				else if (brightness > -1.0f) {
+					brightness -= dt / 4;
 				}
 			}
 			else {
+				// only a key pressed on the death screen starts a new round
+				restartRequested = false;
+
 				// draw HUD
 				hud->RenderText("HP: " + std::to_string(character.getHP()), 
 					15.0f, 15.0f, 1.0f, (character.getHP() < 25) ? glm::vec3(1, 0, 0) : glm::vec3(1));
@@ -655,6 +1096,10 @@ int main(int argc, char** argv)
 					15.0f, 55.0f, 1.0f, (dashCoolDown > 0.0) ? glm::vec3(1, 0, 0) : glm::vec3(1));
 				hud->RenderText("Highscore: " + std::to_string(highscore), 
 					window_width - (170 + 16 * std::to_string(highscore).length()), 15.0f, 1.0f);
+				if (infoTime > 0.0f) {
+					hud->RenderText(info, window_width / 2 - 8.0f * info.length(), 15.0f, 1.0f);
+					infoTime -= dt;
+				}
 
 				if (help) {
 					showHighscores(hud);
@@ -699,14 +1144,29 @@ int main(int argc, char** argv)
 			t_sum += dt;
 
 
+			// Stream the mip levels the drawn objects asked for
+			textureStreamer.update();
+			// Programs first built after loading (keyword variants) are finished here
+			programCache.update();
+
 			// Poll events
 			glfwPollEvents();
 			// Swap buffers
 			glfwSwapBuffers(window);
+
+			if (firstFrame) {
+				firstFrame = false;
+				double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupStart).count();
+				std::cout << "Time to first interactive frame: " << ms << " ms, " << loading.getFinishedCount() << " of "
+					<< loading.getJobCount() << " loading jobs done" << std::endl;
+			}
 		}
+		finishSimulation();
 
 		bgm->drop();
 	}
+	// the context is gone after destroyFramework, nothing may still be compiling then
+	programCache.finish();
 
 
 	/* --------------------------------------------- */
@@ -734,14 +1194,6 @@ int main(int argc, char** argv)
 	return EXIT_SUCCESS;
 }
 
-float getYPosition(float x, float z) {
-
-	glm::vec2 pixelPos = glm::vec2(floor(x / terrainPlaneSize * imgWidth), floor(-(z) / terrainPlaneSize * imgHeight));
-	unsigned char* value = data + 4 * int((pixelPos.y * imgWidth + pixelPos.x));
-	float redChannel = float(value[0]) / 255;
-	return redChannel * terrainHeight;
-}
-
 void loadHighscores() {
 	// Create a text string, which is used to output the text file
 	std::string line;
@@ -809,7 +1261,7 @@ void showHelp(TextRenderer* hud, glm::vec3 color) {
 	hud->RenderText("F5: Textures " + std::string((!disableTextures) ? "(ON)/OFF" : "ON/(OFF)"), width, 360.0f, 0.8f, color);
 	hud->RenderText("F8: View Frustum Culling " + std::string((checkVFC) ? "(ON)/OFF" : "ON/(OFF)"), width, 400.0f, 0.8f, color);
 	hud->RenderText("F9: Backface Culling " + std::string((checkBackCulling) ? "(ON)/OFF" : "ON/(OFF)"), width, 440.0f, 0.8f, color);
-	hud->RenderText("Esc: Exit Game", width, 480.0f, 0.8f, color);
+	hud->RenderText("Esc: Exit Game, R: Play again after dying", width, 480.0f, 0.8f, color);
 	hud->RenderText("---------------------------", width, 520.0f, 0.8f, color);
 	hud->RenderText("WASD: Move Player", width, 560.0f, 0.8f, color);
 	hud->RenderText("LMB: Standard Attack", width, 600.0f, 0.8f, color);
@@ -819,16 +1271,59 @@ void showHelp(TextRenderer* hud, glm::vec3 color) {
 		window_width / 2 - 350, window_height - 30.0f, 1.0f, color);
 }
 
+void showLoadingProgress(TextRenderer* hud, const std::string& title, const JobGraph& jobs)
+{
+	glm::vec3 black(0.0f);
+	glClearColor(1, 1, 1, 1);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	hud->RenderText(title, window_width / 2 - 225, window_height / 2 - 100.0f, 2.0f, glm::vec3(1, 0, 0));
+	showHighscores(hud, black);
+	showHelp(hud, black);
+
+	// progress bar, the text renderer counts y from the top and the scissor box from the bottom
+	int barWidth = 450;
+	int barHeight = 16;
+	int barX = window_width / 2 - 225;
+	int barY = window_height - (window_height / 2 - 40) - barHeight;
+	int finished = jobs.getFinishedCount();
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(barX, barY, barWidth, barHeight);
+	glClearColor(0.8f, 0.8f, 0.8f, 1);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glScissor(barX, barY, barWidth * finished / glm::max(jobs.getJobCount(), 1), barHeight);
+	glClearColor(1, 0, 0, 1);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDisable(GL_SCISSOR_TEST);
+	glClearColor(1, 1, 1, 1);
+
+	std::string running;
+	for (int i = 0; i < jobs.getJobCount(); i++) {
+		if (jobs.isRunning(i)) {
+			running += (running.empty() ? "" : ", ") + jobs.getName(i);
+		}
+	}
+	hud->RenderText(std::to_string(finished) + " / " + std::to_string(jobs.getJobCount()) + "  " + running,
+		window_width / 2 - 225, window_height / 2, 0.5f, black);
+
+	// the last stages that were done with their time
+	for (int i = glm::max(finished - 5, 0), line = 0; i < finished; i++, line++) {
+		int job = jobs.getFinishedJob(i);
+		hud->RenderText(jobs.getName(job) + ": " + std::to_string(int(jobs.getDuration(job) * 1000.0)) + " ms",
+			window_width / 2 - 225, window_height / 2 + 30.0f + 25.0f * line, 0.5f, glm::vec3(0.3f));
+	}
+}
+
 void setPerFrameUniformsNormal(Shader* shader, PlayerCamera& camera, PointLight& pointL, ShadowMap& shadowMap)
 {
+	// the variant is selected first, the uniforms below go to its program
+	shader->setKeyword("SHADOWS", checkShadows);
+	shader->setKeyword("TEXTURES", !disableTextures);
 	shader->use();
 	shader->setUniform("viewProjMatrix", camera.getViewProjectionMatrix());
 	shader->setUniform("camera_world", camera.getPosition());
 	shader->setUniform("pointL.color", pointL.color);
 	shader->setUniform("pointL.position", pointL.position);
 	shader->setUniform("pointL.attenuation", pointL.attenuation);
-	shader->setUniform("showShadows", checkShadows);
-	shader->setUniform("disableTextures", disableTextures);
 	shader->setUniform("brightness", brightness);
 	shader->setUniform("lightPosition", pointL.position);
 
@@ -843,10 +1338,10 @@ void setPerFrameUniformsNormal(Shader* shader, PlayerCamera& camera, PointLight&
 
 void setPerFrameUniforms(TerrainShader* shader, PlayerCamera& camera, PointLight& pointL, ShadowMap& shadowMap)
 {
+	shader->setKeyword("SHADOWS", checkShadows);
+	shader->setKeyword("TEXTURES", !disableTextures);
 	shader->use();
 	shader->setUniform("viewProjMatrix", camera.getViewProjectionMatrix());
-	shader->setUniform("showShadows", checkShadows);
-	shader->setUniform("disableTextures", disableTextures);
 	shader->setUniform("camera_world", camera.getPosition());
 	shader->setUniform("lightPosition", pointL.position);
 
@@ -984,6 +1479,9 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	case GLFW_KEY_F1:
 		help = !help;
 		break;
+	case GLFW_KEY_R:
+		restartRequested = true;
+		break;
 	case GLFW_KEY_F2:
 		checkFPSLimit = !checkFPSLimit;
 		break;
@@ -4,6 +4,8 @@
 * This file is part of the ECG Lab Framework and must not be redistributed.
 */
 #include "Material.h"
+#include "MaterialTable.h"
+#include <cassert>
 
 /* --------------------------------------------- */
 // Base material
@@ -14,10 +16,16 @@
 Material::Material(std::shared_ptr<Shader> shader, glm::vec3 materialCoefficients, float specularCoefficient)
 	: _shader(shader), _materialCoefficients(materialCoefficients), _alpha(specularCoefficient)
 {
+	// every material has a slot in the table, so the table has to exist before any material
+	assert(MaterialTable::getInstance() != nullptr);
+	_materialIndex = MaterialTable::getInstance()->addMaterial(this);
 }
 
 Material::~Material()
 {
+	if (MaterialTable::getInstance() != nullptr) {
+		MaterialTable::getInstance()->removeMaterial(_materialIndex);
+	}
 }
 
 Shader* Material::getShader()
@@ -25,10 +33,19 @@ Shader* Material::getShader()
 	return _shader.get();
 }
 
+int Material::getMaterialIndex() const
+{
+	return _materialIndex;
+}
+
+// the parameters themselves are in the material buffer, the shader samples the page of the material
 void Material::setUniforms()
 {
-	_shader->setUniform("materialCoefficients", _materialCoefficients);
-	_shader->setUniform("specularAlpha", _alpha);
+	_shader->setUniform("materialIndex", (unsigned int)_materialIndex);
+	MaterialTable* table = MaterialTable::getInstance();
+	if (table != nullptr && !table->isBindless()) {
+		_shader->setUniform("page", int(MaterialTable::FIRST_PAGE_UNIT) + table->getPage(_materialIndex));
+	}
 }
 
 /* --------------------------------------------- */
@@ -36,14 +53,17 @@ void Material::setUniforms()
 /* --------------------------------------------- */
 
 TextureMaterial::TextureMaterial(std::shared_ptr<Shader> shader, glm::vec3 materialCoefficients, float specularCoefficient, /*std::shared_ptr<Texture>*/ GLuint diffuseTexture)
-	: Material(shader, materialCoefficients, specularCoefficient), _diffuseTexture(diffuseTexture)
+	: Material(shader, materialCoefficients, specularCoefficient)
 {
+	_diffuseTexture = MaterialTable::getInstance()->addTexture(diffuseTexture);
+	MaterialTable::getInstance()->setMaterialTexture(_materialIndex, _diffuseTexture);
 }
 
 /* GAMEPLAY */
 TextureMaterial::TextureMaterial(std::shared_ptr<Shader> shader, glm::vec3 materialCoefficients, float specularCoefficient, const char* diffuseTexturePath)
 	: Material(shader, materialCoefficients, specularCoefficient) {
-	_diffuseTexture = loadTextureFromFile(diffuseTexturePath);
+	_diffuseTexture = MaterialTable::getInstance()->addTexture(diffuseTexturePath);
+	MaterialTable::getInstance()->setMaterialTexture(_materialIndex, _diffuseTexture);
 }
 /* GAMEPLAY END */
 
@@ -60,12 +80,9 @@ TextureMaterial::~TextureMaterial()
 //}
 
 /* GAMEPLAY */
-void TextureMaterial::setUniforms()
+void TextureMaterial::requestTextures(const glm::vec3& center, float radius)
 {
-	Material::setUniforms();
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, _diffuseTexture);
-	_shader->setUniform("diffuseTexture", 0);
+	MaterialTable::getInstance()->requestTexture(_diffuseTexture, center, radius);
 }
 
 /* GAMEPLAY END */
@@ -25,14 +25,23 @@ protected:
 
 	glm::vec3 _materialCoefficients; // x = ambient, y = diffuse, z = specular
 	float _alpha;
+	int _materialIndex;	// entry in the MaterialTable
 
 public:
 	Material(std::shared_ptr<Shader> shader, glm::vec3 materialCoefficients, float specularCoefficient);
 	virtual ~Material();
 
 	Shader* getShader();
+	int getMaterialIndex() const;
 	virtual void setUniforms();
 
+	/*!
+	 * Tells the texture streaming how large the object using this material is on screen
+	 * @param center: world space center of the bounding sphere of the object
+	 * @param radius: radius of the bounding sphere
+	 */
+	virtual void requestTextures(const glm::vec3& center, float radius) {}
+
 	/* GAMEPLAY */
 	GLuint _lightmapTexture;
 	bool hasLightmap = false;
@@ -45,6 +54,9 @@ public:
 	void setAlpha(float alpha) {
 		_alpha = alpha;
 	}
+	float getAlpha() {
+		return _alpha;
+	}
 	/* GAMEPLAY END */
 
 };
@@ -58,7 +70,7 @@ class TextureMaterial : public Material
 protected:
 	//std::shared_ptr<Texture> _diffuseTexture;
 	/* GAMEPLAY */
-	GLuint _diffuseTexture;
+	int _diffuseTexture;	// texture id in the MaterialTable
 	/* GAMEPLAY END */
 public:
 	/* GAMEPLAY */
@@ -68,7 +80,7 @@ public:
 	TextureMaterial(std::shared_ptr<Shader> shader, glm::vec3 materialCoefficients, float specularCoefficient, /*std::shared_ptr<Texture>*/ GLuint diffuseTexture);
 	virtual ~TextureMaterial();
 
-	virtual void setUniforms();
+	virtual void requestTextures(const glm::vec3& center, float radius);
 	
 };
 
@@ -0,0 +1,283 @@
+#include "MaterialTable.h"
+#include <iostream>
+#include "Material.h"
+#include "Utils.h"
+#include "Streaming/TextureStreamer.h"
+
+MaterialTable* MaterialTable::instance = nullptr;
+
+MaterialTable::MaterialTable(int layersPerPage)
+	: bindless(GLEW_ARB_bindless_texture != GL_FALSE && GLEW_NV_gpu_shader5 != GL_FALSE), layersPerPage(layersPerPage), bufferCapacity(0), whiteHandle(0) {
+	glGenBuffers(1, &buffer);
+
+	// materials without a texture (or with one that is still loading) sample this
+	const unsigned char white[4] = { 255, 255, 255, 255 };
+	if (bindless) {
+		glGenTextures(1, &whiteTexture);
+		glBindTexture(GL_TEXTURE_2D, whiteTexture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+		whiteHandle = glGetTextureHandleARB(whiteTexture);
+		glMakeTextureHandleResidentARB(whiteHandle);
+	}
+	else {
+		// page 0 holds the white texel
+		int page = addPage(GL_RGBA8, 1, 1, 1);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+		pages[page].used = 1;
+		whiteTexture = 0;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	instance = this;
+}
+
+MaterialTable::~MaterialTable() {
+	for (TableTexture& texture : textures) {
+		if (texture.handle != 0 && glIsTextureHandleResidentARB(texture.handle)) {
+			glMakeTextureHandleNonResidentARB(texture.handle);
+		}
+		if (texture.owned && texture.texture != 0) {
+			if (AsyncTextureLoader::getInstance() != nullptr) {
+				AsyncTextureLoader::getInstance()->release(texture.texture);
+			}
+			glDeleteTextures(1, &texture.texture);
+		}
+	}
+	if (whiteHandle != 0) {
+		glMakeTextureHandleNonResidentARB(whiteHandle);
+	}
+	glDeleteTextures(1, &whiteTexture);
+	for (Page& page : pages) {
+		glDeleteTextures(1, &page.texture);
+	}
+	glDeleteBuffers(1, &buffer);
+	if (instance == this) {
+		instance = nullptr;
+	}
+}
+
+MaterialTable* MaterialTable::getInstance() {
+	return instance;
+}
+
+bool MaterialTable::isBindless() const {
+	return bindless;
+}
+
+int MaterialTable::getPage(int material) const {
+	int id = materialTextures[material];
+	if (bindless || id < 0 || textures[id].page < 0) {
+		return 0;
+	}
+	return textures[id].page;
+}
+
+int MaterialTable::addTexture(const std::string& path) {
+	auto existing = texturePaths.find(path);
+	if (existing != texturePaths.end()) {
+		return existing->second;
+	}
+
+	TableTexture texture;
+	texture.path = path;
+	TextureStreamer* streamer = TextureStreamer::getInstance();
+	if (bindless && streamer != nullptr) {
+		texture.streamed = streamer->add(path, ImageOrigin::BottomUp);
+	}
+	if (texture.streamed < 0) {
+		texture.texture = loadTextureFromFile(path.c_str());
+		texture.owned = true;
+	}
+
+	int id = int(textures.size());
+	textures.push_back(texture);
+	texturePaths[path] = id;
+	return id;
+}
+
+int MaterialTable::addTexture(GLuint texture) {
+	TableTexture added;
+	added.texture = texture;
+	textures.push_back(added);
+	return int(textures.size()) - 1;
+}
+
+void MaterialTable::requestTexture(int texture, const glm::vec3& center, float radius) {
+	if (textures[texture].streamed >= 0) {
+		TextureStreamer::getInstance()->request(textures[texture].streamed, center, radius);
+	}
+}
+
+int MaterialTable::addMaterial(Material* material) {
+	if (!freeMaterials.empty()) {
+		int index = freeMaterials.back();
+		freeMaterials.pop_back();
+		materials[index] = material;
+		materialTextures[index] = -1;
+		return index;
+	}
+	materials.push_back(material);
+	materialTextures.push_back(-1);
+	return int(materials.size()) - 1;
+}
+
+void MaterialTable::removeMaterial(int index) {
+	materials[index] = nullptr;
+	freeMaterials.push_back(index);
+}
+
+void MaterialTable::setMaterialTexture(int index, int texture) {
+	materialTextures[index] = texture;
+}
+
+bool MaterialTable::isTextureReady(GLuint texture) const {
+	// textures the loader does not know are complete already
+	AsyncTextureLoader* loader = AsyncTextureLoader::getInstance();
+	int width, height;
+	return loader == nullptr || !loader->getSize(texture, width, height) || loader->isReady(texture);
+}
+
+void MaterialTable::resolveHandle(TableTexture& texture) {
+	GLuint name = texture.streamed >= 0 ? TextureStreamer::getInstance()->getTexture(texture.streamed) : texture.texture;
+	if (name == texture.handleTexture || !isTextureReady(name)) {
+		return;
+	}
+	// the handle of a replaced streamed texture went away with the texture
+	GLuint64 handle = glGetTextureHandleARB(name);
+	if (!glIsTextureHandleResidentARB(handle)) {
+		glMakeTextureHandleResidentARB(handle);
+	}
+	texture.handle = handle;
+	texture.handleTexture = name;
+}
+
+int MaterialTable::addPage(GLenum format, int width, int height, int levels) {
+	Page page;
+	page.format = format;
+	page.width = width;
+	page.height = height;
+	page.levels = levels;
+	page.used = 0;
+	glGenTextures(1, &page.texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, page.texture);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, format, width, height, layersPerPage);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	pages.push_back(page);
+	return int(pages.size()) - 1;
+}
+
+void MaterialTable::pack(TableTexture& texture) {
+	GLint format, width, height;
+	glBindTexture(GL_TEXTURE_2D, texture.texture);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+	int levels = 0;
+	for (GLint levelWidth = width; levelWidth > 0 && levels < 32;) {
+		levels++;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, levels, GL_TEXTURE_WIDTH, &levelWidth);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	// storage needs a sized format, unsized uploads may report the unsized one back
+	if (format == GL_RGBA) {
+		format = GL_RGBA8;
+	}
+	else if (format == GL_RGB) {
+		format = GL_RGB8;
+	}
+
+	int page = -1;
+	for (size_t i = 0; i < pages.size() && page < 0; i++) {
+		const Page& candidate = pages[i];
+		if (candidate.format == GLenum(format) && candidate.width == width && candidate.height == height && candidate.levels == levels && candidate.used < layersPerPage) {
+			page = int(i);
+		}
+	}
+	if (page < 0) {
+		if (int(pages.size()) == MAX_PAGES) {
+			std::cout << "No texture array page left for " << texture.path << std::endl;
+			texture.failed = true;
+			return;
+		}
+		page = addPage(GLenum(format), width, height, levels);
+	}
+
+	Page& target = pages[page];
+	texture.page = page;
+	texture.layer = target.used++;
+	for (int level = 0; level < levels; level++) {
+		glCopyImageSubData(texture.texture, GL_TEXTURE_2D, level, 0, 0, 0,
+			target.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, texture.layer,
+			glm::max(1, width >> level), glm::max(1, height >> level), 1);
+	}
+
+	// the layer is the only copy from now on
+	if (texture.owned) {
+		if (AsyncTextureLoader::getInstance() != nullptr) {
+			AsyncTextureLoader::getInstance()->release(texture.texture);
+		}
+		glDeleteTextures(1, &texture.texture);
+		texture.texture = 0;
+	}
+}
+
+void MaterialTable::update() {
+	TextureStreamer* streamer = TextureStreamer::getInstance();
+	for (TableTexture& texture : textures) {
+		if (bindless) {
+			resolveHandle(texture);
+		}
+		else if (texture.page < 0 && !texture.failed && isTextureReady(texture.texture)) {
+			pack(texture);
+		}
+	}
+
+	data.resize(materials.size());
+	for (size_t i = 0; i < materials.size(); i++) {
+		if (materials[i] == nullptr) {
+			continue;
+		}
+		MaterialData& entry = data[i];
+		entry.coefficients = glm::vec4(materials[i]->getCoefficients(), materials[i]->getAlpha());
+		entry.handle = whiteHandle;
+		entry.page = 0;
+		entry.layer = 0;
+		entry.minLod = 0.0f;
+
+		int id = materialTextures[i];
+		if (id >= 0) {
+			const TableTexture& texture = textures[id];
+			if (bindless && texture.handle != 0) {
+				entry.handle = texture.handle;
+				entry.minLod = texture.streamed >= 0 ? streamer->getMinLod(texture.streamed) : 0.0f;
+			}
+			else if (!bindless && texture.page >= 0) {
+				entry.page = texture.page;
+				entry.layer = texture.layer;
+			}
+		}
+	}
+
+	// the whole buffer is orphaned every frame, it only holds a few hundred entries
+	size_t size = glm::max(data.size(), size_t(1)) * sizeof(MaterialData);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	if (size > bufferCapacity) {
+		bufferCapacity = size;
+	}
+	glBufferData(GL_SHADER_STORAGE_BUFFER, bufferCapacity, nullptr, GL_STREAM_DRAW);
+	if (!data.empty()) {
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, data.size() * sizeof(MaterialData), data.data());
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BINDING, buffer);
+
+	if (!bindless) {
+		for (size_t i = 0; i < pages.size(); i++) {
+			glActiveTexture(GL_TEXTURE0 + FIRST_PAGE_UNIT + GLenum(i));
+			glBindTexture(GL_TEXTURE_2D_ARRAY, pages[i].texture);
+		}
+		glActiveTexture(GL_TEXTURE0);
+	}
+}
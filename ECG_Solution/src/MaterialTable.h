@@ -0,0 +1,134 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+class Material;
+
+/*!
+ * Keeps the parameters of all materials in one shader storage buffer, so a draw only needs the index of its material
+ * and draws with different textures can share a single multi-draw call.
+ *
+ * With GL_ARB_bindless_texture and GL_NV_gpu_shader5 every material stores the handle of its diffuse texture and textures are streamed by the
+ * TextureStreamer; a handle freezes the texture parameters, so the levels that are still fading in are clamped in the
+ * shader through minLod. Without it, textures are copied into GL_TEXTURE_2D_ARRAY pages of the same format and size
+ * and materials store page and layer; those textures are loaded completely, since a layer cannot drop levels.
+ * The pages are bound to units of their own and the shader samples one of them, so a draw has to bind the unit of
+ * its page and a multi-draw must not mix pages. texture.frag picks the matching path with #ifdef BINDLESS_MATERIALS.
+ * The table has to exist before the first material is created.
+ */
+class MaterialTable {
+private:
+	// std430 layout of one entry of the material buffer
+	struct MaterialData {
+		glm::vec4 coefficients;	// x = ambient, y = diffuse, z = specular, w = specular alpha
+		GLuint64 handle;		// bindless handle of the diffuse texture
+		GLint page;				// texture array page and layer without bindless textures
+		GLint layer;
+		float minLod;			// coarsest level that may be sampled
+		float padding[3];
+	};
+
+	struct TableTexture {
+		std::string path;
+		int streamed = -1;		// handle of the TextureStreamer, -1 if the texture is loaded completely
+		GLuint texture = 0;
+		bool owned = false;		// deleted by the table
+		GLuint handleTexture = 0;	// GL name the handle belongs to, streamed textures change their name
+		GLuint64 handle = 0;
+		int page = -1;
+		int layer = 0;
+		bool failed = false;	// no page left, the material stays white
+	};
+
+	struct Page {
+		GLenum format;
+		int width, height, levels;
+		GLuint texture;
+		int used;
+	};
+
+	static MaterialTable* instance;
+
+	bool bindless;
+	int layersPerPage;
+	GLuint buffer;
+	size_t bufferCapacity;
+	GLuint whiteTexture;
+	GLuint64 whiteHandle;
+
+	std::vector<Material*> materials;
+	std::vector<int> materialTextures;
+	std::vector<int> freeMaterials;
+	std::vector<TableTexture> textures;
+	std::unordered_map<std::string, int> texturePaths;
+	std::vector<Page> pages;
+	std::vector<MaterialData> data;
+
+	bool isTextureReady(GLuint texture) const;
+	void resolveHandle(TableTexture& texture);
+	void pack(TableTexture& texture);
+	int addPage(GLenum format, int width, int height, int levels);
+
+public:
+	static const GLuint MATERIAL_BINDING = 8;	// shader storage binding of the material buffer
+	static const GLuint FIRST_PAGE_UNIT = 8;	// texture unit of the first array page
+	static const int MAX_PAGES = 8;
+
+	/*!
+	 * @param layersPerPage: layers of one texture array page
+	 */
+	MaterialTable(int layersPerPage = 16);
+	~MaterialTable();
+
+	/*!
+	 * @return the table the materials register with, nullptr if there is none
+	 */
+	static MaterialTable* getInstance();
+
+	/*!
+	 * @return if textures are referenced by bindless handles instead of array pages
+	 */
+	bool isBindless() const;
+
+	/*!
+	 * @return page the material samples, 0 (white) while its texture is not packed and with bindless textures
+	 */
+	int getPage(int material) const;
+
+	/*!
+	 * Loads a texture once per path, rows are ordered like loadTextureFromFile
+	 * @return id of the texture in the table
+	 */
+	int addTexture(const std::string& path);
+
+	/*!
+	 * Adds a texture that was created elsewhere and stays owned by its creator
+	 * @return id of the texture in the table
+	 */
+	int addTexture(GLuint texture);
+
+	/*!
+	 * Reports the size on screen of an object with the texture to the texture streaming
+	 */
+	void requestTexture(int texture, const glm::vec3& center, float radius);
+
+	/*!
+	 * @return index of the material in the material buffer
+	 */
+	int addMaterial(Material* material);
+	void removeMaterial(int index);
+
+	/*!
+	 * @param texture: id of the diffuse texture, -1 for plain white
+	 */
+	void setMaterialTexture(int index, int texture);
+
+	/*!
+	 * Resolves handles or packs finished textures, uploads the parameters of all materials and binds the buffer
+	 * and the pages, called once per frame before the materials are drawn
+	 */
+	void update();
+};
@@ -1,4 +1,5 @@
 #include "Node.h"
+#include <cmath>
 
 
 
@@ -16,7 +17,7 @@ Node::~Node()
 void Node::draw(glm::mat4 matrix)
 {
 	if (_enabled) {
-		glm::mat4 accumModel = matrix * glm::translate(glm::mat4(1), _position) * glm::rotate(glm::mat4(1), glm::radians(_angle), glm::vec3(0, 1, 0)) * glm::translate(glm::mat4(1), _startingPosition) * _transformMatrix * _modelMatrix;
+		glm::mat4 accumModel = matrix * glm::translate(glm::mat4(1), _renderPosition) * glm::rotate(glm::mat4(1), glm::radians(_renderAngle), glm::vec3(0, 1, 0)) * glm::translate(glm::mat4(1), _startingPosition) * _transformMatrix * _modelMatrix;
 
 		for (size_t i = 0; i < _meshes.size(); i++) {
 			_meshes[i]->draw(accumModel);
@@ -32,7 +33,7 @@ void Node::draw(glm::mat4 matrix)
 void Node::drawDepth(Shader* shader, glm::mat4 matrix)
 {
 	if (_enabled) {
-		glm::mat4 accumModel = matrix * glm::translate(glm::mat4(1), _position) * glm::rotate(glm::mat4(1), glm::radians(_angle), glm::vec3(0, 1, 0)) * glm::translate(glm::mat4(1), _startingPosition) * _transformMatrix * _modelMatrix;
+		glm::mat4 accumModel = matrix * glm::translate(glm::mat4(1), _renderPosition) * glm::rotate(glm::mat4(1), glm::radians(_renderAngle), glm::vec3(0, 1, 0)) * glm::translate(glm::mat4(1), _startingPosition) * _transformMatrix * _modelMatrix;
 
 		for (size_t i = 0; i < _meshes.size(); i++) {
 			_meshes[i]->draw(shader, accumModel);
@@ -69,16 +70,26 @@ void Node::addMesh(std::shared_ptr<Geometry> mesh) {
 	_meshes.push_back(mesh);
 }
 
+void Node::setBatch(DrawBatch* batch) {
+	for (size_t i = 0; i < _meshes.size(); i++) {
+		_meshes[i]->setBatch(batch);
+	}
+	for (size_t i = 0; i < _children.size(); i++) {
+		_children[i]->setBatch(batch);
+	}
+}
+
 void Node::move(float forward, float strafeLeft) {
 	_position.z += forward;
 	_position.x += strafeLeft;
+	_renderPosition = _position;
 }
 
 void Node::setPosition(physx::PxExtendedVec3 pos) {
 	_position.x = pos.x;
 	_position.y = pos.y;
 	_position.z = pos.z;
-
+	_renderPosition = _position;
 }
 
 glm::vec3 Node::getPosition() {
@@ -87,6 +98,30 @@ glm::vec3 Node::getPosition() {
 
 void Node::yaw(float angle) {
 	_angle = angle;
+	_renderAngle = angle;
+}
+
+void Node::savePreviousState() {
+	_previousPosition = _position;
+	_previousAngle = _angle;
+	_hasPreviousState = true;
+}
+
+void Node::interpolate(float alpha) {
+	// nodes added after the last step are drawn where they are
+	if (!_hasPreviousState) {
+		return;
+	}
+	_renderPosition = glm::mix(_previousPosition, _position, alpha);
+	// turn the short way around
+	float turn = std::fmod(_angle - _previousAngle, 360.0f);
+	if (turn > 180.0f) {
+		turn -= 360.0f;
+	}
+	else if (turn < -180.0f) {
+		turn += 360.0f;
+	}
+	_renderAngle = _previousAngle + turn * alpha;
 }
 
 std::shared_ptr<Node> Node::getChildWithName(std::string name) {
@@ -22,6 +22,13 @@ protected:
 	glm::vec3 _position;
 	float _angle = 0.0f;
 
+	// state of the previous simulation step and the one that is drawn between the two
+	glm::vec3 _previousPosition;
+	float _previousAngle = 0.0f;
+	glm::vec3 _renderPosition;
+	float _renderAngle = 0.0f;
+	bool _hasPreviousState = false;
+
 	std::vector<std::shared_ptr<Node>> _children;
 
 public:
@@ -43,10 +50,22 @@ public:
 
 	void addChild(std::shared_ptr<Node> child);
 	void addMesh(std::shared_ptr<Geometry> mesh);
+	void setBatch(DrawBatch* batch);
 
 	void move(float forward, float strafeLeft);
 	void setPosition(physx::PxExtendedVec3 pos);
 	glm::vec3 getPosition();
 	void yaw(float angle);
+
+	/*!
+	 * Remembers position and angle before a simulation step, also used after a teleport so it is not interpolated
+	 */
+	void savePreviousState();
+
+	/*!
+	 * Draws the node between the previous and the current step
+	 * @param alpha: 0 draws the previous step, 1 the current one
+	 */
+	void interpolate(float alpha);
 	std::shared_ptr<Node> getChildWithName(std::string name);
 };
\ No newline at end of file
@@ -54,6 +54,17 @@ void PlayerCamera::setPosition(physx::PxExtendedVec3 pos) {
 
 }
 
+// distance between the character and the camera
+void PlayerCamera::setDistance(float distance) {
+	_zoom = -distance;
+	_viewMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, _zoom));
+}
+
+// world space direction from the character towards the camera
+glm::vec3 PlayerCamera::getBoomDirection() {
+	return glm::vec3(_rotationMatrix * glm::vec4(0.0f, 0.0f, 1.0f, 0.0f));
+}
+
 float PlayerCamera::getYaw() {
 	return _yaw;
 }
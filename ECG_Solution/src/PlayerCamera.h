@@ -40,5 +40,7 @@ public:
 	void rotate(float xRotate, float yRotate);
 	void move(float forward, float strafeLeft);
 	void setPosition(physx::PxExtendedVec3 pos);
+	void setDistance(float distance);
+	glm::vec3 getBoomDirection();
 	float getYaw();
 };
\ No newline at end of file
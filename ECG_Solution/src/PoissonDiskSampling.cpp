@@ -1,17 +1,18 @@
 #include "PoissonDiskSampling.h"
 #include <iostream>
-#include "stb_image.h"
+#include <iomanip>
+#include <chrono>
 
-PossionDiskSampling::PossionDiskSampling(int terrainSize, const char* maskPath, const char* heightMapPath, float scaleY, float minDist, int count)
+PossionDiskSampling::PossionDiskSampling(int terrainSize, const Image& mask, const Image& heightMap, float scaleY, float minDist, int count, unsigned int seed)
+	: random(seed), distribution(0.0f, 1.0f)
 {
 	this->width = terrainSize;
 	this->height = terrainSize;
 	this->minDist = minDist;
 	this->count = count;
-	srand(time(0));
 	generatePossionPoints();
-	applyMask(maskPath);
-	applyTerrainHeight(heightMapPath, scaleY);
+	applyMask(mask);
+	applyTerrainHeight(heightMap, scaleY);
 }
 
 PossionDiskSampling::~PossionDiskSampling() {}
@@ -20,87 +21,73 @@ std::vector<glm::vec3> PossionDiskSampling::getPoints() {
 	return points3D;
 }
 
-std::vector<glm::vec2> PossionDiskSampling::applyMask(const char* maskPath) {
-	int imgWidth, imgHeight, nrChannels;
-	unsigned char* data = stbi_load(maskPath, &imgWidth, &imgHeight, &nrChannels, 4);
-	for (auto p = points2D.begin(); p != points2D.end();) {
-		glm::vec2 pixelPos = glm::vec2(floor(p->x / this->width * imgWidth),floor(p->y / this->height * imgHeight));
-		unsigned char* value = data + 4 * int((pixelPos.y * imgWidth + pixelPos.x));
-		unsigned char r = value[0];
-		if (r == 0) {
-			p = points2D.erase(p);
-		}
-		else
-		{
-			++p;
+void PossionDiskSampling::applyMask(const Image& mask) {
+	// compact in place instead of erasing from the middle of the vector
+	size_t kept = 0;
+	for (size_t i = 0; i < points2D.size(); i++) {
+		glm::vec2 uv = glm::vec2(points2D[i].x / this->width, points2D[i].y / this->height);
+		if (mask.sample(uv) > 0.0f) {
+			points2D[kept++] = points2D[i];
 		}
 	}
-	return points2D;
+	points2D.resize(kept);
 }
 
-std::vector<glm::vec3>  PossionDiskSampling::applyTerrainHeight(const char* heightMapPath, float scaleY) {
-	int imgWidth, imgHeight, nrChannels;
-	unsigned char* data = stbi_load(heightMapPath, &imgWidth, &imgHeight, &nrChannels, 4);
-
-	for (auto p = points2D.begin(); p != points2D.end();) {
-		glm::vec2 pixelPos = glm::vec2(floor(p->x / this->width * imgWidth), floor(p->y / this->height * imgHeight));
-		unsigned char* value = data + 4 * int((pixelPos.y * imgWidth + pixelPos.x));
-		float redChannel = float(value[0]) / 255;
-		float height = redChannel * scaleY;
-		glm::vec3 pos3D = glm::vec3(p->x, height, p->y);
-		points3D.push_back(pos3D);
-		++p;
+void PossionDiskSampling::applyTerrainHeight(const Image& heightMap, float scaleY) {
+	points3D.clear();
+	points3D.reserve(points2D.size());
+	for (const glm::vec2& p : points2D) {
+		float height = heightMap.sample(glm::vec2(p.x / this->width, p.y / this->height)) * scaleY;
+		points3D.push_back(glm::vec3(p.x, height, p.y));
 	}
-	return points3D;
 }
 
-std::vector<glm::vec2> PossionDiskSampling::generatePossionPoints() {
-	float cellSize = minDist / M_SQRT2;
-	std::vector<std::vector<glm::vec2>> grid(width/cellSize, std::vector<glm::vec2>(height/cellSize, glm::vec2(-1)));
-	
-	std::vector<glm::vec2> processList;
-	std::vector<glm::vec2> spawnPoints;
-	//glm::vec2 firstPoint = glm::vec2(rand() % width, rand() % height);
-	glm::vec2 firstPoint = glm::vec2(512, 512);
-	spawnPoints.push_back(firstPoint);
-	processList.push_back(firstPoint);
-
-	glm::vec2 index = imageToGrid(firstPoint, cellSize);
-	grid[index.x][index.y] = firstPoint;
+void PossionDiskSampling::generatePossionPoints() {
+	// a cell is small enough to hold at most one point
+	cellSize = minDist / float(M_SQRT2);
+	gridWidth = int(glm::ceil(width / cellSize));
+	gridHeight = int(glm::ceil(height / cellSize));
+	grid.assign(gridWidth * gridHeight, -1);
+	points2D.clear();
+
+	std::vector<int> processList;
+	glm::vec2 firstPoint = glm::vec2(width / 2, height / 2);
+	points2D.push_back(firstPoint);
+	processList.push_back(0);
+	glm::ivec2 index = toGrid(firstPoint);
+	grid[index.y * gridWidth + index.x] = 0;
 
 	while (processList.size() > 0)
 	{
-		int randIndex = rand() % processList.size();
-		glm::vec2 point = processList[randIndex];
-		processList.erase(processList.begin() + randIndex);
+		// swap the picked point to the back, so removing it is O(1)
+		size_t randIndex = std::uniform_int_distribution<size_t>(0, processList.size() - 1)(random);
+		glm::vec2 point = points2D[processList[randIndex]];
+		processList[randIndex] = processList.back();
+		processList.pop_back();
+
 		for (int i = 0; i < count; i++)
 		{
 			glm::vec2 newPoint = generateRandomPointAround(point);
-			if (isValid(newPoint) && !inNeighbourhood(grid, newPoint, cellSize)) {
-				processList.push_back(newPoint);
-				spawnPoints.push_back(newPoint);
-				index = imageToGrid(newPoint, cellSize);
-				grid[index.x][index.y] = newPoint;
+			if (isValid(newPoint) && !inNeighbourhood(newPoint)) {
+				int newIndex = int(points2D.size());
+				points2D.push_back(newPoint);
+				processList.push_back(newIndex);
+				index = toGrid(newPoint);
+				grid[index.y * gridWidth + index.x] = newIndex;
 			}
 		}
 	}
-	points2D = spawnPoints;
-	return spawnPoints;
 }
 
-glm::vec2 PossionDiskSampling::imageToGrid(glm::vec2 point, float cellSize) {
-	int gridX = (point.x / cellSize);
-	int gridY = (point.y / cellSize);
-	return glm::vec2(std::max(0, gridX-1), std::max(0, gridY-1));
+glm::ivec2 PossionDiskSampling::toGrid(glm::vec2 point) {
+	int gridX = glm::clamp(int(point.x / cellSize), 0, gridWidth - 1);
+	int gridY = glm::clamp(int(point.y / cellSize), 0, gridHeight - 1);
+	return glm::ivec2(gridX, gridY);
 }
 
 glm::vec2 PossionDiskSampling::generateRandomPointAround(glm::vec2 point) {
-	float random1 = rand();
-	random1 /= RAND_MAX;
-	float random2 = rand();
-	random2 /= RAND_MAX;
-	float radius = minDist * (random1 + 1);
-	float angle = 2 * M_PI * random2;
+	float radius = minDist * (distribution(random) + 1);
+	float angle = float(2 * M_PI) * distribution(random);
 
 	glm::vec2 newPoint = glm::vec2(
 			point.x + radius * cos(angle), 
@@ -116,32 +103,45 @@ bool PossionDiskSampling::isValid(glm::vec2 newPoint) {
 	return false;
 }
 
-bool PossionDiskSampling::inNeighbourhood(std::vector<std::vector<glm::vec2>> grid, glm::vec2 newPoint, float cellSize) {
-	glm::vec2 index = imageToGrid(newPoint, cellSize);
-	std::vector<glm::vec2> neighbours = getNeighbours(grid, index, cellSize);
-	for (glm::vec2 cell : neighbours) {
-		if (cell.x != -1 && cell.y != -1) {
-			if (glm::distance(cell, newPoint) < minDist) {
-				return true;
+bool PossionDiskSampling::inNeighbourhood(glm::vec2 newPoint) {
+	// points closer than minDist can be at most two cells away
+	glm::ivec2 index = toGrid(newPoint);
+	int xStart = glm::max(0, index.x - 2);
+	int xEnd = glm::min(index.x + 2, gridWidth - 1);
+	int yStart = glm::max(0, index.y - 2);
+	int yEnd = glm::min(index.y + 2, gridHeight - 1);
+	float minDist2 = minDist * minDist;
+
+	for (int y = yStart; y <= yEnd; y++)
+	{
+		for (int x = xStart; x <= xEnd; x++)
+		{
+			int neighbour = grid[y * gridWidth + x];
+			if (neighbour >= 0) {
+				glm::vec2 delta = points2D[neighbour] - newPoint;
+				if (glm::dot(delta, delta) < minDist2) {
+					return true;
+				}
 			}
 		}
 	}
 	return false;
 }
 
-std::vector<glm::vec2> PossionDiskSampling::getNeighbours(std::vector<std::vector<glm::vec2>> grid, glm::vec2 gridIndex, float cellSize) {
-	std::vector<glm::vec2> neighbours;
-	int xOffsetStart = std::max(0, (int)gridIndex.x-2);
-	int xOffsetEnd = std::min((int)gridIndex.x + 2, (int)grid.size() - 1);
-	int yOffsetStart = std::max(0, (int)gridIndex.y - 2);
-	int yOffsetEnd = std::min((int)gridIndex.y + 2, (int)grid[0].size() - 1);
-
-	for (int i = xOffsetStart; i < xOffsetEnd; i++)
-	{
-		for (int j = yOffsetStart; j < yOffsetEnd; j++)
-		{
-			neighbours.push_back(grid[i][j]);
+void PossionDiskSampling::benchmark(const Image& mask, const Image& heightMap, float scaleY) {
+	int sizes[] = { 1024, 2048, 4096, 8192, 16384 };
+	float distances[] = { 10, 20, 40, 80 };
+
+	std::cout << "Poisson disk sampling benchmark" << std::endl;
+	std::cout << std::setw(8) << "size" << std::setw(10) << "minDist" << std::setw(12) << "points" << std::setw(12) << "ms" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+	for (int size : sizes) {
+		for (float distance : distances) {
+			auto start = std::chrono::high_resolution_clock::now();
+			PossionDiskSampling sampling(size, mask, heightMap, scaleY, distance, 10, 1);
+			auto end = std::chrono::high_resolution_clock::now();
+			double ms = std::chrono::duration<double, std::milli>(end - start).count();
+			std::cout << std::setw(8) << size << std::setw(10) << distance << std::setw(12) << sampling.points3D.size() << std::setw(12) << ms << std::endl;
 		}
 	}
-	return neighbours;
-}
\ No newline at end of file
+}
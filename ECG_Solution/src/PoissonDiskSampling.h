@@ -3,7 +3,7 @@
 #include <glm\detail\type_vec.hpp>
 #include <glm\glm.hpp>
 #include <random>
-#include <ctime>
+#include "Image.h"
 
 
 #define _USE_MATH_DEFINES
@@ -12,24 +12,46 @@
 class PossionDiskSampling {
 
 public:
-	PossionDiskSampling(int terrainSize, const char* maskPath, const char* heightMapPath, float scaleY, float minDist, int count);
+	/*!
+	 * Generates Poisson disk distributed points on the terrain (Bridson's algorithm)
+	 * @param terrainSize: size of the terrain in the XZ plane
+	 * @param mask: points on pixels with a red value of 0 are discarded
+	 * @param heightMap: heightmap used for the y coordinate of the points
+	 * @param scaleY: height of the terrain
+	 * @param minDist: minimum distance between two points
+	 * @param count: candidates generated around every point before it is retired
+	 * @param seed: seed of the random generator, same seed gives the same points
+	 */
+	PossionDiskSampling(int terrainSize, const Image& mask, const Image& heightMap, float scaleY, float minDist, int count, unsigned int seed);
 	~PossionDiskSampling();
 	std::vector<glm::vec3> getPoints();
-	std::vector<glm::vec2> applyMask(const char* maskPath);
-	std::vector<glm::vec3> applyTerrainHeight(const char* heightMapPath, float scaleY);
+
+	/*!
+	 * Prints the generation time for several terrain sizes and distances
+	 */
+	static void benchmark(const Image& mask, const Image& heightMap, float scaleY);
 
 private: 
 	int width;
 	int height;
 	float minDist;
 	int count;
+	float cellSize;
+	int gridWidth;
+	int gridHeight;
+	std::mt19937 random;
+	std::uniform_real_distribution<float> distribution;
+
+	// index into points2D for every cell, -1 if the cell is empty
+	std::vector<int> grid;
 	std::vector<glm::vec2> points2D;
 	std::vector<glm::vec3> points3D;
 
-	std::vector<glm::vec2> generatePossionPoints();
-	glm::vec2 imageToGrid(glm::vec2 point, float cellSize);
+	void generatePossionPoints();
+	void applyMask(const Image& mask);
+	void applyTerrainHeight(const Image& heightMap, float scaleY);
+	glm::ivec2 toGrid(glm::vec2 point);
 	glm::vec2 generateRandomPointAround(glm::vec2 point);
 	bool isValid(glm::vec2 newPoint);
-	bool inNeighbourhood(std::vector<std::vector<glm::vec2>> grid, glm::vec2 newPoint, float cellSize);
-	std::vector<glm::vec2> getNeighbours(std::vector<std::vector<glm::vec2>> grid, glm::vec2 gridIndex, float cellSize);
-};
\ No newline at end of file
+	bool inNeighbourhood(glm::vec2 newPoint);
+};
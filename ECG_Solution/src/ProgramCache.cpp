@@ -0,0 +1,247 @@
+#include "ProgramCache.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <direct.h>
+#include "FileSystem/FileSystem.h"
+
+namespace {
+	const unsigned int CACHE_MAGIC = 0x31424750;	// "PGB1"
+
+	struct CacheHeader {
+		unsigned int magic;
+		unsigned int format;
+		unsigned long long key;
+		unsigned int size;
+	};
+
+	void hashBytes(unsigned long long& hash, const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	}
+
+	std::string getString(GLenum name) {
+		const GLubyte* value = glGetString(name);
+		return value ? reinterpret_cast<const char*>(value) : "";
+	}
+}
+
+ProgramCache* ProgramCache::instance = nullptr;
+
+ShaderStage ShaderStage::fromFile(GLenum type, const std::string& path) {
+	ShaderStage stage;
+	stage.type = type;
+	stage.name = path;
+	FileData file = FileSystem::readFile(path);
+	if (!file.isValid()) {
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+		return stage;
+	}
+	stage.source = file.toString();
+	return stage;
+}
+
+ProgramCache::ProgramCache(const std::string& directory)
+	: directory(directory), loadedCount(0), compiledCount(0) {
+	if (!directory.empty()) {
+		_mkdir(directory.c_str());
+	}
+	driver = getString(GL_VENDOR) + "|" + getString(GL_RENDERER) + "|" + getString(GL_VERSION);
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	binaryFormats.resize(formatCount);
+	if (formatCount > 0) {
+		glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, binaryFormats.data());
+	}
+
+	parallel = GLEW_KHR_parallel_shader_compile != GL_FALSE;
+	if (parallel) {
+		// let the driver pick the number of threads
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+	}
+	instance = this;
+}
+
+ProgramCache::~ProgramCache() {
+	finish();
+	if (instance == this) {
+		instance = nullptr;
+	}
+}
+
+ProgramCache* ProgramCache::getInstance() {
+	return instance;
+}
+
+GLuint ProgramCache::create(const std::vector<ShaderStage>& stages) {
+	if (instance != nullptr) {
+		return instance->load(stages);
+	}
+	// without a directory nothing is read or written
+	ProgramCache uncached("");
+	GLuint program = uncached.load(stages);
+	uncached.finish();
+	return program;
+}
+
+unsigned long long ProgramCache::hash(const std::vector<ShaderStage>& stages) const {
+	unsigned long long hash = 14695981039346656037ull;
+	hashBytes(hash, driver.data(), driver.size());
+	for (const ShaderStage& stage : stages) {
+		hashBytes(hash, &stage.type, sizeof(stage.type));
+		hashBytes(hash, stage.source.data(), stage.source.size());
+		hashBytes(hash, "", 1);
+	}
+	return hash;
+}
+
+std::string ProgramCache::getCachePath(unsigned long long key) const {
+	std::stringstream path;
+	path << directory << std::hex << key << ".bin";
+	return path.str();
+}
+
+bool ProgramCache::loadBinary(GLuint program, const std::string& path, unsigned long long key) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	CacheHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != CACHE_MAGIC || header.key != key) {
+		return false;
+	}
+	// a format the driver does not know anymore would only raise a GL error
+	if (std::find(binaryFormats.begin(), binaryFormats.end(), GLint(header.format)) == binaryFormats.end()) {
+		return false;
+	}
+	std::vector<char> binary(header.size);
+	if (!file.read(binary.data(), header.size)) {
+		return false;
+	}
+
+	glProgramBinary(program, header.format, binary.data(), GLsizei(header.size));
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	return linked == GL_TRUE;
+}
+
+GLuint ProgramCache::load(const std::vector<ShaderStage>& stages) {
+	unsigned long long key = hash(stages);
+	GLuint program = glCreateProgram();
+	PendingProgram pendingProgram;
+	pendingProgram.program = program;
+	pendingProgram.key = key;
+	if (!directory.empty() && !binaryFormats.empty()) {
+		pendingProgram.cachePath = getCachePath(key);
+		if (loadBinary(program, pendingProgram.cachePath, key)) {
+			loadedCount++;
+			return program;
+		}
+	}
+
+	// missing or rejected binary, a failed glProgramBinary leaves the program ready for a normal link
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	for (const ShaderStage& stage : stages) {
+		const char* source = stage.source.c_str();
+		GLuint shader = glCreateShader(stage.type);
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+		glAttachShader(program, shader);
+		pendingProgram.shaders.push_back(shader);
+		pendingProgram.names.push_back(stage.name);
+	}
+	glLinkProgram(program);
+	compiledCount++;
+
+	if (parallel) {
+		pending.push_back(pendingProgram);
+	}
+	else {
+		complete(pendingProgram);
+	}
+	return program;
+}
+
+void ProgramCache::complete(PendingProgram& pendingProgram) {
+	for (size_t i = 0; i < pendingProgram.shaders.size(); i++) {
+		GLint compiled = GL_FALSE;
+		glGetShaderiv(pendingProgram.shaders[i], GL_COMPILE_STATUS, &compiled);
+		if (compiled == GL_FALSE) {
+			GLint logSize = 0;
+			glGetShaderiv(pendingProgram.shaders[i], GL_INFO_LOG_LENGTH, &logSize);
+			std::vector<GLchar> message(logSize > 0 ? logSize : 1);
+			glGetShaderInfoLog(pendingProgram.shaders[i], GLsizei(message.size()), nullptr, message.data());
+			std::cout << "ERROR::SHADER::COMPILATION_FAILED " << pendingProgram.names[i] << std::endl << message.data() << std::endl;
+		}
+		glDetachShader(pendingProgram.program, pendingProgram.shaders[i]);
+		glDeleteShader(pendingProgram.shaders[i]);
+	}
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(pendingProgram.program, GL_LINK_STATUS, &linked);
+	if (linked == GL_FALSE) {
+		GLint logSize = 0;
+		glGetProgramiv(pendingProgram.program, GL_INFO_LOG_LENGTH, &logSize);
+		std::vector<GLchar> message(logSize > 0 ? logSize : 1);
+		glGetProgramInfoLog(pendingProgram.program, GLsizei(message.size()), nullptr, message.data());
+		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED " << pendingProgram.names.front() << std::endl << message.data() << std::endl;
+		return;
+	}
+	if (pendingProgram.cachePath.empty()) {
+		return;
+	}
+
+	GLint size = 0;
+	glGetProgramiv(pendingProgram.program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0) {
+		return;
+	}
+	std::vector<char> binary(size);
+	GLenum format;
+	glGetProgramBinary(pendingProgram.program, size, nullptr, &format, binary.data());
+
+	CacheHeader header;
+	header.magic = CACHE_MAGIC;
+	header.format = format;
+	header.key = pendingProgram.key;
+	header.size = static_cast<unsigned int>(size);
+	std::ofstream file(pendingProgram.cachePath, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), size);
+	if (!file) {
+		std::cout << "Could not write the program binary " << pendingProgram.cachePath << std::endl;
+	}
+}
+
+void ProgramCache::update() {
+	for (size_t i = 0; i < pending.size();) {
+		GLint done = GL_FALSE;
+		glGetProgramiv(pending[i].program, GL_COMPLETION_STATUS_KHR, &done);
+		if (done == GL_TRUE) {
+			complete(pending[i]);
+			pending.erase(pending.begin() + i);
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+void ProgramCache::finish() {
+	for (PendingProgram& pendingProgram : pending) {
+		complete(pendingProgram);
+	}
+	pending.clear();
+}
+
+int ProgramCache::getLoadedCount() const {
+	return loadedCount;
+}
+
+int ProgramCache::getCompiledCount() const {
+	return compiledCount;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+/*!
+ * Source of one stage of a program
+ */
+struct ShaderStage {
+	GLenum type;
+	std::string name;	// file name for error messages
+	std::string source;
+
+	/*!
+	 * Reads the source of a stage, an error is printed and the source stays empty if the file cannot be read
+	 */
+	static ShaderStage fromFile(GLenum type, const std::string& path);
+};
+
+/*!
+ * Creates shader programs and keeps their linked binaries on disk.
+ * A binary is stored under the hash of the sources and the vendor, renderer and version string of the driver,
+ * so a warm start links every program with glProgramBinary instead of compiling GLSL.
+ * A binary the driver rejects (format or driver changed) is rebuilt from source and replaced.
+ *
+ * With KHR_parallel_shader_compile compiling and linking runs on the driver threads: load() returns right away,
+ * update() collects the programs that are done and finish() waits for the rest. Using a program that is not done
+ * yet is allowed, it only blocks until it is linked.
+ */
+class ProgramCache {
+private:
+	struct PendingProgram {
+		GLuint program;
+		std::vector<GLuint> shaders;
+		std::vector<std::string> names;
+		std::string cachePath;
+		unsigned long long key;
+	};
+
+	static ProgramCache* instance;
+
+	std::string directory;
+	std::string driver;
+	std::vector<GLint> binaryFormats;	// formats glProgramBinary accepts
+	bool parallel;
+	std::vector<PendingProgram> pending;
+	int loadedCount;
+	int compiledCount;
+
+	unsigned long long hash(const std::vector<ShaderStage>& stages) const;
+	std::string getCachePath(unsigned long long key) const;
+	bool loadBinary(GLuint program, const std::string& path, unsigned long long key);
+	void complete(PendingProgram& program);
+
+public:
+	/*!
+	 * @param directory: binaries are stored here, it is created if it does not exist
+	 */
+	ProgramCache(const std::string& directory);
+	~ProgramCache();
+
+	/*!
+	 * @return the cache used by the shaders, nullptr if there is none
+	 */
+	static ProgramCache* getInstance();
+
+	/*!
+	 * Creates a program with the cache, or compiles it right away if there is no cache
+	 * @return handle of the program
+	 */
+	static GLuint create(const std::vector<ShaderStage>& stages);
+
+	/*!
+	 * Links a program from its cached binary or starts compiling it from source
+	 * @return handle of the program, it can be used right away
+	 */
+	GLuint load(const std::vector<ShaderStage>& stages);
+
+	/*!
+	 * Reports errors and stores the binaries of the programs the driver finished, never waits
+	 */
+	void update();
+
+	/*!
+	 * Waits for all programs that are still compiling
+	 */
+	void finish();
+
+	int getLoadedCount() const;
+	int getCompiledCount() const;
+};
@@ -1,16 +1,34 @@
 
 #include "Scene.h"
+#include "FileSystem/AssimpIOSystem.h"
+#include "ActorHandle.h"
 
 void Scene::draw() {
 	_drawnObjects = 0;
+	if (_batch) {
+		_batch->begin();
+	}
 	for (unsigned int i = 0; i < nodes.size(); i++) {
 		if (nodes[i]->name.compare("cook_map_cook_Plane_Plane")) {
 			nodes[i]->draw();
 		}
 	}
+	if (_batch) {
+		_batch->draw(_shader.get());
+	}
 	//std::cout << "Objects: " << _drawnObjects << std::endl << std::endl;
 }
 
+void Scene::buildBatch() {
+	_batch = std::make_shared<DrawBatch>();
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		if (nodes[i]->name.compare("cook_map_cook_Plane_Plane")) {
+			nodes[i]->setBatch(_batch.get());
+		}
+	}
+	_batch->build();
+}
+
 void Scene::drawDepth(Shader* shader) {
 	_drawnObjects = 0;
 	for (unsigned int i = 0; i < nodes.size(); i++) {
@@ -21,32 +39,163 @@ void Scene::drawDepth(Shader* shader) {
 }
 
 
-std::shared_ptr<Node> Scene::loadScene(string path) {
-	Assimp::Importer import;
-	const aiScene* scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+const std::string Scene::floorPrefix = "cook_";
+const std::string Scene::enemyPrefix = "mob_";
 
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-		std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
-		return nullptr;
+static void collectCookedMeshes(const aiNode* node, std::vector<bool>& cook) {
+	std::string name = node->mName.C_Str();
+	if (!name.compare(0, Scene::floorPrefix.size(), Scene::floorPrefix)) {
+		for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+			cook[node->mMeshes[i]] = true;
+		}
+	}
+	for (unsigned int i = 0; i < node->mNumChildren; i++) {
+		collectCookedMeshes(node->mChildren[i], cook);
 	}
-	//directory = path.substr(0, path.find_last_of('/'));
-	return processNode(scene->mRootNode, scene, 0, false, 1, physx::PxExtendedVec3(0, 0, 0), nullptr);
 }
 
-std::shared_ptr<Node> Scene::loadScene(string path, float scale, physx::PxExtendedVec3 position) {
-	Assimp::Importer import;
-	const aiScene* scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+std::shared_ptr<SceneImport> Scene::importFile(const std::string& path, physx::PxCooking* cooking) {
+	std::shared_ptr<SceneImport> import = std::make_shared<SceneImport>();
+	import->importer = std::make_shared<Assimp::Importer>();
+	// the model and its .mtl are read through the virtual file system
+	import->importer->SetIOHandler(new AssimpIOSystem());
+	const aiScene* scene = import->importer->ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
 
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-		std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
+		std::cout << "ERROR::ASSIMP::" << import->importer->GetErrorString() << std::endl;
+		return import;
+	}
+	import->scene = scene;
+	import->cooked.resize(scene->mNumMeshes);
+	import->triangleMeshes.resize(scene->mNumMeshes, nullptr);
+
+	// collision meshes are cooked in model space, every copy of the file scales the same triangle mesh
+	std::vector<bool> cook(scene->mNumMeshes, false);
+	collectCookedMeshes(scene->mRootNode, cook);
+	for (unsigned int m = 0; m < scene->mNumMeshes; m++) {
+		if (!cook[m]) {
+			continue;
+		}
+		aiMesh* mesh = scene->mMeshes[m];
+		std::vector<physx::PxU32> indices;
+		for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+			aiFace face = mesh->mFaces[i];
+			for (unsigned int j = 0; j < face.mNumIndices; j++) {
+				indices.push_back(face.mIndices[j]);
+			}
+		}
+
+		physx::PxTriangleMeshDesc meshDesc;
+		meshDesc.points.count = mesh->mNumVertices;
+		meshDesc.points.stride = sizeof(aiVector3D);
+		meshDesc.points.data = mesh->mVertices;
+
+		meshDesc.triangles.count = mesh->mNumFaces;
+		meshDesc.triangles.stride = 3 * sizeof(physx::PxU32);
+		meshDesc.triangles.data = &indices[0];
+
+		std::shared_ptr<physx::PxDefaultMemoryOutputStream> writeBuffer = std::make_shared<physx::PxDefaultMemoryOutputStream>();
+		physx::PxTriangleMeshCookingResult::Enum result;
+		if (cooking->cookTriangleMesh(meshDesc, *writeBuffer, &result)) {
+			import->cooked[m] = writeBuffer;
+		}
+	}
+	return import;
+}
+
+PreparedScene Scene::prepare(std::shared_ptr<SceneImport> import, float scale, physx::PxExtendedVec3 position) {
+	PreparedScene prepared;
+	prepared.source = import;
+	prepared.scale = scale;
+	prepared.position = position;
+	if (!import->scene) {
+		return prepared;
+	}
+
+	const aiScene* scene = import->scene;
+	prepared.meshes.resize(scene->mNumMeshes);
+	for (unsigned int m = 0; m < scene->mNumMeshes; m++) {
+		aiMesh* mesh = scene->mMeshes[m];
+		GeometryData& data = prepared.meshes[m].data;
+		glm::vec3 maxVert(-1500.0f, -1500.0f, -1500.0f);
+		glm::vec3 minVert(1500.0f, 1500.0f, 1500.0f);
+
+		data.positions.reserve(mesh->mNumVertices);
+		data.normals.reserve(mesh->mNumVertices);
+		data.uvs.reserve(mesh->mNumVertices);
+		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+			glm::vec4 vector;
+			vector.x = mesh->mVertices[i].x * scale + position.x;
+			vector.y = mesh->mVertices[i].y * scale + position.y;
+			vector.z = mesh->mVertices[i].z * scale + position.z;
+			vector.w = 1.0f;
+
+
+			// for bounding box
+			maxVert.x = max(maxVert.x, vector.x);
+			maxVert.y = max(maxVert.y, vector.y);
+			maxVert.z = max(maxVert.z, vector.z);
+			minVert.x = min(minVert.x, vector.x);
+			minVert.y = min(minVert.y, vector.y);
+			minVert.z = min(minVert.z, vector.z);
+
+
+			data.positions.push_back(vector);
+
+			if (mesh->mNormals == nullptr) {
+				vector.x = 0;
+				vector.y = 1;
+				vector.z = 0;
+			}
+			else {
+				vector.x = mesh->mNormals[i].x;
+				vector.y = mesh->mNormals[i].y;
+				vector.z = mesh->mNormals[i].z;
+			}
+
+			data.normals.push_back(vector);
+
+			if (mesh->mTextureCoords[0]) {
+				glm::vec2 vec;
+				vec.x = mesh->mTextureCoords[0][i].x;
+				vec.y = 1.0f - mesh->mTextureCoords[0][i].y;
+				data.uvs.push_back(vec);
+			}
+			else {
+				data.uvs.push_back(glm::vec2(0.0f, 0.0f));
+			}
+		}
+
+		for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+			aiFace face = mesh->mFaces[i];
+			for (unsigned int j = 0; j < face.mNumIndices; j++) {
+				data.indices.push_back(face.mIndices[j]);
+			}
+		}
+		prepared.meshes[m].minVert = minVert;
+		prepared.meshes[m].maxVert = maxVert;
+	}
+	return prepared;
+}
+
+std::shared_ptr<Node> Scene::addPrepared(PreparedScene& prepared, SimulationCallback* simulationCallback) {
+	if (!prepared.source || !prepared.source->scene) {
 		return nullptr;
 	}
-	//directory = path.substr(0, path.find_last_of('/'));
-	return processNode(scene->mRootNode, scene, 0, true, scale, position, nullptr);
+	return processNode(prepared.source->scene->mRootNode, prepared, 0, simulationCallback);
 }
 
-std::shared_ptr<Node> Scene::processNode(aiNode* node, const aiScene* scene, int level, bool transformation,
-	float scale, physx::PxExtendedVec3 position, SimulationCallback* simulationCallback) {
+std::shared_ptr<Node> Scene::loadScene(string path) {
+	PreparedScene prepared = prepare(importFile(path, _cooking), 1, physx::PxExtendedVec3(0, 0, 0));
+	return addPrepared(prepared);
+}
+
+std::shared_ptr<Node> Scene::loadScene(string path, float scale, physx::PxExtendedVec3 position) {
+	PreparedScene prepared = prepare(importFile(path, _cooking), scale, position);
+	return addPrepared(prepared);
+}
+
+std::shared_ptr<Node> Scene::processNode(aiNode* node, PreparedScene& prepared, int level, SimulationCallback* simulationCallback) {
 	// process all the node's meshes (if any)
 	std::string tmpnam = node->mName.C_Str();
 	bool isEnemy = false;
@@ -66,15 +215,8 @@ std::shared_ptr<Node> Scene::processNode(aiNode* node, const aiScene* scene, int
 	}
 	newNode->name = tmpnam;
 
-	//if (transformation) {
-	//	newNode->setPosition(position);
-	//	newNode->transform(glm::scale(glm::mat4(1), glm::vec3(scale)));
-	//}
-
 	for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-
-		processMesh(mesh, scene, cookMesh, isEnemy, newNode, scale, position, simulationCallback);
+		processMesh(node->mMeshes[i], prepared, cookMesh, isEnemy, newNode, simulationCallback);
 	}
 
 	if (level == 1 && node->mNumMeshes > 0) {
@@ -86,69 +228,22 @@ std::shared_ptr<Node> Scene::processNode(aiNode* node, const aiScene* scene, int
 	level++;
 	// then do the same for each of its children
 	for (unsigned int i = 0; i < node->mNumChildren; i++) {
-		newNode->addChild(processNode(node->mChildren[i], scene, level, transformation, scale, position, simulationCallback));
+		newNode->addChild(processNode(node->mChildren[i], prepared, level, simulationCallback));
 	}
 
 	return newNode;
 }
 
 
-void Scene::processMesh(aiMesh* mesh, const aiScene* scene, bool cookMesh, bool isEnemy, std::shared_ptr<Node> newNode,
-	float scale, physx::PxExtendedVec3 position, SimulationCallback* simulationCallback) {
-	GeometryData data;
-	glm::vec3 maxVert(-1500.0f, -1500.0f, -1500.0f);
-	glm::vec3 minVert(1500.0f, 1500.0f, 1500.0f);
-
-
-	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-		glm::vec4 vector;
-		vector.x = mesh->mVertices[i].x * scale + position.x;
-		vector.y = mesh->mVertices[i].y * scale + position.y;
-		vector.z = mesh->mVertices[i].z * scale + position.z;
-		vector.w = 1.0f;
-
-
-		// for bounding box
-		maxVert.x = max(maxVert.x, vector.x);
-		maxVert.y = max(maxVert.y, vector.y);
-		maxVert.z = max(maxVert.z, vector.z);
-		minVert.x = min(minVert.x, vector.x);
-		minVert.y = min(minVert.y, vector.y);
-		minVert.z = min(minVert.z, vector.z);
-
-
-		data.positions.push_back(vector);
-
-		if (mesh->mNormals == nullptr) {
-			vector.x = 0;
-			vector.y = 1;
-			vector.z = 0;
-		}
-		else {
-			vector.x = mesh->mNormals[i].x;
-			vector.y = mesh->mNormals[i].y;
-			vector.z = mesh->mNormals[i].z;
-		}
-
-		data.normals.push_back(vector);
-
-		if (mesh->mTextureCoords[0]) {
-			glm::vec2 vec;
-			vec.x = mesh->mTextureCoords[0][i].x;
-			vec.y = 1.0f - mesh->mTextureCoords[0][i].y;
-			data.uvs.push_back(vec);
-		}
-		else {
-			data.uvs.push_back(glm::vec2(0.0f, 0.0f));
-		}
-	}
-
-	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-		aiFace face = mesh->mFaces[i];
-		for (unsigned int j = 0; j < face.mNumIndices; j++) {
-			data.indices.push_back(face.mIndices[j]);
-		}
-	}
+void Scene::processMesh(unsigned int meshIndex, PreparedScene& prepared, bool cookMesh, bool isEnemy, std::shared_ptr<Node> newNode,
+	SimulationCallback* simulationCallback) {
+	SceneImport& source = *prepared.source;
+	const aiScene* scene = source.scene;
+	aiMesh* mesh = scene->mMeshes[meshIndex];
+	GeometryData& data = prepared.meshes[meshIndex].data;
+	glm::vec3 maxVert = prepared.meshes[meshIndex].maxVert;
+	glm::vec3 minVert = prepared.meshes[meshIndex].minVert;
+	physx::PxExtendedVec3 position = prepared.position;
 
 	std::shared_ptr<Material> mat = _missingMaterial;
 
@@ -172,29 +267,19 @@ void Scene::processMesh(aiMesh* mesh, const aiScene* scene, bool cookMesh, bool
 	glm::vec3 middlePos = (maxVert + minVert) / 2.0f;
 	glm::vec3 lenVec = maxVert - minVert;
 	if (cookMesh) {
-		physx::PxTriangleMeshDesc meshDesc;
-		meshDesc.points.count = mesh->mNumVertices;
-		meshDesc.points.stride = sizeof(aiVector3D);
-		meshDesc.points.data = mesh->mVertices;
-
-		meshDesc.triangles.count = mesh->mNumFaces;
-		meshDesc.triangles.stride = 3 * sizeof(physx::PxU32);
-		meshDesc.triangles.data = &data.indices[0];
-
-		physx::PxDefaultMemoryOutputStream writeBuffer;
-		physx::PxTriangleMeshCookingResult::Enum result;
-		bool status = _cooking->cookTriangleMesh(meshDesc, writeBuffer, &result);
-		if (!status) {
+		if (!source.cooked[meshIndex]) {
 			return;
 		}
-
-		physx::PxDefaultMemoryInputData readBuffer(writeBuffer.getData(), writeBuffer.getSize());
-		physx::PxTriangleMesh* triangleMesh = _physics->createTriangleMesh(readBuffer);
+		if (!source.triangleMeshes[meshIndex]) {
+			physx::PxDefaultMemoryInputData readBuffer(source.cooked[meshIndex]->getData(), source.cooked[meshIndex]->getSize());
+			source.triangleMeshes[meshIndex] = _physics->createTriangleMesh(readBuffer);
+		}
+		physx::PxTriangleMesh* triangleMesh = source.triangleMeshes[meshIndex];
 
 		physx::PxTransform floorPos = physx::PxTransform(position.x, position.y, position.z);
 		meshActor = _physics->createRigidStatic(floorPos);
 		meshActor->setName("cook");
-		physx::PxTriangleMeshGeometry geom(triangleMesh, physx::PxMeshScale(scale));
+		physx::PxTriangleMeshGeometry geom(triangleMesh, physx::PxMeshScale(prepared.scale));
 		physx::PxShape* floorShape = physx::PxRigidActorExt::createExclusiveShape(*meshActor, geom, *_material);
 		_scene->addActor(*meshActor);
 	}
@@ -214,44 +299,14 @@ void Scene::processMesh(aiMesh* mesh, const aiScene* scene, bool cookMesh, bool
 
 		pxChar = _manager->createController(bDesc);
 		meshActor = pxChar->getActor();
-		//std::string eNameStr = std::to_string(enemies.size());
-		//const char* eName = eNameStr.c_str();
-
-		//HARDCODING FROM HELL
-		if (enemies.size() == 0) {
-			pxChar->getActor()->setName("0");
-		}
-		else if (enemies.size() == 1) {
-			pxChar->getActor()->setName("1");
-		}
-		else if (enemies.size() == 2) {
-			pxChar->getActor()->setName("2");
-		}
-		else if (enemies.size() == 3) {
-			pxChar->getActor()->setName("3");
-		}
-		else if (enemies.size() == 4) {
-			pxChar->getActor()->setName("4");
-		}
-		else if (enemies.size() == 5) {
-			pxChar->getActor()->setName("5");
-		}
-		else if (enemies.size() == 6) {
-			pxChar->getActor()->setName("6");
-		}
-		else if (enemies.size() == 7) {
-			pxChar->getActor()->setName("7");
-		}
-		else if (enemies.size() == 8) {
-			pxChar->getActor()->setName("8");
-		}
+		// the enemy is added to enemies after its meshes, with the same index as its agent
+		unsigned int agent = crowd.add(glm::vec3(position.x, position.y, position.z), pxChar, bDesc.halfHeight + bDesc.contactOffset);
+		ActorHandle::set(meshActor, ActorHandle::Kind::Enemy, agent);
 
 		std::shared_ptr<Enemy> enemyNode = std::static_pointer_cast<Enemy>(newNode);
-		enemyNode->setCharacterController(pxChar);
+		enemyNode->setAgent(&crowd, agent);
 		enemyNode->setPosition(bDesc.position);
 		enemyNode->_startingPosition = -middlePos;
-
-		enemyNode->setSpawnPosition(bDesc.position);
 	}
 	std::shared_ptr<std::vector<glm::vec3>> boundingBox = std::make_shared<std::vector<glm::vec3>>();
 	lenVec = lenVec / 2.0f;
@@ -339,6 +394,13 @@ void Character::relocate(physx::PxExtendedVec3 pos) {
 	}
 	setPosition(_pxController->getPosition());
 	_camera->setPosition(_pxController->getPosition());
+	savePreviousState();
+}
+
+void Character::reset(physx::PxExtendedVec3 pos) {
+	hp = MAX_HP;
+	soundIsPlaying = false;
+	relocate(pos);
 }
 
 void Character::updateRotation(float angle) {
@@ -348,6 +410,59 @@ void Character::updateRotation(float angle) {
 	}
 }
 
+void Character::savePreviousState() {
+	Scene::savePreviousState();
+	_previousPosition = _position;
+}
+
+void Character::interpolate(float alpha) {
+	Scene::interpolate(alpha);
+	glm::vec3 position = glm::mix(_previousPosition, _position, alpha);
+	_camera->setPosition(physx::PxExtendedVec3(position.x, position.y, position.z));
+}
+
+void Scene::despawnEnemies() {
+	for (size_t i = 0; i < enemies.size(); i++) {
+		enemies[i]->despawn();
+	}
+}
+
+void Scene::updateEnemies(glm::vec3 playerPos, float dt, const HeightField& heightField, const FlowField* flowField,
+	const SceneQueryBatch* queries, ThreadPool& pool) {
+	crowd.update(playerPos, dt, heightField, flowField, queries, pool);
+	pool.parallelFor(int(enemies.size()), [this](int i) {
+		enemies[i]->syncWithCrowd();
+	});
+}
+
+void Scene::updateAudibleEnemies(glm::vec3 playerPos, unsigned int voices, float hearingDistance) {
+	for (unsigned int enemy : audibleEnemies) {
+		enemies[enemy]->setAudible(false);
+	}
+	crowd.getSpatialHash().queryNearest(playerPos, voices, hearingDistance, audibleEnemies);
+	for (unsigned int enemy : audibleEnemies) {
+		enemies[enemy]->setAudible(true);
+	}
+}
+
+void Scene::savePreviousState() {
+	for (size_t i = 0; i < nodes.size(); i++) {
+		nodes[i]->savePreviousState();
+	}
+	for (size_t i = 0; i < enemies.size(); i++) {
+		enemies[i]->savePreviousState();
+	}
+}
+
+void Scene::interpolate(float alpha) {
+	for (size_t i = 0; i < nodes.size(); i++) {
+		nodes[i]->interpolate(alpha);
+	}
+	for (size_t i = 0; i < enemies.size(); i++) {
+		enemies[i]->interpolate(alpha);
+	}
+}
+
 std::shared_ptr<Node> Scene::getNodeWithName(std::string name) {
 	for (size_t i = 0; i < nodes.size(); i++) {
 		if (nodes[i]->name == name) {
@@ -474,15 +589,6 @@ void Scene::addStaticObject(string path, physx::PxExtendedVec3 position, float s
 }
 
 void Scene::addEnemy(physx::PxExtendedVec3 position, float scale, SimulationCallback* simulationCallback) {
-	//if (enemyMaster == nullptr) {
-	Assimp::Importer import;
-	const aiScene* enemyMasterX = import.ReadFile("assets/models/enemy.obj", aiProcess_Triangulate | aiProcess_FlipUVs);
-
-	if (!enemyMasterX || enemyMasterX->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !enemyMasterX->mRootNode) {
-		std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
-		return;
-	}
-	//	}
-
-	processNode(enemyMasterX->mRootNode, enemyMasterX, 0, true, scale, position, simulationCallback);
+	PreparedScene prepared = prepare(importFile("assets/models/enemy.obj", _cooking), scale, position);
+	addPrepared(prepared, simulationCallback);
 }
@@ -15,6 +15,32 @@
 #include "FrustumG.h"
 #include "SimulationCallback.h"
 
+/*!
+ * A model file read by Assimp with the collision meshes of its "cook_" nodes already cooked.
+ * Made by Scene::importFile() on any thread and shared by every prepared copy of the file.
+ */
+struct SceneImport {
+	std::shared_ptr<Assimp::Importer> importer;	// owns scene
+	const aiScene* scene = nullptr;				// nullptr if the file could not be read
+	std::vector<std::shared_ptr<physx::PxDefaultMemoryOutputStream>> cooked;	// per mesh, nullptr if not cooked
+	std::vector<physx::PxTriangleMesh*> triangleMeshes;	// created from cooked when the first copy is added
+};
+
+struct PreparedMesh {
+	GeometryData data;
+	glm::vec3 minVert, maxVert;
+};
+
+/*!
+ * One copy of an imported file with its vertices already scaled and moved into the world, made by Scene::prepare()
+ */
+struct PreparedScene {
+	std::shared_ptr<SceneImport> source;
+	float scale = 1.0f;
+	physx::PxExtendedVec3 position;
+	std::vector<PreparedMesh> meshes;	// per mesh of the import
+};
+
 
 class Scene {
 protected:
@@ -32,27 +58,81 @@ protected:
 	std::shared_ptr<FrustumG> _viewFrustum;
 	unsigned int _drawnObjects;
 	irrklang::ISoundEngine* _soundEngine;
+	std::shared_ptr<DrawBatch> _batch;
 
 	long long* highscore;
 
-public:
-	Scene(std::shared_ptr<Shader> shader, char *path, physx::PxPhysics* physics, physx::PxCooking* cooking, physx::PxScene* scene, 
+	Scene(std::shared_ptr<Shader> shader, physx::PxPhysics* physics, physx::PxCooking* cooking, physx::PxScene* scene,
 		physx::PxMaterial* material, physx::PxControllerManager* manager, std::shared_ptr<FrustumG> viewFrustum, long long* _highscore, irrklang::ISoundEngine* soundEngine)
 		: _shader(shader), _physics(physics), _cooking(cooking), _scene(scene), 
 		_material(material), _manager(manager), _viewFrustum(viewFrustum), highscore(_highscore), _soundEngine(soundEngine) {
 		_missingMaterial = std::make_shared<TextureMaterial>(_shader, glm::vec3(1.0f, 0.0f, 0.0f), 1.0f, "assets/textures/snow.jpg"/*"assets/textures/missing.png"*/);
 		_directory = "assets/textures/";
 		_drawnObjects = 0;
+	}
+
+public:
+	static const std::string floorPrefix;
+	static const std::string enemyPrefix;
+
+	Scene(std::shared_ptr<Shader> shader, char *path, physx::PxPhysics* physics, physx::PxCooking* cooking, physx::PxScene* scene, 
+		physx::PxMaterial* material, physx::PxControllerManager* manager, std::shared_ptr<FrustumG> viewFrustum, long long* _highscore, irrklang::ISoundEngine* soundEngine)
+		: Scene(shader, physics, cooking, scene, material, manager, viewFrustum, _highscore, soundEngine) {
 		loadScene(path);
 	}
 
+	/*!
+	 * Creates the scene from a file that was imported and prepared before, on the thread with the GL context
+	 */
+	Scene(std::shared_ptr<Shader> shader, PreparedScene& prepared, physx::PxPhysics* physics, physx::PxCooking* cooking, physx::PxScene* scene,
+		physx::PxMaterial* material, physx::PxControllerManager* manager, std::shared_ptr<FrustumG> viewFrustum, long long* _highscore, irrklang::ISoundEngine* soundEngine)
+		: Scene(shader, physics, cooking, scene, material, manager, viewFrustum, _highscore, soundEngine) {
+		addPrepared(prepared);
+	}
+
 	void draw();
 	void drawDepth(Shader* shader);
+
+	/*!
+	 * Moves all meshes into one DrawBatch, draw() renders them with a single multi-draw call from then on.
+	 * Called once after the last object was added.
+	 */
+	void buildBatch();
 	std::vector<std::shared_ptr<Node>> nodes;
 	std::vector<std::shared_ptr<Enemy>> enemies;
+	Crowd crowd;	// agent i belongs to enemies[i], every enemy of the pool is added while loading
+	std::vector<unsigned int> audibleEnemies;
 	std::shared_ptr<Node> getNodeWithName(std::string name);
 	std::shared_ptr<Enemy> getEnemyWithActor(physx::PxRigidActor* actor);
 
+	/*!
+	 * Returns every enemy to the pool of the crowd
+	 */
+	void despawnEnemies();
+
+	/*!
+	 * Lets the crowd chase the player and moves the enemy nodes to their agents
+	 * @param flowField: nullptr while the navigation is not loaded
+	 * @param queries: executed batch with the ground probes of the crowd
+	 */
+	void updateEnemies(glm::vec3 playerPos, float dt, const HeightField& heightField, const FlowField* flowField,
+		const SceneQueryBatch* queries, ThreadPool& pool);
+
+	/*!
+	 * Lets only the enemies nearest to the player play sounds
+	 */
+	void updateAudibleEnemies(glm::vec3 playerPos, unsigned int voices, float hearingDistance);
+
+	/*!
+	 * Remembers the state of the nodes and enemies before a simulation step
+	 */
+	void savePreviousState();
+
+	/*!
+	 * Places the nodes and enemies between the last two simulation steps for drawing
+	 */
+	void interpolate(float alpha);
+
 	unsigned int getDrawnObjects() {
 		return _drawnObjects;
 	}
@@ -60,13 +140,26 @@ public:
 	void addStaticObject(string path, physx::PxExtendedVec3 position, float scale);
 	void addEnemy(physx::PxExtendedVec3 position, float scale, SimulationCallback* simulationCallback);
 
+	/*!
+	 * Reads a model file and cooks its collision meshes, touches neither GL nor the physics scene so it can run on a worker
+	 */
+	static std::shared_ptr<SceneImport> importFile(const std::string& path, physx::PxCooking* cooking);
+
+	/*!
+	 * Builds the vertex data of one copy of an import, can run on a worker
+	 */
+	static PreparedScene prepare(std::shared_ptr<SceneImport> import, float scale, physx::PxExtendedVec3 position);
+
+	/*!
+	 * Uploads a prepared copy and adds its actors and enemies, on the thread with the GL context
+	 * @return root node of the copy, nullptr if the file could not be read
+	 */
+	std::shared_ptr<Node> addPrepared(PreparedScene& prepared, SimulationCallback* simulationCallback = nullptr);
+
 private:
-	std::string floorPrefix = "cook_";
-	std::string enemyPrefix = "mob_";
-	std::shared_ptr<Node> processNode(aiNode *node, const aiScene *scene, int level, bool transformation, 
-		float scale, physx::PxExtendedVec3 position, SimulationCallback* simulationCallback);
-	void processMesh(aiMesh *mesh, const aiScene *scene, bool cookMesh, bool isEnemy, std::shared_ptr<Node> newNode, 
-		float scale, physx::PxExtendedVec3 position, SimulationCallback* simulationCallback);
+	std::shared_ptr<Node> processNode(aiNode *node, PreparedScene& prepared, int level, SimulationCallback* simulationCallback);
+	void processMesh(unsigned int meshIndex, PreparedScene& prepared, bool cookMesh, bool isEnemy, std::shared_ptr<Node> newNode,
+		SimulationCallback* simulationCallback);
 	std::shared_ptr<Material> loadMaterialTextures(aiMaterial *mat, aiTextureType type,
 		string typeName);
 };
@@ -75,6 +168,7 @@ class Character : public Scene
 {
 protected:
 	glm::vec3 _position;
+	glm::vec3 _previousPosition;
 	glm::vec3 _direction;
 	physx::PxController* _pxController;
 	PlayerCamera* _camera;
@@ -90,7 +184,8 @@ protected:
 	GLuint vao;
 	GLuint vector_size;
 	int order[4];
-	int hp = 100;
+	static const int MAX_HP = 100;
+	int hp = MAX_HP;
 	bool soundIsPlaying = false;
 
 public:
@@ -102,6 +197,14 @@ public:
 	{
 		move(0.0f, 0.0f, 0.0f);	
 	}
+	Character(std::shared_ptr<Shader> shader, PreparedScene& prepared, physx::PxPhysics* physics, physx::PxCooking* cooking,
+		physx::PxScene* scene, physx::PxMaterial* material, physx::PxController* c, PlayerCamera* camera,
+		physx::PxControllerManager* manager, GLuint animationShader, std::shared_ptr<FrustumG> viewFrustum, irrklang::ISoundEngine* soundEngine)
+		: Scene(shader, prepared, physics, cooking, scene, material, manager, viewFrustum, nullptr, soundEngine), _pxController(c),
+		_camera(camera), _animationShader(animationShader), order{ 2, 0, 2, 1 }
+	{
+		move(0.0f, 0.0f, 0.0f);
+	}
 	~Character() {
 
 	}
@@ -111,11 +214,30 @@ public:
 	void move(float forward, float strafeLeft, float dt);
 	void move2(glm::vec3 dir, float speed, float dt);
 	void relocate(physx::PxExtendedVec3 pos);
+
+	/*!
+	 * Full health at the given position, for a new round
+	 */
+	void reset(physx::PxExtendedVec3 pos);
 	void updateRotation(float angle);
+
+	void savePreviousState();
+
+	/*!
+	 * Also moves the camera to the interpolated position, so it does not step at the simulation rate
+	 */
+	void interpolate(float alpha);
 	glm::vec3 getPosition() {
 		return _position;
 	}
 
+	/*!
+	 * Position before the current simulation step
+	 */
+	glm::vec3 getPreviousPosition() {
+		return _previousPosition;
+	}
+
 	int getHP() {
 		return hp;
 	}
@@ -0,0 +1,169 @@
+#include "SceneQueryBatch.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+	physx::PxVec3 toPx(const glm::vec3& v) {
+		return physx::PxVec3(v.x, v.y, v.z);
+	}
+
+	// a ground plane with a few rocks, every enemy probes the ground below it and sweeps a sphere towards the center
+	double runQueries(physx::PxPhysics& physics, int enemyCount, bool batched) {
+		using namespace physx;
+		const int warmupSteps = 10;
+		const int measuredSteps = 100;
+
+		PxSceneDesc sceneDesc(physics.getTolerancesScale());
+		sceneDesc.gravity = PxVec3(0.0f, -9.8f, 0.0f);
+		PxDefaultCpuDispatcher* dispatcher = PxDefaultCpuDispatcherCreate(1);
+		sceneDesc.cpuDispatcher = dispatcher;
+		sceneDesc.filterShader = PxDefaultSimulationFilterShader;
+		PxScene* scene = physics.createScene(sceneDesc);
+		PxMaterial* material = physics.createMaterial(0.5f, 0.5f, 0.5f);
+		scene->addActor(*PxCreatePlane(physics, PxPlane(0, 1, 0, 0), *material));
+		for (int i = 0; i < 64; i++) {
+			PxVec3 position(float(i % 8) * 40.0f - 140.0f, 2.0f, float(i / 8) * 40.0f - 140.0f);
+			scene->addActor(*PxCreateStatic(physics, PxTransform(position), PxBoxGeometry(4.0f, 4.0f, 4.0f), *material));
+		}
+
+		int columns = int(std::ceil(std::sqrt(float(enemyCount))));
+		std::vector<glm::vec3> enemies;
+		for (int i = 0; i < enemyCount; i++) {
+			enemies.push_back(glm::vec3(float(i % columns) * 6.0f - columns * 3.0f, 3.0f, float(i / columns) * 6.0f - columns * 3.0f));
+		}
+
+		float hits = 0.0f;
+		double ms = 0.0;
+		// the batch query belongs to the scene, it is released before the scene
+		{
+			SceneQueryBatch batch(scene, enemyCount, enemyCount);
+			PxSphereGeometry sphere(1.0f);
+			PxQueryFilterData filter(PxQueryFlag::eSTATIC);
+			for (int step = 0; step < warmupSteps + measuredSteps; step++) {
+				auto start = std::chrono::high_resolution_clock::now();
+				for (const glm::vec3& enemy : enemies) {
+					glm::vec3 toCenter = glm::length(enemy) > 1.0f ? -glm::normalize(enemy) : glm::vec3(1, 0, 0);
+					if (batched) {
+						batch.addRaycast(enemy, glm::vec3(0, -1, 0), 10.0f);
+						batch.addSweep(sphere, enemy, toCenter, 30.0f);
+						continue;
+					}
+					PxRaycastBuffer ray;
+					if (scene->raycast(toPx(enemy), PxVec3(0, -1, 0), 10.0f, ray, PxHitFlag::eDEFAULT, filter)) {
+						hits += ray.block.distance;
+					}
+					PxSweepBuffer sweep;
+					if (scene->sweep(sphere, PxTransform(toPx(enemy)), toPx(toCenter), 30.0f, sweep, PxHitFlag::eDEFAULT, filter)) {
+						hits += sweep.block.distance;
+					}
+				}
+				if (batched) {
+					batch.execute();
+					for (int i = 0; i < enemyCount; i++) {
+						float distance;
+						if (batch.getRaycastHit(i, distance)) {
+							hits += distance;
+						}
+						if (batch.getSweepHit(i, distance)) {
+							hits += distance;
+						}
+					}
+					batch.clear();
+				}
+				if (step >= warmupSteps) {
+					ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+				}
+			}
+		}
+
+		// the sum keeps the compiler from dropping the queries
+		if (hits < 0.0f) {
+			std::cout << hits << std::endl;
+		}
+		scene->release();
+		material->release();
+		dispatcher->release();
+		return ms / measuredSteps;
+	}
+
+}
+
+SceneQueryBatch::SceneQueryBatch(physx::PxScene* scene, unsigned int maxRaycasts, unsigned int maxSweeps)
+	: raycastResults(maxRaycasts), sweepResults(maxSweeps), raycastCount(0), sweepCount(0), executed(false) {
+	physx::PxBatchQueryDesc desc(maxRaycasts, maxSweeps, 0);
+	desc.queryMemory.userRaycastResultBuffer = raycastResults.data();
+	desc.queryMemory.userSweepResultBuffer = sweepResults.data();
+	batch = scene->createBatchQuery(desc);
+	if (!batch) {
+		std::cout << "Could not create the scene query batch" << std::endl;
+	}
+}
+
+SceneQueryBatch::~SceneQueryBatch() {
+	if (batch) {
+		batch->release();
+	}
+}
+
+void SceneQueryBatch::clear() {
+	raycastCount = 0;
+	sweepCount = 0;
+	executed = false;
+}
+
+int SceneQueryBatch::addRaycast(const glm::vec3& origin, const glm::vec3& direction, float distance,
+	const physx::PxQueryFilterData& filter) {
+	if (!batch || raycastCount == raycastResults.size() || distance <= 0.0f || glm::dot(direction, direction) < 1e-12f) {
+		return -1;
+	}
+	batch->raycast(toPx(origin), toPx(glm::normalize(direction)), distance, 0, physx::PxHitFlag::eDEFAULT, filter);
+	return int(raycastCount++);
+}
+
+int SceneQueryBatch::addSweep(const physx::PxGeometry& geometry, const glm::vec3& origin, const glm::vec3& direction, float distance,
+	const physx::PxQueryFilterData& filter) {
+	if (!batch || sweepCount == sweepResults.size() || distance <= 0.0f || glm::dot(direction, direction) < 1e-12f) {
+		return -1;
+	}
+	batch->sweep(geometry, physx::PxTransform(toPx(origin)), toPx(glm::normalize(direction)), distance, 0,
+		physx::PxHitFlag::eDEFAULT, filter);
+	return int(sweepCount++);
+}
+
+void SceneQueryBatch::execute() {
+	if (batch && (raycastCount > 0 || sweepCount > 0)) {
+		batch->execute();
+	}
+	executed = true;
+}
+
+bool SceneQueryBatch::getRaycastHit(int slot, float& distance) const {
+	if (!executed || slot < 0 || unsigned(slot) >= raycastCount || !raycastResults[slot].hasBlock) {
+		return false;
+	}
+	distance = raycastResults[slot].block.distance;
+	return true;
+}
+
+bool SceneQueryBatch::getSweepHit(int slot, float& distance) const {
+	if (!executed || slot < 0 || unsigned(slot) >= sweepCount || !sweepResults[slot].hasBlock) {
+		return false;
+	}
+	distance = sweepResults[slot].block.distance;
+	return true;
+}
+
+void SceneQueryBatch::benchmark(physx::PxPhysics& physics) {
+	int enemyCounts[] = { 100, 1000 };
+	std::cout << "Scene query benchmark, one ground ray and one attack sweep per enemy, ms per step" << std::endl;
+	std::cout << std::setw(8) << "enemies" << std::setw(12) << "individual" << std::setw(10) << "batched" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	for (int enemyCount : enemyCounts) {
+		std::cout << std::setw(8) << enemyCount << std::setw(12) << runQueries(physics, enemyCount, false)
+			<< std::setw(10) << runQueries(physics, enemyCount, true) << std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+}
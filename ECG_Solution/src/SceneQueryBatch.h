@@ -0,0 +1,60 @@
+#pragma once
+
+#include <PxPhysicsAPI.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+/*!
+ * Collects the raycasts and sweeps of one simulation step and runs all of them in a single PxBatchQuery.
+ * Every add call returns a slot, the results are read by that slot after execute() until the next clear().
+ * The result buffers are allocated once with the capacity, queries beyond it are refused.
+ * Only blocking hits are reported, by default against static actors, so the controllers never hit themselves.
+ */
+class SceneQueryBatch {
+private:
+	physx::PxBatchQuery* batch;
+	std::vector<physx::PxRaycastQueryResult> raycastResults;
+	std::vector<physx::PxSweepQueryResult> sweepResults;
+	unsigned int raycastCount;
+	unsigned int sweepCount;
+	bool executed;
+
+public:
+	SceneQueryBatch(physx::PxScene* scene, unsigned int maxRaycasts, unsigned int maxSweeps);
+	~SceneQueryBatch();
+
+	/*!
+	 * Forgets the queries and results of the last step
+	 */
+	void clear();
+
+	/*!
+	 * @return slot of the ray, -1 if the batch is full or the ray is empty
+	 */
+	int addRaycast(const glm::vec3& origin, const glm::vec3& direction, float distance,
+		const physx::PxQueryFilterData& filter = physx::PxQueryFilterData(physx::PxQueryFlag::eSTATIC));
+
+	/*!
+	 * @return slot of the sweep, -1 if the batch is full or the sweep is empty
+	 */
+	int addSweep(const physx::PxGeometry& geometry, const glm::vec3& origin, const glm::vec3& direction, float distance,
+		const physx::PxQueryFilterData& filter = physx::PxQueryFilterData(physx::PxQueryFlag::eSTATIC));
+
+	/*!
+	 * Runs every query added since clear() on the calling thread
+	 */
+	void execute();
+
+	/*!
+	 * @param distance: set to the distance of the hit
+	 * @return false for no hit, a refused slot or before execute()
+	 */
+	bool getRaycastHit(int slot, float& distance) const;
+	bool getSweepHit(int slot, float& distance) const;
+
+	/*!
+	 * Prints the time of the ground probes and attack sweeps of 100 and 1000 enemies, once as individual scene
+	 * queries and once as one batch
+	 */
+	static void benchmark(physx::PxPhysics& physics);
+};
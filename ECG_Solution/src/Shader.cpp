@@ -0,0 +1,140 @@
+/*
+* Copyright 2017 Vienna University of Technology.
+* Institute of Computer Graphics and Algorithms.
+* This file is part of the ECG Lab Framework and must not be redistributed.
+*/
+#include "Shader.h"
+#include "ProgramCache.h"
+
+namespace {
+	// used by the default constructor
+	const char* colorVertexShader =
+		"#version 430 core\n"
+		"layout(location = 0) in vec4 position;\n"
+		"uniform mat4 modelMatrix;\n"
+		"uniform mat4 viewProjMatrix;\n"
+		"void main() { gl_Position = viewProjMatrix * modelMatrix * position; }\n";
+	const char* colorFragmentShader =
+		"#version 430 core\n"
+		"uniform vec3 materialColor;\n"
+		"out vec4 color;\n"
+		"void main() { color = vec4(materialColor, 1.0); }\n";
+}
+
+Shader::Shader()
+	: _useFileAsSource(false) {
+	_handle = loadShaders();
+}
+
+Shader::Shader(std::string vs, std::string fs)
+	: _vs(vs), _fs(fs), _useFileAsSource(true) {
+	_handle = loadShaders();
+}
+
+Shader::~Shader() {
+}
+
+GLuint Shader::loadShaders() {
+	std::vector<ShaderStage> stages;
+	if (_useFileAsSource) {
+		stages.push_back(ShaderStage::fromFile(GL_VERTEX_SHADER, "assets/shader/" + _vs));
+		stages.push_back(ShaderStage::fromFile(GL_FRAGMENT_SHADER, "assets/shader/" + _fs));
+	}
+	else {
+		ShaderStage vertex = { GL_VERTEX_SHADER, "color.vert", colorVertexShader };
+		ShaderStage fragment = { GL_FRAGMENT_SHADER, "color.frag", colorFragmentShader };
+		stages.push_back(vertex);
+		stages.push_back(fragment);
+	}
+	_variants.reset(new ShaderVariants(stages));
+	return _variants->getProgram();
+}
+
+GLint Shader::getUniformLocation(std::string uniform) {
+	return _variants->getUniformLocation(uniform);
+}
+
+void Shader::setKeyword(const std::string& keyword, bool enabled) {
+	_variants->setKeyword(keyword, enabled);
+	_handle = _variants->getProgram();
+}
+
+void Shader::use() const {
+	glUseProgram(_handle);
+}
+
+void Shader::unuse() const {
+	glUseProgram(0);
+}
+
+void Shader::setUniform(std::string uniform, const int i) {
+	setUniform(getUniformLocation(uniform), i);
+}
+
+void Shader::setUniform(GLint location, const int i) {
+	glUniform1i(location, i);
+}
+
+void Shader::setUniform(std::string uniform, const unsigned int i) {
+	setUniform(getUniformLocation(uniform), i);
+}
+
+void Shader::setUniform(GLint location, const unsigned int i) {
+	glUniform1ui(location, i);
+}
+
+void Shader::setUniform(std::string uniform, const float f) {
+	setUniform(getUniformLocation(uniform), f);
+}
+
+void Shader::setUniform(GLint location, const float f) {
+	glUniform1f(location, f);
+}
+
+void Shader::setUniform(std::string uniform, const glm::mat4& mat) {
+	setUniform(getUniformLocation(uniform), mat);
+}
+
+void Shader::setUniform(GLint location, const glm::mat4& mat) {
+	glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
+void Shader::setUniform(std::string uniform, const glm::mat3& mat) {
+	setUniform(getUniformLocation(uniform), mat);
+}
+
+void Shader::setUniform(GLint location, const glm::mat3& mat) {
+	glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
+void Shader::setUniform(std::string uniform, const glm::vec2& vec) {
+	setUniform(getUniformLocation(uniform), vec);
+}
+
+void Shader::setUniform(GLint location, const glm::vec2& vec) {
+	glUniform2fv(location, 1, glm::value_ptr(vec));
+}
+
+void Shader::setUniform(std::string uniform, const glm::vec3& vec) {
+	setUniform(getUniformLocation(uniform), vec);
+}
+
+void Shader::setUniform(GLint location, const glm::vec3& vec) {
+	glUniform3fv(location, 1, glm::value_ptr(vec));
+}
+
+void Shader::setUniform(std::string uniform, const glm::vec4& vec) {
+	setUniform(getUniformLocation(uniform), vec);
+}
+
+void Shader::setUniform(GLint location, const glm::vec4& vec) {
+	glUniform4fv(location, 1, glm::value_ptr(vec));
+}
+
+void Shader::setUniformArr(std::string arr, unsigned int i, std::string prop, const glm::vec3& vec) {
+	setUniform(arr + "[" + std::to_string(i) + "]." + prop, vec);
+}
+
+void Shader::setUniformArr(std::string arr, unsigned int i, std::string prop, const float f) {
+	setUniform(arr + "[" + std::to_string(i) + "]." + prop, f);
+}
@@ -15,6 +15,7 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Utils.h"
+#include "ShaderVariants.h"
 
 class Shader
 {
@@ -23,10 +24,9 @@ protected:
 	std::string _vs, _fs;
 	bool _useFileAsSource;
 
-	std::unordered_map<std::string, GLint> _locations;
+	std::unique_ptr<ShaderVariants> _variants;
 
 	GLuint loadShaders();
-	bool loadShader_(std::string file, GLenum shaderType, GLuint& handle);
 	GLint getUniformLocation(std::string uniform);
 
 public:
@@ -38,6 +38,11 @@ public:
 	void use() const;
 	void unuse() const;
 
+	/*!
+	 * Selects the variant of the shader with the keyword enabled or disabled, see ShaderVariants
+	 */
+	void setKeyword(const std::string& keyword, bool enabled);
+
 	void setUniform(std::string uniform, const int i);
 	void setUniform(GLint location, const int i);
 	void setUniform(std::string uniform, const unsigned int i);
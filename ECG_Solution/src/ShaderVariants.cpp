@@ -0,0 +1,113 @@
+#include "ShaderVariants.h"
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+ShaderVariants::ShaderVariants(const std::vector<ShaderStage>& stages)
+	: stages(stages), selected(0) {
+	for (const ShaderStage& stage : stages) {
+		std::istringstream lines(stage.source);
+		std::string line;
+		while (std::getline(lines, line)) {
+			std::istringstream tokens(line);
+			std::string pragma, name;
+			if (!(tokens >> pragma >> name) || pragma != "#pragma" || name != "keywords") {
+				continue;
+			}
+			while (tokens >> name) {
+				if (std::find(keywords.begin(), keywords.end(), name) == keywords.end()) {
+					keywords.push_back(name);
+				}
+			}
+		}
+	}
+	if (keywords.size() > 32) {
+		std::cout << "Shader " << stages.front().name << " declares more than 32 keywords, the rest is ignored" << std::endl;
+		keywords.resize(32);
+	}
+	select(keywords.empty() ? 0 : 0xFFFFFFFFu >> (32 - keywords.size()));
+}
+
+ShaderVariants::~ShaderVariants() {
+	for (auto& variant : variants) {
+		glDeleteProgram(variant.second.program);
+	}
+}
+
+std::string ShaderVariants::addDefines(const std::string& source, const std::vector<std::string>& defines) {
+	if (defines.empty()) {
+		return source;
+	}
+	std::string lines;
+	for (const std::string& define : defines) {
+		lines += "#define " + define + " 1\n";
+	}
+	// #version has to stay the first line
+	size_t version = source.find("#version");
+	if (version == std::string::npos) {
+		return lines + source;
+	}
+	size_t lineEnd = source.find('\n', version);
+	if (lineEnd == std::string::npos) {
+		return source + "\n" + lines;
+	}
+	return source.substr(0, lineEnd + 1) + lines + source.substr(lineEnd + 1);
+}
+
+void ShaderVariants::select(unsigned int mask) {
+	selected = mask;
+	if (variants.find(mask) != variants.end()) {
+		return;
+	}
+	std::vector<std::string> defines;
+	for (size_t i = 0; i < keywords.size(); i++) {
+		if (mask & (1u << i)) {
+			defines.push_back(keywords[i]);
+		}
+	}
+	std::vector<ShaderStage> variantStages = stages;
+	for (ShaderStage& stage : variantStages) {
+		stage.source = addDefines(stage.source, defines);
+	}
+	variants[mask].program = ProgramCache::create(variantStages);
+}
+
+void ShaderVariants::setKeyword(const std::string& keyword, bool enabled) {
+	for (size_t i = 0; i < keywords.size(); i++) {
+		if (keywords[i] == keyword) {
+			unsigned int mask = enabled ? selected | (1u << i) : selected & ~(1u << i);
+			if (mask != selected) {
+				select(mask);
+			}
+			return;
+		}
+	}
+}
+
+bool ShaderVariants::isEnabled(const std::string& keyword) const {
+	for (size_t i = 0; i < keywords.size(); i++) {
+		if (keywords[i] == keyword) {
+			return (selected & (1u << i)) != 0;
+		}
+	}
+	return false;
+}
+
+const std::vector<std::string>& ShaderVariants::getKeywords() const {
+	return keywords;
+}
+
+GLuint ShaderVariants::getProgram() const {
+	return variants.at(selected).program;
+}
+
+GLint ShaderVariants::getUniformLocation(const std::string& uniform) {
+	Variant& variant = variants[selected];
+	auto location = variant.locations.find(uniform);
+	if (location != variant.locations.end()) {
+		return location->second;
+	}
+	GLint id = glGetUniformLocation(variant.program, uniform.c_str());
+	variant.locations[uniform] = id;
+	return id;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <GL/glew.h>
+#include "ProgramCache.h"
+
+/*!
+ * Variants of one program that differ only in the keywords they are compiled with.
+ * A shader declares its keywords with "#pragma keywords NAME ..." in any of its stages, every enabled keyword
+ * becomes a #define of the variant, so the code of disabled features is not compiled at all.
+ * Variants are compiled when they are selected for the first time and go through the ProgramCache like every
+ * other program, so each of them is kept on disk.
+ */
+class ShaderVariants {
+private:
+	struct Variant {
+		GLuint program = 0;
+		std::unordered_map<std::string, GLint> locations;
+	};
+
+	std::vector<ShaderStage> stages;
+	std::vector<std::string> keywords;
+	unsigned int selected;		// bit i enables keywords[i]
+	std::unordered_map<unsigned int, Variant> variants;
+
+	void select(unsigned int mask);
+
+public:
+	/*!
+	 * Reads the keywords of the stages and compiles the variant with all of them enabled
+	 */
+	ShaderVariants(const std::vector<ShaderStage>& stages);
+	~ShaderVariants();
+
+	/*!
+	 * Selects the variant with the keyword enabled or disabled, the variant is compiled if it is new.
+	 * Keywords the shader does not declare are ignored, so passes can set their keywords on every shader.
+	 */
+	void setKeyword(const std::string& keyword, bool enabled);
+	bool isEnabled(const std::string& keyword) const;
+	const std::vector<std::string>& getKeywords() const;
+
+	/*!
+	 * @return program of the selected variant
+	 */
+	GLuint getProgram() const;
+
+	/*!
+	 * @return location of the uniform in the selected variant
+	 */
+	GLint getUniformLocation(const std::string& uniform);
+
+	/*!
+	 * @return the source with a #define for every given name after its #version line
+	 */
+	static std::string addDefines(const std::string& source, const std::vector<std::string>& defines);
+};
@@ -24,6 +24,10 @@ glm::mat4 ShadowMap::getLightSpaceMatrix() {
 	return lightSpaceMatrix;
 }
 
+unsigned int ShadowMap::getSize() {
+	return SHADOW_MAP_SIZE;
+}
+
 glm::vec3 ShadowMap::getLightPos() {
 	return lightPos;
 }
@@ -30,4 +30,5 @@ public:
 	GLuint getShadowMapID();
 	glm::vec3 getLightPos();
 	glm::mat4 getLightSpaceMatrix();
+	unsigned int getSize();
 };
\ No newline at end of file
@@ -1,19 +1,36 @@
 #include "SimulationCallback.h"
+#include "ActorHandle.h"
 
 void SimulationCallback::onShapeHit(const physx::PxControllerShapeHit& hit) {
 	//std::cout << hit.actor->getName() << std::endl;
 }
 
 void SimulationCallback::onControllerHit(const physx::PxControllersHit& hit) {
-	if (std::strcmp(hit.other->getActor()->getName(), "larry") == 0 && !*dashInProgress) {
-		*hitDetection = true;
+	const physx::PxActor* self = hit.controller->getActor();
+	const physx::PxActor* other = hit.other->getActor();
+	HitEvent event;
+	if (ActorHandle::getKind(self) == ActorHandle::Kind::Enemy && ActorHandle::getKind(other) == ActorHandle::Kind::Player) {
+		event.enemy = ActorHandle::getIndex(self);
+		event.playerMoved = false;
 	}
-	//else if (std::strcmp(hit.other->getActor()->getName(), "larry") == 0 && *dashInProgress) {
-	//	*enemyDetection = getIntFromCString(hit.controller->getActor()->getName());
-	//}
-	*enemyDetection = getIntFromCString(hit.controller->getActor()->getName());
+	else if (ActorHandle::getKind(self) == ActorHandle::Kind::Player && ActorHandle::getKind(other) == ActorHandle::Kind::Enemy) {
+		event.enemy = ActorHandle::getIndex(other);
+		event.playerMoved = true;
+	}
+	else {
+		// enemies pushing each other
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	events.push_back(event);
 }
 
 void SimulationCallback::onObstacleHit(const physx::PxControllerObstacleHit& hit) {
 
-}
\ No newline at end of file
+}
+
+void SimulationCallback::takeEvents(std::vector<HitEvent>& hits) {
+	hits.clear();
+	std::lock_guard<std::mutex> lock(mutex);
+	hits.swap(events);
+}
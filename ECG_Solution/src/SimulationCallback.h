@@ -2,20 +2,33 @@
 
 #include <PxPhysicsAPI.h>
 #include <iostream>
+#include <mutex>
+#include <vector>
 #include "Utils.h"
 
+/*!
+ * The player and an enemy touched, no matter which of them moved
+ */
+struct HitEvent {
+	unsigned int enemy;		// index in Scene::enemies
+	bool playerMoved;
+};
+
+/*!
+ * Collects the hits between the player and the enemies while the controllers move.
+ * Hits are only queued, the gameplay takes all of them once per step, so no hit is lost when several enemies
+ * touch the player in the same step. The queue is locked, the callback may come from any thread.
+ */
 class SimulationCallback : public physx::PxUserControllerHitReport {
 	
 private:
 
-	bool* hitDetection;
-	int* enemyDetection;
-	bool* dashInProgress;
+	std::mutex mutex;
+	std::vector<HitEvent> events;
 
 public:
 
-	SimulationCallback(bool* _hitDetection, int* _enemyDetection, bool* _dashInProgress)
-		: hitDetection(_hitDetection), enemyDetection(_enemyDetection), dashInProgress(_dashInProgress) {
+	SimulationCallback() {
 	}
 	~SimulationCallback() {
 	}
@@ -23,4 +36,9 @@ public:
 	void onShapeHit(const physx::PxControllerShapeHit& hit);
 	void onControllerHit(const physx::PxControllersHit& hit);
 	void onObstacleHit(const physx::PxControllerObstacleHit& hit);
-};
\ No newline at end of file
+
+	/*!
+	 * Moves the hits queued since the last call into hits, which is cleared first
+	 */
+	void takeEvents(std::vector<HitEvent>& hits);
+};
@@ -1,4 +1,6 @@
 #include "Skybox.h"
+#include "../Compression/DDSFile.h"
+#include "../Streaming/AsyncTextureLoader.h"
 
 Skybox::Skybox(Shader* shader) {
     this->shader = shader;
@@ -52,9 +54,36 @@ void Skybox::initBuffer() {
 }
 
 void Skybox::loadCubemap() {
+	if (AsyncTextureLoader::getInstance() != nullptr) {
+		textureID = AsyncTextureLoader::getInstance()->loadCubemap(std::vector<std::string>(textureFaces, textureFaces + 6), GL_RGB);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		return;
+	}
+
 	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
+    // faces that were converted to DDS bring their own mip chain, they are only used if all six exist
+    CompressedImage compressedFaces[6];
+    bool compressed = true;
+    for (unsigned int i = 0; i < 6 && compressed; i++) {
+        compressed = readDDS(getCompressedPath(textureFaces[i]), compressedFaces[i]);
+    }
+    if (compressed) {
+        for (unsigned int i = 0; i < 6; i++) {
+            uploadCompressedImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, compressedFaces[i]);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, GLint(compressedFaces[0].levels.size()) - 1);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        return;
+    }
+
     int width, height, nrChannels;
     unsigned char* data;
     for (unsigned int i = 0; i < 6; i++)
@@ -0,0 +1,306 @@
+#include "AsyncTextureLoader.h"
+#include <iostream>
+#include <cstring>
+#include <chrono>
+#include <glm/glm.hpp>
+#include "../stb_image.h"
+#include "../FileSystem/FileSystem.h"
+
+AsyncTextureLoader* AsyncTextureLoader::instance = nullptr;
+
+AsyncTextureLoader::AsyncTextureLoader(ThreadPool& pool, size_t ringSize, size_t bytesPerUpdate)
+	: pool(pool), ring(ringSize), bytesPerUpdate(bytesPerUpdate), pendingCount(0) {
+	instance = this;
+}
+
+AsyncTextureLoader::~AsyncTextureLoader() {
+	// the jobs write into this loader, so they have to be done before it goes away
+	for (std::future<void>& job : jobs) {
+		job.wait();
+	}
+	if (instance == this) {
+		instance = nullptr;
+	}
+}
+
+AsyncTextureLoader* AsyncTextureLoader::getInstance() {
+	return instance;
+}
+
+GLuint AsyncTextureLoader::createFallback(GLenum target, GLenum internalFormat) {
+	const unsigned char fallback[4] = { 128, 128, 128, 255 };
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(target, texture);
+	if (target == GL_TEXTURE_CUBE_MAP) {
+		for (int face = 0; face < 6; face++) {
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, internalFormat, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, fallback);
+		}
+	}
+	else {
+		glTexImage2D(target, 0, internalFormat, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, fallback);
+	}
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	textures[texture] = TextureInfo();
+	return texture;
+}
+
+GLuint AsyncTextureLoader::load2D(const std::string& path, GLenum internalFormat, ImageOrigin origin, bool mipmaps) {
+	std::unique_ptr<Request> request(new Request());
+	request->target = GL_TEXTURE_2D;
+	request->internalFormat = internalFormat;
+	request->origin = origin;
+	request->mipmaps = mipmaps;
+	request->paths.push_back(path);
+	request->texture = createFallback(request->target, internalFormat);
+
+	GLuint texture = request->texture;
+	enqueue(std::move(request));
+	return texture;
+}
+
+GLuint AsyncTextureLoader::loadCubemap(const std::vector<std::string>& faces, GLenum internalFormat) {
+	std::unique_ptr<Request> request(new Request());
+	request->target = GL_TEXTURE_CUBE_MAP;
+	request->internalFormat = internalFormat;
+	request->mipmaps = false;
+	request->paths = faces;
+	request->texture = createFallback(request->target, internalFormat);
+
+	GLuint texture = request->texture;
+	enqueue(std::move(request));
+	return texture;
+}
+
+void AsyncTextureLoader::enqueue(std::unique_ptr<Request> request) {
+	pendingCount++;
+	// std::function needs a copyable job, the job owns the request until it is handed back
+	Request* job = request.release();
+	jobs.push_back(pool.submit([this, job] {
+		std::unique_ptr<Request> finished(job);
+		decode(*finished);
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(std::move(finished));
+	}));
+}
+
+void AsyncTextureLoader::decode(Request& request) {
+	request.images.resize(request.paths.size());
+	for (size_t i = 0; i < request.paths.size(); i++) {
+		const std::string& path = request.paths[i];
+		DecodedImage& image = request.images[i];
+
+		// the block compressed version is stored top-down, bottom-up users get the blocks flipped
+		if (readDDS(getCompressedPath(path), image.compressedImage)
+			&& (request.origin == ImageOrigin::TopDown || flipCompressedImage(image.compressedImage))) {
+			image.compressed = true;
+			image.width = image.compressedImage.width;
+			image.height = image.compressedImage.height;
+			image.valid = true;
+			continue;
+		}
+		image.compressedImage = CompressedImage();
+
+		int channels;
+		FileData file = FileSystem::readFile(path);
+		unsigned char* data = file.isValid() ? stbi_load_from_memory(file.bytesData(), int(file.size()), &image.width, &image.height, &channels, 4) : nullptr;
+		if (data == nullptr) {
+			std::cout << "Failed to load image " << path << std::endl;
+			continue;
+		}
+		size_t rowSize = size_t(image.width) * 4;
+		image.pixels.resize(rowSize * image.height);
+		for (int y = 0; y < image.height; y++) {
+			int sourceRow = request.origin == ImageOrigin::TopDown ? y : image.height - 1 - y;
+			std::memcpy(&image.pixels[y * rowSize], data + sourceRow * rowSize, rowSize);
+		}
+		stbi_image_free(data);
+		image.valid = true;
+	}
+}
+
+size_t AsyncTextureLoader::getUploadSize(const Request& request) {
+	size_t size = 0;
+	for (const DecodedImage& image : request.images) {
+		if (image.compressed) {
+			for (const std::vector<unsigned char>& level : image.compressedImage.levels) {
+				size += level.size();
+			}
+		}
+		else {
+			size += image.pixels.size();
+		}
+	}
+	return size;
+}
+
+bool AsyncTextureLoader::upload(Request& request, bool wait) {
+	auto info = textures.find(request.texture);
+	if (info == textures.end()) {
+		return true;
+	}
+	for (const DecodedImage& image : request.images) {
+		if (!image.valid || image.compressed != request.images[0].compressed) {
+			// keeps the fallback, a cube map with a missing face would not be complete
+			return true;
+		}
+	}
+
+	// small textures go through the ring, anything larger than the whole ring is uploaded from client memory
+	size_t size = getUploadSize(request);
+	size_t offset = 0;
+	unsigned char* pointer = nullptr;
+	bool buffered = ring.allocate(size, offset, pointer, wait);
+	if (!buffered && size <= ring.getCapacity()) {
+		return false;
+	}
+
+	std::vector<const unsigned char*> sources;
+	size_t cursor = 0;
+	for (const DecodedImage& image : request.images) {
+		std::vector<const std::vector<unsigned char>*> levels;
+		if (image.compressed) {
+			for (const std::vector<unsigned char>& level : image.compressedImage.levels) {
+				levels.push_back(&level);
+			}
+		}
+		else {
+			levels.push_back(&image.pixels);
+		}
+		for (const std::vector<unsigned char>* level : levels) {
+			if (buffered) {
+				std::memcpy(pointer + cursor, level->data(), level->size());
+				// with a bound unpack buffer the pointer argument is an offset into the buffer
+				sources.push_back(reinterpret_cast<const unsigned char*>(offset + cursor));
+			}
+			else {
+				sources.push_back(level->data());
+			}
+			cursor += level->size();
+		}
+	}
+	if (buffered) {
+		ring.commit();
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.getBuffer());
+	}
+
+	glBindTexture(request.target, request.texture);
+	size_t source = 0;
+	int levelCount = 1;
+	for (size_t face = 0; face < request.images.size(); face++) {
+		const DecodedImage& image = request.images[face];
+		GLenum imageTarget = request.target == GL_TEXTURE_CUBE_MAP ? GLenum(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face) : request.target;
+		if (image.compressed) {
+			const CompressedImage& compressed = image.compressedImage;
+			GLenum format = getCompressedFormat(compressed.format);
+			int width = compressed.width;
+			int height = compressed.height;
+			levelCount = int(compressed.levels.size());
+			for (int level = 0; level < levelCount; level++) {
+				glCompressedTexImage2D(imageTarget, level, format, width, height, 0, GLsizei(compressed.levels[level].size()), sources[source++]);
+				width = glm::max(1, width / 2);
+				height = glm::max(1, height / 2);
+			}
+		}
+		else {
+			glTexImage2D(imageTarget, 0, request.internalFormat, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, sources[source++]);
+		}
+	}
+	if (buffered) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	if (request.images[0].compressed) {
+		glTexParameteri(request.target, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+		glTexParameteri(request.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	}
+	else if (request.mipmaps) {
+		glGenerateMipmap(request.target);
+		glTexParameteri(request.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	}
+
+	info->second.width = request.images[0].width;
+	info->second.height = request.images[0].height;
+	info->second.ready = true;
+	return true;
+}
+
+void AsyncTextureLoader::update() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!decoded.empty()) {
+			waiting.push_back(std::move(decoded.front()));
+			decoded.pop_front();
+		}
+	}
+
+	size_t uploaded = 0;
+	while (!waiting.empty() && (uploaded == 0 || uploaded < bytesPerUpdate)) {
+		size_t size = getUploadSize(*waiting.front());
+		if (!upload(*waiting.front(), false)) {
+			break;
+		}
+		waiting.pop_front();
+		pendingCount--;
+		uploaded += size;
+	}
+	ring.fence();
+
+	// forget the jobs that are done
+	for (size_t i = 0; i < jobs.size();) {
+		if (jobs[i].wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			jobs[i] = std::move(jobs.back());
+			jobs.pop_back();
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+void AsyncTextureLoader::finish() {
+	for (std::future<void>& job : jobs) {
+		job.wait();
+	}
+	jobs.clear();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!decoded.empty()) {
+			waiting.push_back(std::move(decoded.front()));
+			decoded.pop_front();
+		}
+	}
+	while (!waiting.empty()) {
+		upload(*waiting.front(), true);
+		// fenced one by one, so the next blocking allocation can wait for this upload
+		ring.fence();
+		waiting.pop_front();
+		pendingCount--;
+	}
+}
+
+bool AsyncTextureLoader::isReady(GLuint texture) const {
+	auto info = textures.find(texture);
+	return info != textures.end() && info->second.ready;
+}
+
+bool AsyncTextureLoader::getSize(GLuint texture, int& width, int& height) const {
+	auto info = textures.find(texture);
+	if (info == textures.end()) {
+		return false;
+	}
+	width = info->second.width;
+	height = info->second.height;
+	return true;
+}
+
+void AsyncTextureLoader::release(GLuint texture) {
+	textures.erase(texture);
+}
+
+int AsyncTextureLoader::getPendingCount() const {
+	return pendingCount;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <GL/glew.h>
+#include "UploadRing.h"
+#include "../Compression/DDSFile.h"
+#include "../Jobs/ThreadPool.h"
+
+/*!
+ * Row order the texture expects, stb delivers top-down rows, FreeImage bottom-up rows
+ */
+enum class ImageOrigin {
+	TopDown,
+	BottomUp
+};
+
+/*!
+ * Loads textures in the background. Images (or their DDS versions) are decoded on the thread pool,
+ * the GL thread only copies finished images into a ring of pixel buffer memory and issues the uploads.
+ * Every texture gets its GL name immediately and shows a 1x1 fallback texel until its image is uploaded,
+ * so it can be bound by materials and the GUI right away.
+ * The loader that was created last is used by Texture, loadTextureFromFile and Skybox.
+ */
+class AsyncTextureLoader {
+private:
+	struct DecodedImage {
+		bool valid = false;
+		bool compressed = false;
+		CompressedImage compressedImage;
+		int width = 0;
+		int height = 0;
+		std::vector<unsigned char> pixels;	// RGBA8
+	};
+
+	struct Request {
+		GLuint texture = 0;
+		GLenum target = GL_TEXTURE_2D;
+		GLenum internalFormat = GL_RGBA;
+		ImageOrigin origin = ImageOrigin::TopDown;
+		bool mipmaps = true;
+		std::vector<std::string> paths;
+		std::vector<DecodedImage> images;
+	};
+
+	struct TextureInfo {
+		int width = 1;
+		int height = 1;
+		bool ready = false;
+	};
+
+	static AsyncTextureLoader* instance;
+
+	ThreadPool& pool;
+	UploadRing ring;
+	size_t bytesPerUpdate;
+
+	std::mutex mutex;
+	std::deque<std::unique_ptr<Request>> decoded;	// filled by the workers
+	std::deque<std::unique_ptr<Request>> waiting;	// decoded, but not uploaded yet (GL thread only)
+	std::vector<std::future<void>> jobs;
+	std::unordered_map<GLuint, TextureInfo> textures;
+	int pendingCount;
+
+	GLuint createFallback(GLenum target, GLenum internalFormat);
+	void enqueue(std::unique_ptr<Request> request);
+	static void decode(Request& request);
+	static size_t getUploadSize(const Request& request);
+	bool upload(Request& request, bool wait);
+
+public:
+	/*!
+	 * @param pool: images are decoded on this pool
+	 * @param ringSize: bytes of pixel buffer memory shared by all uploads
+	 * @param bytesPerUpdate: upload budget of one update() call, at least one texture is uploaded
+	 */
+	AsyncTextureLoader(ThreadPool& pool, size_t ringSize, size_t bytesPerUpdate);
+	~AsyncTextureLoader();
+
+	/*!
+	 * @return the loader used by the texture loading functions, nullptr if there is none
+	 */
+	static AsyncTextureLoader* getInstance();
+
+	/*!
+	 * Starts loading a 2D texture, the DDS version next to the path is preferred
+	 * @param internalFormat: GL_RGB or GL_RGBA for uncompressed images
+	 * @param origin: row order the texture coordinates of the users expect
+	 * @param mipmaps: generate mipmaps for uncompressed images (DDS files bring their own)
+	 * @return the texture name, valid immediately
+	 */
+	GLuint load2D(const std::string& path, GLenum internalFormat, ImageOrigin origin, bool mipmaps);
+
+	/*!
+	 * Starts loading a cube map from six faces (+x, -x, +y, -y, +z, -z)
+	 * @return the texture name, valid immediately
+	 */
+	GLuint loadCubemap(const std::vector<std::string>& faces, GLenum internalFormat);
+
+	/*!
+	 * Uploads finished images within the budget, called once per frame on the GL thread
+	 */
+	void update();
+
+	/*!
+	 * Blocks until every requested texture is uploaded
+	 */
+	void finish();
+
+	/*!
+	 * @return if the image of the texture is uploaded
+	 */
+	bool isReady(GLuint texture) const;
+
+	/*!
+	 * Size of the texture, 1x1 while the fallback is shown
+	 * @return false if the texture was not created by this loader
+	 */
+	bool getSize(GLuint texture, int& width, int& height) const;
+
+	/*!
+	 * Forgets a texture that is about to be deleted, a pending image is dropped instead of uploaded
+	 */
+	void release(GLuint texture);
+
+	/*!
+	 * @return number of textures that are not uploaded yet
+	 */
+	int getPendingCount() const;
+};
@@ -0,0 +1,323 @@
+#include "TextureStreamer.h"
+#include <iostream>
+#include <algorithm>
+#include <climits>
+#include <chrono>
+
+TextureStreamer* TextureStreamer::instance = nullptr;
+
+TextureStreamer::TextureStreamer(ThreadPool& pool, size_t budget, size_t bytesPerUpdate, int tailSize)
+	: pool(pool), ring(bytesPerUpdate * 2), budget(budget), bytesPerUpdate(bytesPerUpdate), tailSize(tailSize),
+	keepFrames(60), cameraPosition(0.0f), pixelScale(1.0f), frame(0) {
+	instance = this;
+}
+
+TextureStreamer::~TextureStreamer() {
+	for (std::future<void>& job : jobs) {
+		job.wait();
+	}
+	for (StreamedTexture& texture : textures) {
+		glDeleteTextures(1, &texture.texture);
+	}
+	if (instance == this) {
+		instance = nullptr;
+	}
+}
+
+TextureStreamer* TextureStreamer::getInstance() {
+	return instance;
+}
+
+int TextureStreamer::add(const std::string& sourcePath, ImageOrigin origin) {
+	std::string path = getCompressedPath(sourcePath);
+	auto existing = handles.find(path);
+	if (existing != handles.end()) {
+		return existing->second;
+	}
+
+	// the header tells the size, then only the tail levels are read
+	CompressedImage image;
+	if (!readDDS(path, image, INT_MAX)) {
+		return -1;
+	}
+	StreamedTexture texture;
+	texture.path = path;
+	texture.origin = origin;
+	texture.format = image.format;
+	texture.width = image.width;
+	texture.height = image.height;
+	texture.levelCount = int(image.levels.size());
+	texture.tailLevel = texture.levelCount - 1;
+	for (int level = 0; level < texture.levelCount; level++) {
+		if (glm::max(image.width >> level, image.height >> level) <= tailSize) {
+			texture.tailLevel = level;
+			break;
+		}
+	}
+	texture.bytesFrom.assign(texture.levelCount + 1, 0);
+	for (int level = texture.levelCount - 1; level >= 0; level--) {
+		texture.bytesFrom[level] = texture.bytesFrom[level + 1] + getLevelSize(image, level);
+	}
+
+	if (!readDDS(path, image, texture.tailLevel) || (origin == ImageOrigin::BottomUp && !flipCompressedImage(image))) {
+		return -1;
+	}
+
+	// immutable storage for the tail only, the finer levels are added by reallocations
+	GLenum format = getCompressedFormat(texture.format);
+	glGenTextures(1, &texture.texture);
+	glBindTexture(GL_TEXTURE_2D, texture.texture);
+	glTexStorage2D(GL_TEXTURE_2D, texture.levelCount - texture.tailLevel, format,
+		glm::max(1, texture.width >> texture.tailLevel), glm::max(1, texture.height >> texture.tailLevel));
+	for (int level = texture.tailLevel; level < texture.levelCount; level++) {
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, level - texture.tailLevel, 0, 0,
+			glm::max(1, texture.width >> level), glm::max(1, texture.height >> level), format,
+			GLsizei(image.levels[level].size()), image.levels[level].data());
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	texture.allocatedLevel = texture.tailLevel;
+	texture.residentLevel = texture.tailLevel;
+	texture.wantedLevel = texture.tailLevel;
+	texture.targetLevel = texture.tailLevel;
+	texture.frameLevel = INT_MAX;
+
+	int handle = int(textures.size());
+	textures.push_back(std::move(texture));
+	handles[path] = handle;
+	return handle;
+}
+
+GLuint TextureStreamer::getTexture(int handle) const {
+	return textures[handle].texture;
+}
+
+float TextureStreamer::getMinLod(int handle) const {
+	const StreamedTexture& texture = textures[handle];
+	return float(texture.residentLevel - texture.allocatedLevel) + texture.fade;
+}
+
+void TextureStreamer::beginFrame(const glm::vec3& cameraPosition, float fovY, int viewportHeight) {
+	this->cameraPosition = cameraPosition;
+	pixelScale = float(viewportHeight) / (2.0f * glm::tan(glm::radians(fovY) * 0.5f));
+}
+
+void TextureStreamer::request(int handle, const glm::vec3& center, float radius) {
+	StreamedTexture& texture = textures[handle];
+
+	// projected diameter of the bounding sphere, the texture is assumed to be spread once over the object
+	float distance = glm::max(glm::distance(cameraPosition, center) - radius, 0.01f);
+	float pixels = glm::max(2.0f * radius * pixelScale / distance, 1.0f);
+	int level = int(glm::floor(glm::log2(float(glm::max(texture.width, texture.height)) / pixels)));
+	level = glm::clamp(level, 0, texture.tailLevel);
+
+	texture.frameLevel = glm::min(texture.frameLevel, level);
+	texture.frameSize = glm::max(texture.frameSize, pixels);
+}
+
+void TextureStreamer::assignBudget() {
+	for (StreamedTexture& texture : textures) {
+		if (texture.frameLevel != INT_MAX) {
+			texture.wantedLevel = texture.frameLevel;
+			texture.priority = texture.frameSize;
+			texture.lastSeenFrame = frame;
+		}
+		else if (frame - texture.lastSeenFrame > keepFrames) {
+			// not drawn for a while: only the tail stays
+			texture.wantedLevel = texture.tailLevel;
+			texture.priority = 0.0f;
+		}
+		texture.frameLevel = INT_MAX;
+		texture.frameSize = 0.0f;
+	}
+
+	// the tails are always resident, the rest of the budget goes to the largest textures on screen first
+	std::vector<int> order(textures.size());
+	size_t total = 0;
+	for (size_t i = 0; i < textures.size(); i++) {
+		order[i] = int(i);
+		total += textures[i].bytesFrom[textures[i].tailLevel];
+	}
+	std::sort(order.begin(), order.end(), [this](int a, int b) { return textures[a].priority > textures[b].priority; });
+	for (int handle : order) {
+		StreamedTexture& texture = textures[handle];
+		size_t tailBytes = texture.bytesFrom[texture.tailLevel];
+		int level = texture.wantedLevel;
+		while (level < texture.tailLevel && total + texture.bytesFrom[level] - tailBytes > budget) {
+			level++;
+		}
+		texture.targetLevel = level;
+		total += texture.bytesFrom[level] - tailBytes;
+	}
+}
+
+void TextureStreamer::reallocate(StreamedTexture& texture, int level) {
+	GLenum format = getCompressedFormat(texture.format);
+	int firstResident = glm::max(level, texture.residentLevel);
+
+	GLuint reallocated;
+	glGenTextures(1, &reallocated);
+	glBindTexture(GL_TEXTURE_2D, reallocated);
+	glTexStorage2D(GL_TEXTURE_2D, texture.levelCount - level, format,
+		glm::max(1, texture.width >> level), glm::max(1, texture.height >> level));
+
+	// the levels both have in common never leave the GPU
+	for (int i = firstResident; i < texture.levelCount; i++) {
+		glCopyImageSubData(texture.texture, GL_TEXTURE_2D, i - texture.allocatedLevel, 0, 0, 0,
+			reallocated, GL_TEXTURE_2D, i - level, 0, 0, 0,
+			glm::max(1, texture.width >> i), glm::max(1, texture.height >> i), 1);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glDeleteTextures(1, &texture.texture);
+	texture.texture = reallocated;
+	texture.allocatedLevel = level;
+	texture.residentLevel = firstResident;
+}
+
+void TextureStreamer::startLoad(int handle) {
+	StreamedTexture& texture = textures[handle];
+	texture.loading = true;
+	std::string path = texture.path;
+	ImageOrigin origin = texture.origin;
+	int firstLevel = texture.targetLevel;
+
+	jobs.push_back(pool.submit([this, handle, path, origin, firstLevel] {
+		LoadResult result;
+		result.handle = handle;
+		if (!readDDS(path, result.image, firstLevel) || (origin == ImageOrigin::BottomUp && !flipCompressedImage(result.image))) {
+			result.image.levels.clear();
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		loadResults.push_back(std::move(result));
+	}));
+}
+
+bool TextureStreamer::uploadLevel(StreamedTexture& texture) {
+	int level = texture.residentLevel - 1;
+	const std::vector<unsigned char>& data = texture.loaded.levels[level];
+
+	// levels larger than the whole ring are uploaded from client memory
+	size_t offset;
+	unsigned char* pointer;
+	bool buffered = ring.allocate(data.size(), offset, pointer, false);
+	if (!buffered && data.size() <= ring.getCapacity()) {
+		return false;
+	}
+	const void* source = data.data();
+	if (buffered) {
+		std::copy(data.begin(), data.end(), pointer);
+		ring.commit();
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.getBuffer());
+		source = reinterpret_cast<const void*>(offset);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, texture.texture);
+	glCompressedTexSubImage2D(GL_TEXTURE_2D, level - texture.allocatedLevel, 0, 0,
+		glm::max(1, texture.width >> level), glm::max(1, texture.height >> level), getCompressedFormat(texture.format),
+		GLsizei(data.size()), source);
+	if (buffered) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	// the new level may be sampled from now on, the clamp starts one level coarser and fades to it
+	texture.residentLevel = level;
+	texture.fade = glm::min(texture.fade + 1.0f, float(texture.levelCount));
+	return true;
+}
+
+void TextureStreamer::update() {
+	frame++;
+	assignBudget();
+
+	// drop levels that are finer than the budget or the screen size allows
+	for (StreamedTexture& texture : textures) {
+		if (texture.targetLevel > texture.allocatedLevel) {
+			reallocate(texture, texture.targetLevel);
+			if (texture.residentLevel == texture.allocatedLevel) {
+				texture.loaded = CompressedImage();
+			}
+		}
+	}
+
+	// read levels that are missing
+	for (size_t i = 0; i < textures.size(); i++) {
+		StreamedTexture& texture = textures[i];
+		if (!texture.loading && texture.loaded.levels.empty() && texture.targetLevel < texture.residentLevel) {
+			startLoad(int(i));
+		}
+	}
+
+	// storage for finished reads, the levels themselves are uploaded below
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!loadResults.empty()) {
+			LoadResult& result = loadResults.front();
+			StreamedTexture& texture = textures[result.handle];
+			texture.loading = false;
+			int firstLoaded = 0;
+			while (firstLoaded < int(result.image.levels.size()) && result.image.levels[firstLoaded].empty()) {
+				firstLoaded++;
+			}
+			// the target may have become coarser while the levels were read
+			int level = glm::max(firstLoaded, texture.targetLevel);
+			if (int(result.image.levels.size()) == texture.levelCount && level < texture.residentLevel) {
+				texture.loaded = std::move(result.image);
+				reallocate(texture, level);
+			}
+			loadResults.pop_front();
+		}
+	}
+
+	// finest level last, so the texture is usable after every single upload
+	std::vector<StreamedTexture*> uploads;
+	for (StreamedTexture& texture : textures) {
+		if (!texture.loaded.levels.empty() && texture.residentLevel > texture.allocatedLevel) {
+			uploads.push_back(&texture);
+		}
+	}
+	std::sort(uploads.begin(), uploads.end(), [](const StreamedTexture* a, const StreamedTexture* b) { return a->priority > b->priority; });
+	size_t uploaded = 0;
+	for (StreamedTexture* texture : uploads) {
+		while (texture->residentLevel > texture->allocatedLevel && uploaded < bytesPerUpdate) {
+			size_t size = texture->loaded.levels[texture->residentLevel - 1].size();
+			if (!uploadLevel(*texture)) {
+				break;
+			}
+			uploaded += size;
+		}
+		if (texture->residentLevel == texture->allocatedLevel) {
+			texture->loaded = CompressedImage();
+		}
+	}
+	ring.fence();
+
+	for (StreamedTexture& texture : textures) {
+		texture.fade = glm::max(texture.fade - 0.05f, 0.0f);
+	}
+
+	for (size_t i = 0; i < jobs.size();) {
+		if (jobs[i].wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			jobs[i] = std::move(jobs.back());
+			jobs.pop_back();
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+size_t TextureStreamer::getResidentBytes() const {
+	size_t total = 0;
+	for (const StreamedTexture& texture : textures) {
+		total += texture.bytesFrom[texture.allocatedLevel];
+	}
+	return total;
+}
+
+size_t TextureStreamer::getBudget() const {
+	return budget;
+}
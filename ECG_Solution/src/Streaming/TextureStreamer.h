@@ -0,0 +1,142 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "UploadRing.h"
+#include "AsyncTextureLoader.h"
+#include "../Compression/DDSFile.h"
+#include "../Jobs/ThreadPool.h"
+
+/*!
+ * Keeps only the mip levels of the DDS textures resident that are needed for their size on screen.
+ * Every draw reports the bounding sphere of its object, which gives the finest level the texture needs this frame.
+ * Levels are read from disk on the thread pool and uploaded finest last; levels that are not needed anymore are dropped.
+ * The finest levels that fit into the VRAM budget go to the textures with the largest size on screen.
+ *
+ * A texture lives in immutable storage that only covers the allocated levels, it is reallocated when levels are
+ * streamed in or out and the levels both textures share are copied on the GPU.
+ * The texture parameters are never touched after creation, so bindless handles stay valid: the sampler clamps the
+ * level of detail to getMinLod() instead, which skips levels that are not uploaded yet and fades every new level in.
+ * The GL name changes with every reallocation, so users keep the handle and ask for the current name when binding.
+ */
+class TextureStreamer {
+private:
+	struct StreamedTexture {
+		std::string path;
+		ImageOrigin origin;
+		BlockFormat format;
+		int width, height;
+		int levelCount;
+		int tailLevel;				// this level and all smaller ones are always resident
+		std::vector<size_t> bytesFrom;	// bytes of all levels from the index to the smallest one
+
+		GLuint texture = 0;
+		int allocatedLevel;			// finest level of the storage, level 0 of the GL texture
+		int residentLevel;			// finest level with data
+		int wantedLevel;			// finest level needed on screen
+		int targetLevel;			// wanted level clamped to the budget
+		float priority = 0.0f;		// size on screen in pixels
+		float fade = 0.0f;			// added to the level of detail while a new level fades in
+
+		int frameLevel;				// finest request of the current frame
+		float frameSize = 0.0f;
+		int lastSeenFrame = 0;
+
+		bool loading = false;
+		CompressedImage loaded;		// levels read by the last job, uploaded one by one
+	};
+
+	struct LoadResult {
+		int handle;
+		CompressedImage image;
+	};
+
+	static TextureStreamer* instance;
+
+	ThreadPool& pool;
+	UploadRing ring;
+	size_t budget;
+	size_t bytesPerUpdate;
+	int tailSize;
+	int keepFrames;
+
+	std::vector<StreamedTexture> textures;
+	std::unordered_map<std::string, int> handles;
+
+	glm::vec3 cameraPosition;
+	float pixelScale;
+	int frame;
+
+	std::mutex mutex;
+	std::deque<LoadResult> loadResults;
+	std::vector<std::future<void>> jobs;
+
+	void reallocate(StreamedTexture& texture, int level);
+	void startLoad(int handle);
+	bool uploadLevel(StreamedTexture& texture);
+	void assignBudget();
+
+public:
+	/*!
+	 * @param pool: levels are read on this pool
+	 * @param budget: bytes all streamed textures may use together
+	 * @param bytesPerUpdate: upload budget of one update() call
+	 * @param tailSize: levels of this size and smaller are always resident
+	 */
+	TextureStreamer(ThreadPool& pool, size_t budget, size_t bytesPerUpdate, int tailSize = 64);
+	~TextureStreamer();
+
+	/*!
+	 * @return the streamer used by the materials, nullptr if there is none
+	 */
+	static TextureStreamer* getInstance();
+
+	/*!
+	 * Registers a texture, only its smallest levels are loaded here
+	 * @param sourcePath: path of the source image, the DDS file next to it is streamed
+	 * @param origin: row order the texture coordinates of the users expect
+	 * @return handle of the texture, -1 if there is no usable DDS file
+	 */
+	int add(const std::string& sourcePath, ImageOrigin origin);
+
+	/*!
+	 * @return the current GL name of the texture, it changes when levels are streamed
+	 */
+	GLuint getTexture(int handle) const;
+
+	/*!
+	 * @return the level of detail of the current GL texture sampling has to be clamped to
+	 */
+	float getMinLod(int handle) const;
+
+	/*!
+	 * Sets the camera the following requests are measured against
+	 * @param fovY: vertical field of view in degrees
+	 * @param viewportHeight: height of the viewport in pixels
+	 */
+	void beginFrame(const glm::vec3& cameraPosition, float fovY, int viewportHeight);
+
+	/*!
+	 * Reports that an object with the texture is drawn this frame
+	 * @param center: world space center of the bounding sphere of the object
+	 * @param radius: radius of the bounding sphere
+	 */
+	void request(int handle, const glm::vec3& center, float radius);
+
+	/*!
+	 * Applies the requests of the frame: distributes the budget, drops levels, starts reads and uploads finished levels
+	 */
+	void update();
+
+	/*!
+	 * @return bytes of texture storage that is currently allocated
+	 */
+	size_t getResidentBytes() const;
+	size_t getBudget() const;
+};
@@ -0,0 +1,145 @@
+#include "UploadRing.h"
+#include <iostream>
+
+namespace {
+	const size_t ALIGNMENT = 16;
+}
+
+UploadRing::UploadRing(size_t capacity)
+	: capacity(capacity), mapped(nullptr), mappedRange(false), head(0), hasPending(false) {
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+
+	persistent = GLEW_ARB_buffer_storage || GLEW_VERSION_4_4;
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, capacity, nullptr, flags);
+		mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, capacity, flags));
+		if (mapped == nullptr) {
+			std::cout << "Could not map the texture upload buffer persistently" << std::endl;
+			persistent = false;
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		}
+	}
+	if (!persistent) {
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+UploadRing::~UploadRing() {
+	for (Span& span : spans) {
+		glDeleteSync(span.fence);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	if (persistent || mappedRange) {
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(1, &buffer);
+}
+
+bool UploadRing::overlaps(const Span& span, size_t begin, size_t end) {
+	if (span.wrapped) {
+		return begin < span.end || end > span.begin;
+	}
+	return begin < span.end && span.begin < end;
+}
+
+bool UploadRing::overlapsLive(size_t begin, size_t end) const {
+	if (hasPending && overlaps(pending, begin, end)) {
+		return true;
+	}
+	for (const Span& span : spans) {
+		if (overlaps(span, begin, end)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool UploadRing::retireOldest(bool wait) {
+	if (spans.empty()) {
+		return false;
+	}
+	GLenum status = glClientWaitSync(spans.front().fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? GLuint64(1000000000) : 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+		return false;
+	}
+	glDeleteSync(spans.front().fence);
+	spans.pop_front();
+	return true;
+}
+
+bool UploadRing::allocate(size_t size, size_t& offset, unsigned char*& pointer, bool wait) {
+	if (size > capacity) {
+		return false;
+	}
+
+	// allocations are handed out in order, so the oldest span is always the one in the way
+	size_t begin = (head + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	if (begin + size > capacity) {
+		begin = 0;
+	}
+	while (overlapsLive(begin, begin + size)) {
+		if (!retireOldest(wait)) {
+			return false;
+		}
+	}
+
+	if (!hasPending) {
+		pending = Span();
+		pending.begin = begin;
+		hasPending = true;
+	}
+	else if (begin < pending.end) {
+		pending.wrapped = true;
+	}
+	pending.end = begin + size;
+	head = begin + size;
+
+	offset = begin;
+	if (persistent) {
+		pointer = mapped + begin;
+	}
+	else {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		pointer = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, begin, size,
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+		mappedRange = pointer != nullptr;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	return pointer != nullptr;
+}
+
+void UploadRing::commit() {
+	if (mappedRange) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		mappedRange = false;
+	}
+}
+
+void UploadRing::fence() {
+	if (!hasPending) {
+		return;
+	}
+	pending.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	spans.push_back(pending);
+	hasPending = false;
+}
+
+GLuint UploadRing::getBuffer() const {
+	return buffer;
+}
+
+size_t UploadRing::getCapacity() const {
+	return capacity;
+}
+
+bool UploadRing::isPersistent() const {
+	return persistent;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <deque>
+#include <GL/glew.h>
+
+/*!
+ * Ring buffer of pixel unpack memory for texture uploads.
+ * The buffer is mapped once and stays mapped (GL_ARB_buffer_storage), every batch of uploads
+ * is protected by a fence, so memory is only reused after the GPU has read it.
+ * Without buffer storage every allocation is mapped unsynchronized instead.
+ */
+class UploadRing {
+private:
+	// a used part of the ring, wrapped spans cover [begin, capacity) and [0, end)
+	struct Span {
+		size_t begin = 0;
+		size_t end = 0;
+		bool wrapped = false;
+		GLsync fence = nullptr;
+	};
+
+	GLuint buffer;
+	size_t capacity;
+	unsigned char* mapped;
+	bool persistent;
+	bool mappedRange;
+
+	size_t head;
+	std::deque<Span> spans;
+	// allocations since the last fence
+	Span pending;
+	bool hasPending;
+
+	static bool overlaps(const Span& span, size_t begin, size_t end);
+	bool overlapsLive(size_t begin, size_t end) const;
+	bool retireOldest(bool wait);
+
+public:
+	/*!
+	 * @param capacity: size of the ring in bytes
+	 */
+	UploadRing(size_t capacity);
+	~UploadRing();
+
+	/*!
+	 * Reserves memory for one upload
+	 * @param size: bytes needed
+	 * @param offset: offset in the buffer, used as pointer argument of glTex(Sub)Image while the buffer is bound
+	 * @param pointer: CPU address the pixels are written to
+	 * @param wait: block until the GPU has released enough memory instead of failing
+	 * @return false if there is no free memory right now or the size exceeds the capacity
+	 */
+	bool allocate(size_t size, size_t& offset, unsigned char*& pointer, bool wait);
+
+	/*!
+	 * Makes the written memory visible to GL, has to be called before the upload commands are issued
+	 */
+	void commit();
+
+	/*!
+	 * Inserts a fence after the upload commands of all allocations since the last fence
+	 */
+	void fence();
+
+	GLuint getBuffer() const;
+	size_t getCapacity() const;
+	bool isPersistent() const;
+};
@@ -0,0 +1,275 @@
+#include "HeightField.h"
+#include <iostream>
+#include <cfloat>
+#include <algorithm>
+
+HeightField::HeightField(const char* heightMapPath, float dimension, float scaleY)
+	: HeightField(Image(heightMapPath), dimension, scaleY) {}
+
+HeightField::HeightField(const Image& heightMap, float dimension, float scaleY) {
+	this->dimension = dimension;
+	this->scaleY = scaleY;
+
+	if (heightMap.isValid()) {
+		width = heightMap.getWidth();
+		height = heightMap.getHeight();
+		samples.resize(width * height);
+		for (int z = 0; z < height; z++) {
+			for (int x = 0; x < width; x++) {
+				samples[z * width + x] = float(heightMap.getPixel(x, z)) / 255 * scaleY;
+			}
+		}
+	}
+	else {
+		width = 2;
+		height = 2;
+		samples.assign(width * height, 0.0f);
+	}
+
+	this->cellSizeX = dimension / width;
+	this->cellSizeZ = dimension / height;
+	this->buildPyramid();
+}
+
+HeightField::~HeightField() {}
+
+float HeightField::getDimension() const {
+	return dimension;
+}
+
+float HeightField::getScaleY() const {
+	return scaleY;
+}
+
+glm::ivec2 HeightField::getResolution() const {
+	return glm::ivec2(width, height);
+}
+
+const std::vector<float>& HeightField::getSamples() const {
+	return samples;
+}
+
+void HeightField::buildPyramid() {
+	// level 0: one cell between four neighbouring samples
+	glm::ivec2 size = glm::ivec2(width - 1, height - 1);
+	std::vector<float> level(size.x * size.y);
+	for (int z = 0; z < size.y; z++) {
+		for (int x = 0; x < size.x; x++) {
+			level[z * size.x + x] = glm::max(
+				glm::max(sample(x, z), sample(x + 1, z)),
+				glm::max(sample(x, z + 1), sample(x + 1, z + 1)));
+		}
+	}
+	maxLevels.push_back(level);
+	levelSizes.push_back(size);
+
+	// every further level halves the resolution until a single cell is left
+	while (size.x > 1 || size.y > 1) {
+		glm::ivec2 parentSize = glm::ivec2((size.x + 1) / 2, (size.y + 1) / 2);
+		std::vector<float> parent(parentSize.x * parentSize.y);
+		int child = int(maxLevels.size()) - 1;
+		for (int z = 0; z < parentSize.y; z++) {
+			for (int x = 0; x < parentSize.x; x++) {
+				parent[z * parentSize.x + x] = glm::max(
+					glm::max(cellMax(child, 2 * x, 2 * z), cellMax(child, 2 * x + 1, 2 * z)),
+					glm::max(cellMax(child, 2 * x, 2 * z + 1), cellMax(child, 2 * x + 1, 2 * z + 1)));
+			}
+		}
+		maxLevels.push_back(parent);
+		levelSizes.push_back(parentSize);
+		size = parentSize;
+	}
+}
+
+float HeightField::sample(int x, int z) const {
+	x = glm::clamp(x, 0, width - 1);
+	z = glm::clamp(z, 0, height - 1);
+	return samples[z * width + x];
+}
+
+float HeightField::cellMax(int level, int x, int z) const {
+	const glm::ivec2& size = levelSizes[level];
+	if (x < 0 || z < 0 || x >= size.x || z >= size.y) {
+		return -FLT_MAX;
+	}
+	return maxLevels[level][z * size.x + x];
+}
+
+float HeightField::getHeight(float x, float z) const {
+	// sample centers are at texel centers, exactly like the GL_LINEAR lookup in the terrain shaders
+	float gx = glm::clamp(x / cellSizeX - 0.5f, 0.0f, float(width - 1));
+	float gz = glm::clamp((z + dimension) / cellSizeZ - 0.5f, 0.0f, float(height - 1));
+	int x0 = int(gx);
+	int z0 = int(gz);
+	float fx = gx - x0;
+	float fz = gz - z0;
+
+	float top = glm::mix(sample(x0, z0), sample(x0 + 1, z0), fx);
+	float bottom = glm::mix(sample(x0, z0 + 1), sample(x0 + 1, z0 + 1), fx);
+	return glm::mix(top, bottom, fz);
+}
+
+glm::vec3 HeightField::getNormal(float x, float z) const {
+	float left = getHeight(x - cellSizeX, z);
+	float right = getHeight(x + cellSizeX, z);
+	float back = getHeight(x, z - cellSizeZ);
+	float front = getHeight(x, z + cellSizeZ);
+	return glm::normalize(glm::vec3((left - right) / (2 * cellSizeX), 1.0f, (back - front) / (2 * cellSizeZ)));
+}
+
+// Moeller-Trumbore against the two triangles of a level 0 cell, in grid space
+bool HeightField::intersectCell(int x, int z, const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, float& t) const {
+	glm::vec3 v00 = glm::vec3(x, sample(x, z), z);
+	glm::vec3 v10 = glm::vec3(x + 1, sample(x + 1, z), z);
+	glm::vec3 v01 = glm::vec3(x, sample(x, z + 1), z + 1);
+	glm::vec3 v11 = glm::vec3(x + 1, sample(x + 1, z + 1), z + 1);
+	glm::vec3 triangles[2][3] = { { v00, v10, v11 }, { v00, v11, v01 } };
+
+	const float eps = 1e-4f;
+	bool found = false;
+	t = tMax + eps;
+	for (int i = 0; i < 2; i++) {
+		glm::vec3 e1 = triangles[i][1] - triangles[i][0];
+		glm::vec3 e2 = triangles[i][2] - triangles[i][0];
+		glm::vec3 p = glm::cross(direction, e2);
+		float det = glm::dot(e1, p);
+		if (glm::abs(det) < 1e-8f) {
+			continue;
+		}
+		float invDet = 1.0f / det;
+		glm::vec3 s = origin - triangles[i][0];
+		float u = glm::dot(s, p) * invDet;
+		if (u < -eps || u > 1.0f + eps) {
+			continue;
+		}
+		glm::vec3 q = glm::cross(s, e1);
+		float v = glm::dot(direction, q) * invDet;
+		if (v < -eps || u + v > 1.0f + eps) {
+			continue;
+		}
+		float tHit = glm::dot(e2, q) * invDet;
+		if (tHit >= tMin - eps && tHit < t) {
+			t = tHit;
+			found = true;
+		}
+	}
+	return found;
+}
+
+bool HeightField::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, HeightFieldHit& hit) const {
+	hit.hit = false;
+	float length = glm::length(direction);
+	if (length <= 0.0f || maxDistance <= 0.0f) {
+		return false;
+	}
+	glm::vec3 dirWorld = direction / length;
+
+	// grid space: one unit per sample in XZ, world units in Y, t stays the world distance
+	glm::vec3 o = glm::vec3(origin.x / cellSizeX - 0.5f, origin.y, (origin.z + dimension) / cellSizeZ - 0.5f);
+	glm::vec3 d = glm::vec3(dirWorld.x / cellSizeX, dirWorld.y, dirWorld.z / cellSizeZ);
+
+	// clip the ray against the XZ bounds of the grid
+	float tMin = 0.0f;
+	float tMax = maxDistance;
+	const glm::ivec2& cells = levelSizes[0];
+	float bounds[2] = { float(cells.x), float(cells.y) };
+	float origins[2] = { o.x, o.z };
+	float dirs[2] = { d.x, d.z };
+	for (int axis = 0; axis < 2; axis++) {
+		if (glm::abs(dirs[axis]) < 1e-12f) {
+			if (origins[axis] < 0.0f || origins[axis] > bounds[axis]) {
+				return false;
+			}
+			continue;
+		}
+		float t0 = (0.0f - origins[axis]) / dirs[axis];
+		float t1 = (bounds[axis] - origins[axis]) / dirs[axis];
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
+		tMin = glm::max(tMin, t0);
+		tMax = glm::min(tMax, t1);
+	}
+	if (tMin > tMax) {
+		return false;
+	}
+
+	const float eps = 1e-3f;
+	const int top = int(maxLevels.size()) - 1;
+	int level = top;
+	float t = tMin;
+
+	while (t <= tMax) {
+		glm::vec3 p = o + d * t;
+		int size = 1 << level;
+		int cx = glm::clamp(int(glm::floor(p.x / size)), 0, levelSizes[level].x - 1);
+		int cz = glm::clamp(int(glm::floor(p.z / size)), 0, levelSizes[level].y - 1);
+
+		// distance at which the ray leaves this cell
+		float tx = FLT_MAX;
+		float tz = FLT_MAX;
+		if (d.x > 0.0f) tx = ((cx + 1) * size - o.x) / d.x;
+		else if (d.x < 0.0f) tx = (cx * size - o.x) / d.x;
+		if (d.z > 0.0f) tz = ((cz + 1) * size - o.z) / d.z;
+		else if (d.z < 0.0f) tz = (cz * size - o.z) / d.z;
+		float tExit = glm::max(glm::min(glm::min(tx, tz), tMax), t);
+
+		// the ray is linear in y, so its lowest point in the cell is at the entry or the exit
+		float rayMin = glm::min(o.y + d.y * t, o.y + d.y * tExit);
+		if (rayMin > cellMax(level, cx, cz)) {
+			// the ray passes above the whole cell: skip it and try a coarser level next
+			t = tExit + eps;
+			if (level < top) {
+				level++;
+			}
+			continue;
+		}
+		if (level > 0) {
+			level--;
+			continue;
+		}
+
+		float tHit;
+		if (intersectCell(cx, cz, o, d, t, tExit, tHit)) {
+			hit.hit = true;
+			hit.distance = tHit;
+			hit.position = origin + dirWorld * tHit;
+			return true;
+		}
+		t = tExit + eps;
+	}
+	return false;
+}
+
+bool HeightField::intersectsSegment(const glm::vec3& from, const glm::vec3& to) const {
+	HeightFieldHit hit;
+	return raycast(from, to - from, glm::distance(from, to), hit);
+}
+
+bool HeightField::hasLineOfSight(const glm::vec3& from, const glm::vec3& to) const {
+	return !intersectsSegment(from, to);
+}
+
+void HeightField::raycast(const std::vector<HeightFieldRay>& rays, std::vector<HeightFieldHit>& hits) const {
+	hits.resize(rays.size());
+	for (size_t i = 0; i < rays.size(); i++) {
+		raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance, hits[i]);
+	}
+}
+
+void HeightField::lineOfSight(const std::vector<glm::vec3>& origins, const glm::vec3& target, std::vector<bool>& visible) const {
+	std::vector<HeightFieldRay> rays(origins.size());
+	for (size_t i = 0; i < origins.size(); i++) {
+		rays[i].origin = origins[i];
+		rays[i].direction = target - origins[i];
+		rays[i].maxDistance = glm::distance(origins[i], target);
+	}
+
+	std::vector<HeightFieldHit> hits;
+	raycast(rays, hits);
+
+	visible.resize(origins.size());
+	for (size_t i = 0; i < hits.size(); i++) {
+		visible[i] = !hits[i].hit;
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "../Image.h"
+
+/*!
+ * A single ray for batched heightfield queries
+ */
+struct HeightFieldRay {
+	glm::vec3 origin;
+	glm::vec3 direction;
+	float maxDistance;
+};
+
+/*!
+ * Result of a heightfield ray query
+ */
+struct HeightFieldHit {
+	bool hit = false;
+	float distance = 0.0f;
+	glm::vec3 position = glm::vec3(0.0f);
+};
+
+/*!
+ * CPU copy of the terrain heightmap with a max-height pyramid on top of it.
+ * Uses the same mapping as the tessellated terrain (u = x / dimension, v = z / dimension + 1),
+ * so queries answer against the surface that is actually rendered.
+ */
+class HeightField {
+private:
+	int width, height;
+	float dimension;
+	float scaleY;
+	float cellSizeX, cellSizeZ;
+
+	// sample heights in world units, row major (width * height)
+	std::vector<float> samples;
+
+	// maxLevels[0] holds the max height of every cell between four samples,
+	// every following level the max of 2x2 cells of the level below
+	std::vector<std::vector<float>> maxLevels;
+	std::vector<glm::ivec2> levelSizes;
+
+	void buildPyramid();
+	float sample(int x, int z) const;
+	float cellMax(int level, int x, int z) const;
+	bool intersectCell(int x, int z, const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, float& t) const;
+
+public:
+	/*!
+	 * Loads the heightmap and builds the max-height pyramid
+	 * @param heightMapPath: path to the heightmap (red channel is used)
+	 * @param dimension: size of the terrain in the XZ plane
+	 * @param scaleY: height of the terrain
+	 */
+	HeightField(const char* heightMapPath, float dimension, float scaleY);
+
+	/*!
+	 * Builds the max-height pyramid from an already loaded heightmap
+	 * @param heightMap: heightmap image (red channel is used)
+	 * @param dimension: size of the terrain in the XZ plane
+	 * @param scaleY: height of the terrain
+	 */
+	HeightField(const Image& heightMap, float dimension, float scaleY);
+	~HeightField();
+
+	/*!
+	 * @return bilinear interpolated terrain height at the given world position
+	 */
+	float getHeight(float x, float z) const;
+
+	/*!
+	 * @return terrain normal at the given world position
+	 */
+	glm::vec3 getNormal(float x, float z) const;
+
+	/*!
+	 * Casts a ray against the terrain
+	 * @param origin: world space origin of the ray
+	 * @param direction: direction of the ray (does not need to be normalized)
+	 * @param maxDistance: maximum distance along the ray
+	 * @param hit: closest hit, only valid if true is returned
+	 * @return if the terrain was hit
+	 */
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, HeightFieldHit& hit) const;
+
+	/*!
+	 * @return if the segment between from and to is blocked by the terrain
+	 */
+	bool intersectsSegment(const glm::vec3& from, const glm::vec3& to) const;
+
+	/*!
+	 * @return if the terrain does not block the line between from and to
+	 */
+	bool hasLineOfSight(const glm::vec3& from, const glm::vec3& to) const;
+
+	/*!
+	 * Casts multiple rays at once
+	 * @param rays: rays to cast
+	 * @param hits: results, resized to the number of rays
+	 */
+	void raycast(const std::vector<HeightFieldRay>& rays, std::vector<HeightFieldHit>& hits) const;
+
+	/*!
+	 * Tests the line of sight from every origin to the same target
+	 * @param origins: start points of the lines
+	 * @param target: common end point
+	 * @param visible: results, resized to the number of origins
+	 */
+	void lineOfSight(const std::vector<glm::vec3>& origins, const glm::vec3& target, std::vector<bool>& visible) const;
+
+	float getDimension() const;
+	float getScaleY() const;
+
+	/*!
+	 * @return samples of the heightmap per row and column
+	 */
+	glm::ivec2 getResolution() const;
+
+	/*!
+	 * @return sample heights in world units, row major
+	 */
+	const std::vector<float>& getSamples() const;
+};
@@ -2,18 +2,13 @@
 #include "Terrain.h"
 #include "../PoissonDiskSampling.h"
 
-Terrain::Terrain(int dimension, int vertexCount, float height, const char* heightMapPath, bool shadowMap) {
+Terrain::Terrain(int dimension, int vertexCount, float height, const Image& heightMapImage) {
 	this->scaleXZ = dimension;
 	this->scaleY = height;
-	if (shadowMap) {
-		this->generateTerrainTriangleMesh(dimension, vertexCount);
-	}
-	else
-	{
-		this->generateTerrain(dimension, vertexCount);
-	}
+	this->generateTerrain(dimension, vertexCount);
 	heightMap.setTransparent(true);
-	heightMap.loadTexture(heightMapPath);
+	// the heights have to be there in the first frame, they also drive the tessellation and the grass
+	heightMap.loadImage(heightMapImage);
 	this->initBuffer();
 }
 
@@ -38,47 +33,8 @@ glm::mat4 Terrain::getModelMatrix() {
 	return _modelMatrix;
 }
 
-void Terrain::generateTerrainTriangleMesh(int dimension, int vertexCount) {
-
-	// actual width, height
-	const int w = dimension, h = dimension;
-
-	// number of vertices pro zeile/spalte
-	const int verticesWidth = vertexCount, verticesHeight = vertexCount;
-	int i = 0;
-
-	for (int z = 0; z < verticesHeight; z++) {
-		for (int x = 0; x < verticesWidth; x++)
-		{
-			// pos mapped von 0 bis 1
-			glm::vec3 pos = glm::vec3((x) / (float)verticesWidth, -1000, (z) / (float)verticesHeight);
-
-			pos.x *= w;
-			//pos.x -= w / 2;
-			pos.z *= h;
-			//pos.z -= h / 2;
-			pos.z -= h;
-
-			data.positions.push_back(pos);
-			data.normals.push_back(glm::vec3(0, 1, 0));
-
-			// quads: top left, top right, bottom right, bottom left
-			if (((i + 1) % verticesWidth) != 0 && z + 1 < verticesHeight) {
-
-				data.indices.push_back(i);
-				data.indices.push_back(i + verticesWidth);
-				data.indices.push_back(i + verticesWidth + 1);
-
-				data.indices.push_back(i + verticesWidth + 1);
-				data.indices.push_back(i + 1);
-				data.indices.push_back(i);
-
-			}
-			i++;
-		}
-	}
-	terrainCount = data.indices.size();
-
+GLuint Terrain::getHeightMapId() {
+	return heightMap.getTextureId();
 }
 
 void Terrain::generateTerrain(int dimension, int vertexCount) {
@@ -181,18 +137,25 @@ void Terrain::draw(TerrainShader* terrainShader, PlayerCamera& camera, ShadowMap
 	terrainShader->unuse();
 }
 
-void Terrain::draw(Shader* shader) {
-	shader->use();
-	shader->setUniform("modelMatrix", _modelMatrix);
-	shader->setUniform("scaleXZ", scaleXZ);
-	shader->setUniform("scaleY", scaleY);
-	shader->setUniform("isTerrain", true);
+void Terrain::drawShadow(TerrainShader* shadowShader, ShadowMap& shadowMap) {
+	shadowShader->use();
+
+	shadowShader->setUniform("modelMatrix", _modelMatrix);
+	shadowShader->setUniform("lightSpaceMatrix", shadowMap.getLightSpaceMatrix());
+	shadowShader->setUniform("shadowMapSize", float(shadowMap.getSize()));
+	shadowShader->setUniform("scaleXZ", scaleXZ);
+	shadowShader->setUniform("scaleY", scaleY);
+
+	// coarse target: one segment every 16 shadow map texels
+	shadowShader->setUniform("texelsPerSegment", 16.0f);
+	shadowShader->setUniform("maxTessLevel", 16.0f);
 
 	heightMap.bind(0);
-	shader->setUniform("heightMap", 0);
+	shadowShader->setUniform("heightMap", 0);
 
 	glBindVertexArray(terrainVao);
-	glDrawElements(GL_TRIANGLES, terrainCount, GL_UNSIGNED_INT, 0);
+	glPatchParameteri(GL_PATCH_VERTICES, 4);
+	glDrawElements(GL_PATCHES, terrainCount, GL_UNSIGNED_INT, 0);
 	glBindVertexArray(0);
-	shader->unuse();
+	shadowShader->unuse();
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "../stb_image.h"
 #include "../Mesh.h"
+#include "../Image.h"
 #include "TerrainShader.h"
 #include "../PlayerCamera.h"
 #include "../Shadowmap/ShadowMap.h"
@@ -31,13 +32,21 @@ private:
 public:
 
 	Terrain();
-	Terrain(int dimension, int vertexCount, float height, const char* heightMapPath, bool shadowMap);
+	/*!
+	 * @param heightMap: decoded on a worker, only uploaded here
+	 */
+	Terrain(int dimension, int vertexCount, float height, const Image& heightMap);
 	~Terrain();
 
 	void generateTerrain(int dimension, int vertexCount);
-	void generateTerrainTriangleMesh(int dimesion, int vertexCount);
 	void draw(TerrainShader* terrainShader, PlayerCamera& camera, ShadowMap& shadowMap, float brightness);
-	void draw(Shader* shader);
+
+	/*!
+	 * Renders the terrain into the shadow map with the same patches and heightmap as draw,
+	 * but with the shadow shader's own tessellation levels
+	 */
+	void drawShadow(TerrainShader* shadowShader, ShadowMap& shadowMap);
 	void initBuffer();
 	glm::mat4 getModelMatrix();
+	GLuint getHeightMapId();
 };
\ No newline at end of file
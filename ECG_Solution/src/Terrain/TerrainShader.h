@@ -9,11 +9,11 @@
 #include <string>
 #include <fstream>
 #include <iostream>
-#include <unordered_map>
 #include <glm\glm.hpp>
 #include <glm\gtc\type_ptr.hpp>
 
 #include "..\Utils.h"
+#include "..\ShaderVariants.h"
 
 
 /*!
@@ -38,9 +38,9 @@ protected:
 	bool _useFileAsSource;
 
 	/*!
-	 * Stores the shader location names with their location IDs
+	 * Compiled variants of the program, ID is the selected one
 	 */
-	std::unordered_map<std::string, GLint> _locations;
+	std::unique_ptr<ShaderVariants> _variants;
 
 	/*!
 	 * Loads the specified vertex and fragment shaders
@@ -94,6 +94,13 @@ public:
 	 */
 	void unuse();
 
+	/*!
+	 * Selects the variant of the shader with the keyword enabled or disabled, see ShaderVariants
+	 * @param keyword: keyword declared by the shader, others are ignored
+	 * @param enabled: whether the code of the keyword is compiled in
+	 */
+	void setKeyword(const std::string& keyword, bool enabled);
+
 	/*!
 	 * Sets an integer uniform in the shader
 	 * @param uniform: the name of the uniform
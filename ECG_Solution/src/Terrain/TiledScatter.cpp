@@ -0,0 +1,173 @@
+#include "TiledScatter.h"
+#include <cstring>
+
+#define _USE_MATH_DEFINES
+#include "math.h"
+
+TiledScatter::TiledScatter(const HeightField& heightField, const Image& mask, const ScatterLayer& layer, unsigned int seed)
+	: heightField(heightField), mask(mask), layer(layer), seed(seed)
+{
+	this->layer.maxDist = glm::max(this->layer.maxDist, this->layer.minDist);
+	dimension = heightField.getDimension();
+
+	// tiles have to be at least maxDist wide, so tiles of the same phase can never see each other
+	tilesPerSide = glm::clamp(int(dimension / this->layer.maxDist), 1, 64);
+	tileSize = dimension / tilesPerSide;
+
+	// a cell is small enough to hold at most one instance and never crosses a tile border
+	cellsPerTile = int(glm::ceil(tileSize / (this->layer.minDist / float(M_SQRT2))));
+	cellSize = tileSize / cellsPerTile;
+	gridSize = tilesPerSide * cellsPerTile;
+	searchCells = int(glm::ceil(this->layer.maxDist / cellSize));
+}
+
+TiledScatter::~TiledScatter() {}
+
+void TiledScatter::generate(ThreadPool& pool) {
+	grid.assign(size_t(gridSize) * gridSize, glm::vec3(0.0f));
+	tileInstances.assign(tilesPerSide * tilesPerSide, std::vector<ScatterInstance>());
+
+	for (int phase = 0; phase < 4; phase++) {
+		std::vector<glm::ivec2> tiles;
+		for (int z = phase / 2; z < tilesPerSide; z += 2) {
+			for (int x = phase % 2; x < tilesPerSide; x += 2) {
+				tiles.push_back(glm::ivec2(x, z));
+			}
+		}
+		pool.parallelFor(int(tiles.size()), [this, &tiles](int i) {
+			sampleTile(tiles[i].x, tiles[i].y);
+		});
+	}
+
+	tileOffsets.resize(tileInstances.size());
+	size_t offset = 0;
+	for (size_t i = 0; i < tileInstances.size(); i++) {
+		tileOffsets[i] = offset;
+		offset += tileInstances[i].size();
+	}
+}
+
+size_t TiledScatter::getCount() const {
+	if (tileInstances.empty()) {
+		return 0;
+	}
+	return tileOffsets.back() + tileInstances.back().size();
+}
+
+void TiledScatter::write(ThreadPool& pool, ScatterInstance* destination) const {
+	pool.parallelFor(int(tileInstances.size()), [this, destination](int i) {
+		if (!tileInstances[i].empty()) {
+			std::memcpy(destination + tileOffsets[i], tileInstances[i].data(), tileInstances[i].size() * sizeof(ScatterInstance));
+		}
+	});
+}
+
+// density from the mask and the slope, turned into the distance to other instances
+float TiledScatter::radiusAt(glm::vec2 point) const {
+	glm::vec2 uv = point / dimension;
+	float density = mask.sampleLinear(uv, layer.maskChannel);
+	if (density <= 0.0f) {
+		return -1.0f;
+	}
+
+	float cosMaxSlope = glm::cos(glm::radians(layer.maxSlope));
+	glm::vec3 normal = heightField.getNormal(point.x, point.y - dimension);
+	density *= glm::clamp((normal.y - cosMaxSlope) / (1.0f - cosMaxSlope), 0.0f, 1.0f);
+
+	float minDensity = (layer.minDist * layer.minDist) / (layer.maxDist * layer.maxDist);
+	if (density < minDensity) {
+		return -1.0f;
+	}
+	return layer.minDist / glm::sqrt(density);
+}
+
+bool TiledScatter::inNeighbourhood(glm::vec2 point, float radius) const {
+	int cellX = glm::clamp(int(point.x / cellSize), 0, gridSize - 1);
+	int cellZ = glm::clamp(int(point.y / cellSize), 0, gridSize - 1);
+	int xStart = glm::max(0, cellX - searchCells);
+	int xEnd = glm::min(cellX + searchCells, gridSize - 1);
+	int zStart = glm::max(0, cellZ - searchCells);
+	int zEnd = glm::min(cellZ + searchCells, gridSize - 1);
+
+	for (int z = zStart; z <= zEnd; z++) {
+		for (int x = xStart; x <= xEnd; x++) {
+			const glm::vec3& other = grid[size_t(z) * gridSize + x];
+			if (other.z <= 0.0f) {
+				continue;
+			}
+			// the sparser of both instances decides how far apart they have to be
+			float distance = glm::max(radius, other.z);
+			glm::vec2 delta = glm::vec2(other.x, other.y) - point;
+			if (glm::dot(delta, delta) < distance * distance) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void TiledScatter::insert(glm::vec2 point, float radius, std::vector<glm::vec3>& active, std::vector<ScatterInstance>& instances, std::minstd_rand& random) {
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+	int cellX = glm::clamp(int(point.x / cellSize), 0, gridSize - 1);
+	int cellZ = glm::clamp(int(point.y / cellSize), 0, gridSize - 1);
+	grid[size_t(cellZ) * gridSize + cellX] = glm::vec3(point, radius);
+	active.push_back(glm::vec3(point, radius));
+
+	float worldZ = point.y - dimension;
+	ScatterInstance instance;
+	float scale = glm::mix(layer.minScale, layer.maxScale, distribution(random));
+	float rotation = float(2 * M_PI) * distribution(random);
+	instance.positionScale = glm::vec4(point.x, heightField.getHeight(point.x, worldZ), worldZ, scale);
+	instance.normalRotation = glm::vec4(heightField.getNormal(point.x, worldZ), rotation);
+	instances.push_back(instance);
+}
+
+void TiledScatter::sampleTile(int tileX, int tileZ) {
+	// seed per tile, independent of the order in which tiles run,
+	// a small generator keeps the setup cheap for thousands of tiles
+	unsigned int hash = seed ^ (static_cast<unsigned int>(tileX) * 0x85EBCA77u) ^ (static_cast<unsigned int>(tileZ) * 0xC2B2AE3Du);
+	hash ^= hash >> 16;
+	hash *= 0x7FEB352Du;
+	hash ^= hash >> 15;
+	hash *= 0x846CA68Bu;
+	hash ^= hash >> 16;
+	std::minstd_rand random(hash);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+	glm::vec2 tileMin = glm::vec2(tileX, tileZ) * tileSize;
+	glm::vec2 tileMax = tileMin + tileSize;
+	std::vector<ScatterInstance>& instances = tileInstances[tileZ * tilesPerSide + tileX];
+	std::vector<glm::vec3> active;
+
+	// random starting points, so regions separated by the mask are reached as well
+	int starts = layer.count * 4;
+	for (int s = 0; s < starts; s++) {
+		glm::vec2 start = tileMin + glm::vec2(distribution(random), distribution(random)) * tileSize;
+		float startRadius = radiusAt(start);
+		if (startRadius <= 0.0f || inNeighbourhood(start, startRadius)) {
+			continue;
+		}
+		insert(start, startRadius, active, instances, random);
+
+		// Bridson: grow around active instances, swap-remove them once they are done
+		while (!active.empty()) {
+			size_t index = std::uniform_int_distribution<size_t>(0, active.size() - 1)(random);
+			glm::vec3 current = active[index];
+			active[index] = active.back();
+			active.pop_back();
+
+			for (int i = 0; i < layer.count; i++) {
+				float distance = current.z * (distribution(random) + 1);
+				float angle = float(2 * M_PI) * distribution(random);
+				glm::vec2 candidate = glm::vec2(current.x + distance * cos(angle), current.y + distance * sin(angle));
+				if (candidate.x < tileMin.x || candidate.y < tileMin.y || candidate.x >= tileMax.x || candidate.y >= tileMax.y) {
+					continue;
+				}
+				float radius = radiusAt(candidate);
+				if (radius > 0.0f && !inNeighbourhood(candidate, radius)) {
+					insert(candidate, radius, active, instances, random);
+				}
+			}
+		}
+	}
+}
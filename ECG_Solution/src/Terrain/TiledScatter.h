@@ -0,0 +1,88 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <glm/glm.hpp>
+#include "HeightField.h"
+#include "../Image.h"
+#include "../Jobs/ThreadPool.h"
+
+/*!
+ * One scattered instance, laid out to be used directly as instance attribute or std430 buffer
+ */
+struct ScatterInstance {
+	glm::vec4 positionScale;	// xyz world position, w uniform scale
+	glm::vec4 normalRotation;	// xyz terrain normal, w rotation around the y axis in radians
+};
+
+/*!
+ * Parameters of one scatter layer (trees, rocks, grass, ...)
+ */
+struct ScatterLayer {
+	float minDist = 10.0f;		// distance between instances where the density is 1
+	float maxDist = 40.0f;		// instances are never spread further apart, lower densities get no instances
+	int maskChannel = 0;		// channel of the mask that scales the density
+	float maxSlope = 45.0f;		// slope in degrees at which the density reaches 0
+	float minScale = 1.0f;
+	float maxScale = 1.0f;
+	int count = 10;				// candidates tried around every instance
+};
+
+/*!
+ * Multi-threaded blue noise scatter over the terrain.
+ * The terrain is split into tiles that are at least maxDist wide. Tiles are sampled in four phases
+ * by the parity of their coordinates, so tiles of the same phase never touch and can run in parallel,
+ * while every tile still sees the instances of its already finished neighbours.
+ * Every tile has its own random generator seeded from the seed and the tile coordinates,
+ * so the result only depends on the seed and not on the number of threads.
+ */
+class TiledScatter {
+private:
+	const HeightField& heightField;
+	const Image& mask;
+	ScatterLayer layer;
+	unsigned int seed;
+
+	float dimension;
+	int tilesPerSide;
+	float tileSize;
+	int cellsPerTile;
+	int gridSize;
+	float cellSize;
+	int searchCells;
+
+	// x, z (in scatter space [0, dimension]) and radius of the instance in every cell, radius 0 if empty
+	std::vector<glm::vec3> grid;
+	std::vector<std::vector<ScatterInstance>> tileInstances;
+	std::vector<size_t> tileOffsets;
+
+	void sampleTile(int tileX, int tileZ);
+	float radiusAt(glm::vec2 point) const;
+	bool inNeighbourhood(glm::vec2 point, float radius) const;
+	void insert(glm::vec2 point, float radius, std::vector<glm::vec3>& active, std::vector<ScatterInstance>& instances, std::minstd_rand& random);
+
+public:
+	/*!
+	 * @param heightField: terrain used for heights, normals and the slope
+	 * @param mask: density mask over the whole terrain
+	 * @param layer: parameters of the scattered layer
+	 * @param seed: same seed gives the same instances
+	 */
+	TiledScatter(const HeightField& heightField, const Image& mask, const ScatterLayer& layer, unsigned int seed);
+	~TiledScatter();
+
+	/*!
+	 * Samples all tiles on the thread pool
+	 */
+	void generate(ThreadPool& pool);
+
+	/*!
+	 * @return number of generated instances
+	 */
+	size_t getCount() const;
+
+	/*!
+	 * Copies the instances in a deterministic order, every tile is copied by a different job
+	 * @param destination: memory for getCount() instances, e.g. a mapped buffer
+	 */
+	void write(ThreadPool& pool, ScatterInstance* destination) const;
+};
@@ -1,5 +1,6 @@
 #include "TextRenderer.h"
 #include <iostream>
+#include "FileSystem/FileSystem.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <ft2build.h>
@@ -34,9 +35,10 @@ void TextRenderer::Load(std::string font, GLuint fontSize)
 	FT_Library ft;
 	if (FT_Init_FreeType(&ft)) // All functions return a value different than 0 whenever an error occurred
 		std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-	// Load font as face
+	// Load font as face, FreeType reads from the memory until the face is done
+	FileData fontFile = FileSystem::readFile(font);
 	FT_Face face;
-	if (FT_New_Face(ft, font.c_str(), 0, &face))
+	if (!fontFile.isValid() || FT_New_Memory_Face(ft, fontFile.bytesData(), FT_Long(fontFile.size()), 0, &face))
 		std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
 	// Set size to load glyphs as
 	FT_Set_Pixel_Sizes(face, 0, fontSize);
@@ -1,4 +1,8 @@
 #include "Texture.h"
+#include "Compression/DDSFile.h"
+#include "Streaming/AsyncTextureLoader.h"
+#include "FileSystem/FileSystem.h"
+#include "Image.h"
 
 Texture::Texture() {}
 
@@ -7,12 +11,35 @@ Texture::Texture(const char* texturePath, bool isTransparent) : isTransparent(is
 }
 
 Texture::~Texture() {
+	if (AsyncTextureLoader::getInstance() != nullptr) {
+		AsyncTextureLoader::getInstance()->release(_handle);
+	}
 	glDeleteTextures(1, &_handle);
 }
 
-void Texture::loadTexture(const char* texturePath) {
+void Texture::loadTexture(const char* texturePath, bool async) {
+	AsyncTextureLoader* loader = AsyncTextureLoader::getInstance();
+	if (async && loader != nullptr) {
+		_handle = loader->load2D(texturePath, isTransparent ? GL_RGBA : GL_RGB, ImageOrigin::TopDown, true);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		return;
+	}
+
+	CompressedImage compressed;
+	if (readDDS(getCompressedPath(texturePath), compressed)) {
+		aspectRatio = compressed.width / compressed.height;
+
+		glGenTextures(1, &_handle);
+		glBindTexture(GL_TEXTURE_2D, _handle);
+		uploadCompressedImage(GL_TEXTURE_2D, compressed);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(compressed.levels.size()) - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		return;
+	}
+
 	int width, height, nrChannels;
-	unsigned char* data = stbi_load(texturePath, &width, &height, &nrChannels, 0);
+	FileData file = FileSystem::readFile(texturePath);
+	unsigned char* data = file.isValid() ? stbi_load_from_memory(file.bytesData(), int(file.size()), &width, &height, &nrChannels, 0) : nullptr;
 	aspectRatio = width / height;
 
 	glGenTextures(1, &_handle);
@@ -36,6 +63,19 @@ void Texture::loadTexture(const char* texturePath) {
 	}
 	stbi_image_free(data);
 }
+void Texture::loadImage(const Image& image) {
+	aspectRatio = image.getHeight() > 0 ? float(image.getWidth()) / image.getHeight() : 1.0f;
+	glGenTextures(1, &_handle);
+	glBindTexture(GL_TEXTURE_2D, _handle);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	if (!image.isValid()) {
+		std::cout << "Failed to load image" << std::endl;
+		return;
+	}
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.getWidth(), image.getHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, image.getPixels());
+	glGenerateMipmap(GL_TEXTURE_2D);
+}
+
 void Texture::setTransparent(bool transparent) {
 	this->isTransparent = transparent;
 }
@@ -44,6 +84,10 @@ GLuint Texture::getTextureId() {
 }
 
 float Texture::getAspectRatio() {
+	int width, height;
+	if (AsyncTextureLoader::getInstance() != nullptr && AsyncTextureLoader::getInstance()->getSize(_handle, width, height)) {
+		return width / height;
+	}
 	return aspectRatio;
 }
 
@@ -11,6 +11,8 @@
 #include "Utils.h"
 #include "stb_image.h"
 
+class Image;
+
 
 /* --------------------------------------------- */
 // 2D texture
@@ -55,6 +57,15 @@ public:
 	 */
 	float getAspectRatio();
 
-	void loadTexture(const char* texturePath);
+	/*!
+	 * Loads the texture (or its DDS version), through the AsyncTextureLoader if there is one
+	 * @param async: false loads the image before returning
+	 */
+	void loadTexture(const char* texturePath, bool async = true);
+
+	/*!
+	 * Uploads an image that was decoded before, with mipmaps
+	 */
+	void loadImage(const Image& image);
 	void setTransparent(bool transparent);
 };
@@ -1,11 +1,37 @@
 
 #include "Utils.h"
+#include "Compression/DDSFile.h"
+#include "Streaming/AsyncTextureLoader.h"
+#include "ProgramCache.h"
+#include "FileSystem/FileSystem.h"
 
 // https://r3dux.org/2014/10/how-to-load-an-opengl-texture-using-the-freeimage-library-or-freeimageplus-technically/
 GLuint loadTextureFromFile(const char* filename) {
-	FREE_IMAGE_FORMAT format = FreeImage_GetFileType(filename, 0);
+	if (AsyncTextureLoader::getInstance() != nullptr) {
+		GLuint textureID = AsyncTextureLoader::getInstance()->load2D(filename, GL_RGBA, ImageOrigin::BottomUp, true);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return textureID;
+	}
+
+	// prefer the block compressed version with its prebuilt mip chain (written by --convert-textures),
+	// FreeImage delivers the rows bottom-up, so the top-down DDS levels are flipped to match
+	CompressedImage compressed;
+	if (readDDS(getCompressedPath(filename), compressed) && flipCompressedImage(compressed)) {
+		GLuint textureID;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		uploadCompressedImage(GL_TEXTURE_2D, compressed);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(compressed.levels.size()) - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return textureID;
+	}
+
+	FileData file = FileSystem::readFile(filename);
+	FIMEMORY* memory = file.isValid() ? FreeImage_OpenMemory(const_cast<BYTE*>(file.bytesData()), DWORD(file.size())) : nullptr;
+	FREE_IMAGE_FORMAT format = memory != nullptr ? FreeImage_GetFileTypeFromMemory(memory, 0) : FIF_UNKNOWN;
 
-	if (format == -1) {
+	if (memory == nullptr) {
 		std::cout << "Could not find image: " << filename << "." << std::endl;
 	}
 
@@ -19,7 +45,8 @@ GLuint loadTextureFromFile(const char* filename) {
 	}
 
 
-	FIBITMAP* bitmap = FreeImage_Load(format, filename);
+	FIBITMAP* bitmap = FreeImage_LoadFromMemory(format, memory);
+	FreeImage_CloseMemory(memory);
 	int bitsPerPixel = FreeImage_GetBPP(bitmap);
 	FIBITMAP* bitmap32;
 	if (bitsPerPixel == 32) {
@@ -88,144 +115,27 @@ GLuint loadTextureFromFile(const char* filename) {
 }
 
 GLuint getParticleShader(char* vertexShaderSource, char* geometryShaderSource, char* fragmentShaderSource) {
-	GLchar *vertexsource, *geometrysource, *fragmentsource;
-	GLuint vertexshader, geometryshader, fragmentshader;
-	GLuint shaderprogram;
-	vertexsource = filetobuf(vertexShaderSource);
-	geometrysource = filetobuf(geometryShaderSource);
-	fragmentsource = filetobuf(fragmentShaderSource);
-
-	vertexshader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexshader, 1, (const GLchar**)&vertexsource, 0);
-	glCompileShader(vertexshader);
-	GLint IsCompiled_VS;
-	glGetShaderiv(vertexshader, GL_COMPILE_STATUS, &IsCompiled_VS);
-
-	if (IsCompiled_VS == GL_FALSE)
-	{
-		GLint logSize;
-		glGetShaderiv(vertexshader, GL_INFO_LOG_LENGTH, &logSize);
-		GLchar* message = new char[logSize];
-		glGetShaderInfoLog(vertexshader, logSize, NULL, message);
-		std::cout << message << std::endl;
-		delete[] message;
-	}
-
-	geometryshader = glCreateShader(GL_GEOMETRY_SHADER);
-	glShaderSource(geometryshader, 1, (const GLchar**)&geometrysource, 0);
-	glCompileShader(geometryshader);
-	GLint IsCompiled_GS;
-	glGetShaderiv(geometryshader, GL_COMPILE_STATUS, &IsCompiled_GS);
-
-	if (IsCompiled_GS == GL_FALSE)
-	{
-		GLint logSize;
-		glGetShaderiv(geometryshader, GL_INFO_LOG_LENGTH, &logSize);
-		GLchar* message = new char[logSize];
-		glGetShaderInfoLog(geometryshader, logSize, NULL, message);
-		std::cout << message << std::endl;
-		delete[] message;
-	}
-
-
-	fragmentshader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentshader, 1, (const GLchar**)&fragmentsource, 0);
-	glCompileShader(fragmentshader);
-	GLint IsCompiled_FS;
-	glGetShaderiv(fragmentshader, GL_COMPILE_STATUS, &IsCompiled_FS);
-	if (IsCompiled_FS == GL_FALSE)
-	{
-		GLint logSize;
-		glGetShaderiv(fragmentshader, GL_INFO_LOG_LENGTH, &logSize);
-		GLchar* message = new char[logSize];
-		glGetShaderInfoLog(fragmentshader, logSize, NULL, message);
-		std::cout << message << std::endl;
-		delete[] message;
-	}
-
-
-	shaderprogram = glCreateProgram();
-	glAttachShader(shaderprogram, vertexshader);
-	glAttachShader(shaderprogram, geometryshader);
-	glAttachShader(shaderprogram, fragmentshader);
-
-	glLinkProgram(shaderprogram);
-
-	GLint IsLinked;
-	glGetProgramiv(shaderprogram, GL_LINK_STATUS, (int *)&IsLinked);
-	if (IsLinked == GL_FALSE)
-	{
-		GLint logSize;
-		glGetShaderiv(shaderprogram, GL_INFO_LOG_LENGTH, &logSize);
-		GLchar* message = new char[logSize];
-		glGetShaderInfoLog(shaderprogram, logSize, NULL, message);
-		std::cout << message << std::endl;
-		delete[] message;
-
-	}
-
-	return shaderprogram;
+	std::vector<ShaderStage> stages;
+	stages.push_back(ShaderStage::fromFile(GL_VERTEX_SHADER, vertexShaderSource));
+	stages.push_back(ShaderStage::fromFile(GL_GEOMETRY_SHADER, geometryShaderSource));
+	stages.push_back(ShaderStage::fromFile(GL_FRAGMENT_SHADER, fragmentShaderSource));
+	return ProgramCache::create(stages);
 }
 
 
 GLuint getComputeShader(char* computeshadersource) {
-	GLchar *computesource;
-	GLuint computeshader;
-	GLuint shaderprogram;
-	computesource = filetobuf(computeshadersource);
-
-
-	computeshader = glCreateShader(GL_COMPUTE_SHADER);
-	glShaderSource(computeshader, 1, (const GLchar**)&computesource, 0);
-	glCompileShader(computeshader);
-	GLint IsCompiled_CS;
-	glGetShaderiv(computeshader, GL_COMPILE_STATUS, &IsCompiled_CS);
-
-	if (IsCompiled_CS == GL_FALSE) {
-		GLint logSize;
-		glGetShaderiv(computeshader, GL_INFO_LOG_LENGTH, &logSize);
-		GLchar* message = new char[logSize];
-		glGetShaderInfoLog(computeshader, logSize, NULL, message);
-		std::cout << message << std::endl;
-		delete[] message;
-	}
-
-	shaderprogram = glCreateProgram();
-	glAttachShader(shaderprogram, computeshader);
-
-	glLinkProgram(shaderprogram);
-
-	GLint IsLinked;
-	glGetProgramiv(shaderprogram, GL_LINK_STATUS, (int *)&IsLinked);
-	if (IsLinked == GL_FALSE)
-	{
-		GLint logSize;
-		glGetShaderiv(shaderprogram, GL_INFO_LOG_LENGTH, &logSize);
-		GLchar* message = new char[logSize];
-		glGetShaderInfoLog(shaderprogram, logSize, NULL, message);
-		std::cout << message << std::endl;
-		delete[] message;
-
-	}
-
-	return shaderprogram;
+	std::vector<ShaderStage> stages;
+	stages.push_back(ShaderStage::fromFile(GL_COMPUTE_SHADER, computeshadersource));
+	return ProgramCache::create(stages);
 }
 
 char* filetobuf(char *file) {
-	FILE *fptr;
-	long length;
-	char *buf;
-
-	fptr = fopen(file, "rb"); /* Open file for reading */
-	if (!fptr) /* Return NULL on failure */
+	FileData data = FileSystem::readFile(file);
+	if (!data.isValid()) /* Return NULL on failure */
 		return NULL;
-	fseek(fptr, 0, SEEK_END); /* Seek to the end of the file */
-	length = ftell(fptr); /* Find out how many bytes into the file we are */
-	buf = (char*)malloc(length + 1); /* Allocate a buffer for the entire length of the file and a null terminator */
-	fseek(fptr, 0, SEEK_SET); /* Go back to the beginning of the file */
-	fread(buf, length, 1, fptr); /* Read the contents of the file in to the buffer */
-	fclose(fptr); /* Close the file */
-	buf[length] = 0; /* Null terminator */
+	char* buf = (char*)malloc(data.size() + 1); /* Allocate a buffer for the entire length of the file and a null terminator */
+	memcpy(buf, data.data(), data.size());
+	buf[data.size()] = 0; /* Null terminator */
 
 	return buf; /* Return the buffer */
 }
@@ -0,0 +1,21 @@
+#version 430 core
+
+in vec3 fragPosition;
+in vec3 fragNormal;
+in float fragBladeHeight;
+in float fragVariation;
+
+out vec4 color;
+
+uniform vec3 lightPosition;
+uniform float brightness;
+
+void main() {
+    vec3 normal = gl_FrontFacing ? fragNormal : vec3(-fragNormal.x, fragNormal.y, -fragNormal.z);
+    vec3 baseColor = mix(vec3(0.12, 0.25, 0.05), vec3(0.35, 0.55, 0.12), fragBladeHeight);
+    baseColor *= mix(0.8, 1.2, fragVariation);
+
+    vec3 lightDir = normalize(lightPosition - fragPosition);
+    float diffuse = max(dot(normal, lightDir), 0.0);
+    color = vec4(baseColor * (0.4 + 0.6 * diffuse) * brightness, 1.0);
+}
@@ -0,0 +1,48 @@
+#version 430 core
+
+struct GrassInstance {
+    vec4 positionScale;
+    vec4 rotationBend;
+};
+
+layout (std430, binding = 0) readonly buffer Instances {
+    GrassInstance Instance_In[];
+};
+
+uniform mat4 viewProjMatrix;
+uniform float time;
+
+out vec3 fragPosition;
+out vec3 fragNormal;
+out float fragBladeHeight;
+out float fragVariation;
+
+// a blade is a triangle strip of SEGMENTS quads and a tip
+const int SEGMENTS = 3;
+const float WIDTH = 0.06;
+
+void main() {
+    GrassInstance grass = Instance_In[gl_InstanceID];
+    vec3 root = grass.positionScale.xyz;
+    float height = grass.positionScale.w;
+
+    float t = float(gl_VertexID / 2) / float(SEGMENTS);
+    float side = gl_VertexID == 2 * SEGMENTS ? 0.0 : (gl_VertexID % 2 == 0 ? -1.0 : 1.0);
+
+    vec2 across = vec2(cos(grass.rotationBend.x), sin(grass.rotationBend.x));
+    vec2 facing = vec2(-across.y, across.x);
+
+    // the blade bends forward and sways in the wind, more towards the tip
+    float wind = sin(time * 1.7 + root.x * 0.21 + root.z * 0.17) * 0.25;
+    float bend = (grass.rotationBend.y + wind) * t * t * height;
+
+    vec3 position = root;
+    position.xz += across * side * WIDTH * height * (1.0 - t) + facing * bend;
+    position.y += t * height;
+
+    fragPosition = position;
+    fragNormal = normalize(vec3(facing.x, 0.5, facing.y));
+    fragBladeHeight = t;
+    fragVariation = grass.rotationBend.z;
+    gl_Position = viewProjMatrix * vec4(position, 1.0);
+}
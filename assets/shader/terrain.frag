@@ -1,4 +1,6 @@
 #version 430 core
+// SHADOWS: 7x7 PCF against the shadow map, TEXTURES: height based textures instead of white
+#pragma keywords SHADOWS TEXTURES
 
 const float levels = 10.0;
 
@@ -11,13 +13,12 @@ uniform sampler2D grassTexture;
 uniform sampler2D stoneTexture;
 uniform sampler2D snowTexture;
 
+#ifdef SHADOWS
 uniform sampler2D shadowMap;
 uniform vec3 lightPos;
+#endif
 uniform vec3 camera_world;
-uniform mat4 lightSpaceMatrix;
 uniform float brightness;
-uniform bool showShadows;
-uniform bool disableTextures;
 
 const float regionMinWater = -scaleY * 0.125;
 const float regionMaxWater = scaleY * 0.005;
@@ -97,6 +98,7 @@ float random(vec3 seed, int i){
 	return fract(sin(dot_product) * 43758.5453);
 }
 
+#ifdef SHADOWS
 float shadowCalculation(vec4 fragPosLightSpace) {
     // perform perspective divide
     vec3 shadowCoord = fragPosLightSpace.xyz / fragPosLightSpace.w;
@@ -132,6 +134,7 @@ float shadowCalculation(vec4 fragPosLightSpace) {
 
     return shadow;
 }
+#endif
 
 void main(){
 	vec2 texCoord = tePosition.xz / (scaleXZ / 20);
@@ -152,12 +155,11 @@ void main(){
     spec = pow(max(dot(teNormal.xyz, halfwayDir), 0.0), 64.0);
     vec3 specular = vec3(0); // spec * lightColor;    
 	
-    vec4 terrainColor;
-    if(disableTextures){
-        terrainColor = vec4(1);
-    } else {
-        terrainColor = generateTerrainColor(texCoord);
-    }
+#ifdef TEXTURES
+    vec4 terrainColor = generateTerrainColor(texCoord);
+#else
+    vec4 terrainColor = vec4(1);
+#endif
 	
     // cel shading
     vec3 terrainColorHSV = rgb2hsv(terrainColor.rgb);
@@ -166,12 +168,11 @@ void main(){
     terrainColor = vec4(hsv2rgb(terrainColorHSV), 1.0);
     
     // calculate shadow
-    float shadow;
-    if(showShadows){
-        shadow = shadowCalculation(teFragPosLightSpace); 
-    } else {
-        shadow = 0;
-    }
+#ifdef SHADOWS
+    float shadow = shadowCalculation(teFragPosLightSpace);
+#else
+    float shadow = 0.0;
+#endif
     //float shadow = shadowCalculation(lightSpaceMatrix * tePosition); 
     
     vec3 light = ambient + ((diffuse + specular) * (1 - shadow));
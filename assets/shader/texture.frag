@@ -1,4 +1,8 @@
 #version 430 core
+#extension GL_ARB_bindless_texture : enable
+#extension GL_NV_gpu_shader5 : enable
+// SHADOWS: 7x7 PCF against the shadow map, TEXTURES: diffuse textures instead of white
+#pragma keywords SHADOWS TEXTURES
 /*
 * Copyright 2019 Vienna University of Technology.
 * Institute of Computer Graphics and Algorithms.
@@ -9,23 +13,47 @@ in VertexData {
 	vec3 position_world;
 	vec3 normal_world;
 	vec2 uv;
+	flat uint material;
 } vert;
 
 out vec4 color;
 
+// the handle of a draw in a multi-draw is not dynamically uniform, only NV_gpu_shader5 allows sampling through it
+#if defined(GL_ARB_bindless_texture) && defined(GL_NV_gpu_shader5)
+#define BINDLESS_MATERIALS
+#endif
+
 uniform vec3 camera_world;
 
-uniform vec3 materialCoefficients; // x = ambient, y = diffuse, z = specular 
-uniform float specularAlpha;
-uniform layout(binding = 0) sampler2D diffuseTexture;
+// one entry per material, see MaterialTable
+struct MaterialData {
+	vec4 coefficients; // x = ambient, y = diffuse, z = specular, w = specular alpha
+#ifdef BINDLESS_MATERIALS
+	sampler2D diffuseTexture;
+#else
+	uvec2 diffuseHandle;
+#endif
+	int page;
+	int layer;
+	float minLod;
+};
+
+layout (std430, binding = 8) readonly buffer Materials {
+	MaterialData materials[];
+};
+
+#ifndef BINDLESS_MATERIALS
+// textures of the same format and size share a page, every multi-draw only uses the materials of one page
+uniform layout(binding = 8) sampler2DArray page;
+#endif
+
 uniform float brightness;
 
-// shadow map
+#ifdef SHADOWS
 uniform mat4 lightSpaceMatrix;
 uniform vec3 lightPos;
 uniform sampler2D shadowMap;
-uniform bool showShadows;
-uniform bool disableTextures;
+#endif
 
 uniform struct PointLight {
 	vec3 color;
@@ -33,6 +61,7 @@ uniform struct PointLight {
 	vec3 attenuation;
 } pointL;
 
+#ifdef SHADOWS
 float shadowCalculation(vec4 fragPosLightSpace) {
     // perform perspective divide
     vec3 shadowCoord = fragPosLightSpace.xyz / fragPosLightSpace.w;
@@ -70,6 +99,7 @@ float shadowCalculation(vec4 fragPosLightSpace) {
 
     return shadow;
 }
+#endif
 
 vec3 rgb2hsv(vec3 c)
 {
@@ -97,7 +127,20 @@ vec3 phong(vec3 n, vec3 l, vec3 v, vec3 diffuseC, float diffuseF, vec3 specularC
 	return (diffuseF * diffuseC * max(0, dot(n, l)) + specularF * specularC * pow(max(0, dot(r, v)), alpha)) * att; 
 }
 
+vec3 diffuseColor(uint material, vec2 uv) {
+#ifdef BINDLESS_MATERIALS
+    // levels that are still streaming in are skipped, the bias keeps the filtering of texture()
+    float lod = textureQueryLod(materials[material].diffuseTexture, uv).y;
+    return texture(materials[material].diffuseTexture, uv, max(materials[material].minLod - lod, 0.0)).rgb;
+#else
+    return texture(page, vec3(uv, materials[material].layer)).rgb;
+#endif
+}
+
 void main() {	
+	vec3 materialCoefficients = materials[vert.material].coefficients.xyz;
+	float specularAlpha = materials[vert.material].coefficients.w;
+
 	//vec3 n = normalize(vert.normal_world);
 	//vec3 v = normalize(camera_world - vert.position_world);
 	
@@ -114,20 +157,17 @@ void main() {
 	
 	
 	// calculate shadow
-    float shadow;
-	vec4 fragPosLightSpace = lightSpaceMatrix * vec4(vert.position_world, 1);
-    if(showShadows){
-        shadow = shadowCalculation(fragPosLightSpace); 
-    } else {
-        shadow = 0;
-    }
-
-    vec3 texColor;
-    if(disableTextures){
-        texColor = vec3(1);
-    } else {
-	    texColor = texture(diffuseTexture, vert.uv).rgb;
-    }
+#ifdef SHADOWS
+    float shadow = shadowCalculation(lightSpaceMatrix * vec4(vert.position_world, 1));
+#else
+    float shadow = 0.0;
+#endif
+
+#ifdef TEXTURES
+    vec3 texColor = diffuseColor(vert.material, vert.uv);
+#else
+    vec3 texColor = vec3(1);
+#endif
 	// vec4(texColor * materialCoefficients.x, 1) //ambient
     
 	// add directional light contribution
@@ -8,21 +8,46 @@
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
 layout(location = 2) in vec2 uv;
+// entry in the draw buffer for batched draws, NO_DRAW for single draws that use the uniforms
+layout(location = 3) in uint drawID;
+
+const uint NO_DRAW = 0xFFFFFFFFu;
+
+struct DrawData {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+	uint material;
+};
+
+layout (std430, binding = 9) readonly buffer Draws {
+	DrawData draws[];
+};
 
 out VertexData {
 	vec3 position_world;
 	vec3 normal_world;
 	vec2 uv;
+	flat uint material;
 } vert;
 
 uniform mat4 modelMatrix;
 uniform mat4 viewProjMatrix;
 uniform mat3 normalMatrix;
+uniform uint materialIndex;
 
 void main() {
-	vert.normal_world = normalMatrix * normal.xyz;
+	mat4 model = modelMatrix;
+	mat3 normalModel = normalMatrix;
+	vert.material = materialIndex;
+	if (drawID != NO_DRAW) {
+		model = draws[drawID].modelMatrix;
+		normalModel = mat3(draws[drawID].normalMatrix);
+		vert.material = draws[drawID].material;
+	}
+
+	vert.normal_world = normalModel * normal.xyz;
 	vert.uv = uv;
-	vec4 position_world_ = modelMatrix * vec4(position, 1);
+	vec4 position_world_ = model * vec4(position, 1);
 	vert.position_world = position_world_.xyz;
 	gl_Position = viewProjMatrix * position_world_;
 